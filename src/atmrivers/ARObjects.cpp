@@ -0,0 +1,419 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    ARObjects.cpp
+///
+///	<remarks>
+///		Copyright 2000-2014 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "ARObjects.h"
+#include "Exception.h"
+
+#include <cmath>
+#include <map>
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Earth radius (km).
+///	</summary>
+static const double ParamEarthRadiusKm = 6371.0;
+
+///////////////////////////////////////////////////////////////////////////////
+
+ARObjectTracker::ARObjectTracker() :
+	m_nLat(0),
+	m_nLon(0),
+	m_nNextId(1)
+{ }
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ARObjectTracker::Initialize(
+	const ARObjectParam & param,
+	const DataVector<double> & dLatDeg,
+	const DataVector<double> & dLonDeg
+) {
+	m_param = param;
+
+	m_nLat = dLatDeg.GetRows();
+	m_nLon = dLonDeg.GetRows();
+
+	if ((m_nLat < 2) || (m_nLon < 2)) {
+		_EXCEPTIONT("Object identification requires at least 2 latitudes"
+			" and 2 longitudes");
+	}
+
+	m_dLatRad.Initialize(m_nLat);
+	m_dLonRad.Initialize(m_nLon);
+	for (int j = 0; j < m_nLat; j++) {
+		m_dLatRad[j] = dLatDeg[j] * M_PI / 180.0;
+	}
+	for (int i = 0; i < m_nLon; i++) {
+		m_dLonRad[i] = dLonDeg[i] * M_PI / 180.0;
+	}
+
+	// Cell areas
+	double dDeltaLat = fabs(m_dLatRad[1] - m_dLatRad[0]);
+	double dDeltaLon = fabs(m_dLonRad[1] - m_dLonRad[0]);
+
+	m_dCellArea.Initialize(m_nLat);
+	for (int j = 0; j < m_nLat; j++) {
+		m_dCellArea[j] =
+			ParamEarthRadiusKm
+			* ParamEarthRadiusKm
+			* cos(m_dLatRad[j])
+			* dDeltaLat
+			* dDeltaLon;
+	}
+
+	m_nNextId = 1;
+	m_vecPrevLabel.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ARObjectTracker::LabelComponents(
+	const DataMatrix<float> & dataField,
+	DataMatrix<int> & dataLabel,
+	std::vector<ARObject> & vecObjects
+) const {
+	if ((dataLabel.GetRows() != m_nLat) ||
+	    (dataLabel.GetColumns() != m_nLon)
+	) {
+		_EXCEPTIONT("Tagged field does not match the grid");
+	}
+
+	vecObjects.clear();
+
+	std::vector<int> vecCells;
+	std::vector<int> vecStack;
+
+	for (int j0 = 0; j0 < m_nLat; j0++) {
+	for (int i0 = 0; i0 < m_nLon; i0++) {
+		if (dataLabel[j0][i0] != -1) {
+			continue;
+		}
+
+		// Flood fill the object (cells in progress are marked -2)
+		vecCells.clear();
+		vecStack.clear();
+
+		dataLabel[j0][i0] = -2;
+		vecStack.push_back(j0 * m_nLon + i0);
+
+		while (vecStack.size() != 0) {
+			int ix = vecStack.back();
+			vecStack.pop_back();
+			vecCells.push_back(ix);
+
+			int j = ix / m_nLon;
+			int i = ix % m_nLon;
+
+			for (int dj = -1; dj <= 1; dj++) {
+				int jn = j + dj;
+				if ((jn < 0) || (jn >= m_nLat)) {
+					continue;
+				}
+				for (int di = -1; di <= 1; di++) {
+					int in = i + di;
+					if ((in < 0) || (in >= m_nLon)) {
+						if (m_param.fRegional) {
+							continue;
+						}
+						in = (in + m_nLon) % m_nLon;
+					}
+					if (dataLabel[jn][in] == -1) {
+						dataLabel[jn][in] = -2;
+						vecStack.push_back(jn * m_nLon + in);
+					}
+				}
+			}
+		}
+
+		// Statistics and criteria
+		ARObject obj;
+		ComputeStats(dataField, vecCells, obj);
+
+		int iLabel = 0;
+		if (Accept(obj)) {
+			vecObjects.push_back(obj);
+			iLabel = static_cast<int>(vecObjects.size());
+		}
+
+		for (int k = 0; k < vecCells.size(); k++) {
+			dataLabel[vecCells[k] / m_nLon][vecCells[k] % m_nLon] = iLabel;
+		}
+	}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ARObjectTracker::ComputeStats(
+	const DataMatrix<float> & dataField,
+	const std::vector<int> & vecCells,
+	ARObject & obj
+) const {
+	obj.id = 0;
+	obj.nCells = static_cast<int>(vecCells.size());
+	obj.dArea = 0.0;
+	obj.dMaxValue = dataField[vecCells[0] / m_nLon][vecCells[0] % m_nLon];
+	obj.dMeanValue = 0.0;
+
+	// Area, field statistics and centroid (as the mean unit vector)
+	double dX = 0.0;
+	double dY = 0.0;
+	double dZ = 0.0;
+
+	for (int k = 0; k < vecCells.size(); k++) {
+		int j = vecCells[k] / m_nLon;
+		int i = vecCells[k] % m_nLon;
+
+		double dA = m_dCellArea[j];
+		double dValue = dataField[j][i];
+
+		obj.dArea += dA;
+		obj.dMeanValue += dA * dValue;
+		if (dValue > obj.dMaxValue) {
+			obj.dMaxValue = dValue;
+		}
+
+		double dCosLat = cos(m_dLatRad[j]);
+		dX += dA * dCosLat * cos(m_dLonRad[i]);
+		dY += dA * dCosLat * sin(m_dLonRad[i]);
+		dZ += dA * sin(m_dLatRad[j]);
+	}
+
+	obj.dMeanValue /= obj.dArea;
+
+	double dLatC = atan2(dZ, sqrt(dX * dX + dY * dY));
+	double dLonC = atan2(dY, dX);
+	if (dLonC < 0.0) {
+		dLonC += 2.0 * M_PI;
+	}
+
+	obj.dCentroidLat = dLatC * 180.0 / M_PI;
+	obj.dCentroidLon = dLonC * 180.0 / M_PI;
+
+	// Second moments in local east/north coordinates about the centroid
+	double dSxx = 0.0;
+	double dSyy = 0.0;
+	double dSxy = 0.0;
+
+	for (int k = 0; k < vecCells.size(); k++) {
+		int j = vecCells[k] / m_nLon;
+		int i = vecCells[k] % m_nLon;
+
+		double dDeltaLon = m_dLonRad[i] - dLonC;
+		dDeltaLon -= 2.0 * M_PI * floor((dDeltaLon + M_PI) / (2.0 * M_PI));
+
+		double dEast = ParamEarthRadiusKm * cos(m_dLatRad[j]) * dDeltaLon;
+		double dNorth = ParamEarthRadiusKm * (m_dLatRad[j] - dLatC);
+
+		double dA = m_dCellArea[j];
+		dSxx += dA * dEast * dEast;
+		dSyy += dA * dNorth * dNorth;
+		dSxy += dA * dEast * dNorth;
+	}
+
+	// Major axis
+	double dTheta = 0.5 * atan2(2.0 * dSxy, dSxx - dSyy);
+	if (dTheta <= -0.5 * M_PI) {
+		dTheta += M_PI;
+	}
+	obj.dOrientation = dTheta * 180.0 / M_PI;
+
+	double dCosTheta = cos(dTheta);
+	double dSinTheta = sin(dTheta);
+
+	// Extent along the major axis
+	double dMinProj = 0.0;
+	double dMaxProj = 0.0;
+
+	for (int k = 0; k < vecCells.size(); k++) {
+		int j = vecCells[k] / m_nLon;
+		int i = vecCells[k] % m_nLon;
+
+		double dDeltaLon = m_dLonRad[i] - dLonC;
+		dDeltaLon -= 2.0 * M_PI * floor((dDeltaLon + M_PI) / (2.0 * M_PI));
+
+		double dEast = ParamEarthRadiusKm * cos(m_dLatRad[j]) * dDeltaLon;
+		double dNorth = ParamEarthRadiusKm * (m_dLatRad[j] - dLatC);
+
+		double dProj = dEast * dCosTheta + dNorth * dSinTheta;
+		if ((k == 0) || (dProj < dMinProj)) {
+			dMinProj = dProj;
+		}
+		if ((k == 0) || (dProj > dMaxProj)) {
+			dMaxProj = dProj;
+		}
+	}
+
+	obj.dLength =
+		(dMaxProj - dMinProj)
+		+ sqrt(obj.dArea / static_cast<double>(obj.nCells));
+
+	obj.dWidth = obj.dArea / obj.dLength;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ARObjectTracker::Accept(
+	const ARObject & obj
+) const {
+	if (obj.dArea < m_param.dMinArea) {
+		return false;
+	}
+	if (obj.dLength < m_param.dMinLength) {
+		return false;
+	}
+	if (obj.dLength < m_param.dMinAspect * obj.dWidth) {
+		return false;
+	}
+
+	double dAbsOrientation = fabs(obj.dOrientation);
+	if (dAbsOrientation < m_param.dMinAbsOrientation) {
+		return false;
+	}
+	if (dAbsOrientation > m_param.dMaxAbsOrientation) {
+		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ARObjectTracker::AssignIds(
+	int * pLabel,
+	std::vector<ARObject> & vecObjects
+) {
+	const int nObjects = static_cast<int>(vecObjects.size());
+	const int nCells = m_nLat * m_nLon;
+
+	// Map from the one-based label to the id
+	std::vector<int> vecId(nObjects + 1, 0);
+
+	if ((m_param.fLinkTime) && (m_vecPrevLabel.size() == nCells)) {
+
+		// Overlap (in cells) of each object with the previous objects
+		std::map< std::pair<int, int>, int > mapOverlap;
+		for (int k = 0; k < nCells; k++) {
+			if ((pLabel[k] != 0) && (m_vecPrevLabel[k] != 0)) {
+				mapOverlap[std::pair<int, int>(pLabel[k], m_vecPrevLabel[k])]++;
+			}
+		}
+
+		// Best match of each object: largest overlap, then smallest id
+		std::vector<int> vecBestId(nObjects + 1, 0);
+		std::vector<int> vecBestOverlap(nObjects + 1, 0);
+
+		std::map< std::pair<int, int>, int >::const_iterator iter =
+			mapOverlap.begin();
+		for (; iter != mapOverlap.end(); iter++) {
+			int iLabel = iter->first.first;
+			if (iter->second > vecBestOverlap[iLabel]) {
+				vecBestOverlap[iLabel] = iter->second;
+				vecBestId[iLabel] = iter->first.second;
+			}
+		}
+
+		// Resolve conflicts: larger overlap first, then smaller label
+		std::vector< std::pair<int, int> > vecClaims;
+		for (int l = 1; l <= nObjects; l++) {
+			if (vecBestId[l] != 0) {
+				vecClaims.push_back(
+					std::pair<int, int>(-vecBestOverlap[l], l));
+			}
+		}
+		std::sort(vecClaims.begin(), vecClaims.end());
+
+		std::map<int, int> mapTaken;
+		for (int c = 0; c < vecClaims.size(); c++) {
+			int l = vecClaims[c].second;
+			if (mapTaken.find(vecBestId[l]) == mapTaken.end()) {
+				mapTaken[vecBestId[l]] = l;
+				vecId[l] = vecBestId[l];
+			}
+		}
+	}
+
+	// New ids in label order
+	for (int l = 1; l <= nObjects; l++) {
+		if (vecId[l] == 0) {
+			vecId[l] = m_nNextId;
+			m_nNextId++;
+		}
+		vecObjects[l-1].id = vecId[l];
+	}
+
+	for (int k = 0; k < nCells; k++) {
+		pLabel[k] = vecId[pLabel[k]];
+	}
+
+	if (m_param.fLinkTime) {
+		m_vecPrevLabel.assign(pLabel, pLabel + nCells);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ARObjectFile::Open(
+	const std::string & strFile
+) {
+	Close();
+
+	m_fp = fopen(strFile.c_str(), "w");
+	if (m_fp == NULL) {
+		_EXCEPTION1("Unable to open file \"%s\" for writing",
+			strFile.c_str());
+	}
+
+	fprintf(m_fp, "#time_id,object_id,cells,area_km2,length_km,width_km,"
+		"orientation_deg,centroid_lat,centroid_lon,max_value,mean_value\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ARObjectFile::Close() {
+	if (m_fp != NULL) {
+		fclose(m_fp);
+		m_fp = NULL;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ARObjectFile::Write(
+	int iTime,
+	const std::vector<ARObject> & vecObjects
+) {
+	if (m_fp == NULL) {
+		_EXCEPTIONT("Object file is not open");
+	}
+	for (int n = 0; n < vecObjects.size(); n++) {
+		const ARObject & obj = vecObjects[n];
+		fprintf(m_fp, "%i,\t%i,\t%i,\t%e,\t%f,\t%f,\t%f,\t%f,\t%f,\t%f,\t%f\n",
+			iTime,
+			obj.id,
+			obj.nCells,
+			obj.dArea,
+			obj.dLength,
+			obj.dWidth,
+			obj.dOrientation,
+			obj.dCentroidLat,
+			obj.dCentroidLon,
+			obj.dMaxValue,
+			obj.dMeanValue);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
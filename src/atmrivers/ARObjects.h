@@ -0,0 +1,311 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    ARObjects.h
+///
+///	<remarks>
+///		Copyright 2000-2014 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _AROBJECTS_H_
+#define _AROBJECTS_H_
+
+#include "DataVector.h"
+#include "DataMatrix.h"
+
+#include <vector>
+#include <string>
+#include <cstdio>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Summary statistics of a connected atmospheric river object.
+///	</summary>
+struct ARObject {
+
+	///	<summary>
+	///		Object id (unique within an output file).
+	///	</summary>
+	int id;
+
+	///	<summary>
+	///		Number of grid cells.
+	///	</summary>
+	int nCells;
+
+	///	<summary>
+	///		Area (km^2).
+	///	</summary>
+	double dArea;
+
+	///	<summary>
+	///		Extent along the major axis, including one cell width (km).
+	///	</summary>
+	double dLength;
+
+	///	<summary>
+	///		Area divided by length (km).
+	///	</summary>
+	double dWidth;
+
+	///	<summary>
+	///		Angle of the major axis counterclockwise from east (degrees,
+	///		in the range (-90,90]).
+	///	</summary>
+	double dOrientation;
+
+	///	<summary>
+	///		Area-weighted centroid (degrees).
+	///	</summary>
+	double dCentroidLat;
+	double dCentroidLon;
+
+	///	<summary>
+	///		Maximum and area-weighted mean of the field over the object.
+	///	</summary>
+	double dMaxValue;
+	double dMeanValue;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Parameters for identifying atmospheric river objects.
+///	</summary>
+struct ARObjectParam {
+
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	ARObjectParam() :
+		fRegional(false),
+		dMinArea(0.0),
+		dMinLength(0.0),
+		dMinAspect(0.0),
+		dMinAbsOrientation(0.0),
+		dMaxAbsOrientation(90.0),
+		fLinkTime(false)
+	{ }
+
+	// Do not connect objects across the longitude boundary
+	bool fRegional;
+
+	// Minimum area (km^2)
+	double dMinArea;
+
+	// Minimum length (km)
+	double dMinLength;
+
+	// Minimum length/width ratio
+	double dMinAspect;
+
+	// Minimum absolute orientation (degrees from east)
+	double dMinAbsOrientation;
+
+	// Maximum absolute orientation (degrees from east)
+	double dMaxAbsOrientation;
+
+	// Keep the id of an object that overlaps one at the previous time
+	bool fLinkTime;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Labels 8-connected objects in a tagged (lat, lon) field, applies
+///		area, length, aspect ratio and orientation criteria, and assigns
+///		object ids that are unique within a file.  When time linking is
+///		enabled, an object keeps the id of the object at the previous
+///		time that it overlaps most; if several objects overlap the same
+///		previous object, the one with the largest overlap keeps its id.
+///	</summary>
+class ARObjectTracker {
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	ARObjectTracker();
+
+	///	<summary>
+	///		Initialize for a grid (latitude and longitude in degrees).
+	///		This also resets the object ids.
+	///	</summary>
+	void Initialize(
+		const ARObjectParam & param,
+		const DataVector<double> & dLatDeg,
+		const DataVector<double> & dLonDeg
+	);
+
+	///	<summary>
+	///		Label the objects of a single time slice.  On return
+	///		dataLabel holds, for each cell of an accepted object, its
+	///		one-based index in vecObjects and zero elsewhere.  Object ids
+	///		are not yet assigned.  This function may be called
+	///		concurrently for different time slices.
+	///	</summary>
+	template <typename TagType>
+	void Label(
+		const DataMatrix<TagType> & dataTag,
+		const DataMatrix<float> & dataField,
+		DataMatrix<int> & dataLabel,
+		std::vector<ARObject> & vecObjects
+	) const {
+		const int nLat = dataTag.GetRows();
+		const int nLon = dataTag.GetColumns();
+
+		dataLabel.Initialize(nLat, nLon, false);
+		for (int j = 0; j < nLat; j++) {
+		for (int i = 0; i < nLon; i++) {
+			dataLabel[j][i] = (dataTag[j][i] != 0)?(-1):(0);
+		}
+		}
+
+		LabelComponents(dataField, dataLabel, vecObjects);
+	}
+
+	///	<summary>
+	///		Assign ids to the objects of the next time slice, given the
+	///		labels produced by Label.  Labels are replaced by ids in place.
+	///		Must be called in time order.
+	///	</summary>
+	void AssignIds(
+		int * pLabel,
+		std::vector<ARObject> & vecObjects
+	);
+
+protected:
+	///	<summary>
+	///		Find the connected components of cells labeled -1.
+	///	</summary>
+	void LabelComponents(
+		const DataMatrix<float> & dataField,
+		DataMatrix<int> & dataLabel,
+		std::vector<ARObject> & vecObjects
+	) const;
+
+	///	<summary>
+	///		Compute the statistics of one object from its cells.
+	///	</summary>
+	void ComputeStats(
+		const DataMatrix<float> & dataField,
+		const std::vector<int> & vecCells,
+		ARObject & obj
+	) const;
+
+	///	<summary>
+	///		Check the criteria.
+	///	</summary>
+	bool Accept(
+		const ARObject & obj
+	) const;
+
+protected:
+	///	<summary>
+	///		Parameters.
+	///	</summary>
+	ARObjectParam m_param;
+
+	///	<summary>
+	///		Grid size.
+	///	</summary>
+	int m_nLat;
+	int m_nLon;
+
+	///	<summary>
+	///		Latitude and longitude (radians).
+	///	</summary>
+	DataVector<double> m_dLatRad;
+	DataVector<double> m_dLonRad;
+
+	///	<summary>
+	///		Cell area for each latitude row (km^2).
+	///	</summary>
+	DataVector<double> m_dCellArea;
+
+	///	<summary>
+	///		Next object id.
+	///	</summary>
+	int m_nNextId;
+
+	///	<summary>
+	///		Object ids at the previous time (when linking).
+	///	</summary>
+	std::vector<int> m_vecPrevLabel;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A text file of object statistics, one line per object.  The file
+///		is closed when this object is destroyed, so it is not left open
+///		if an exception is thrown while objects are being written.
+///	</summary>
+class ARObjectFile {
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	ARObjectFile() :
+		m_fp(NULL)
+	{ }
+
+	///	<summary>
+	///		Destructor.
+	///	</summary>
+	~ARObjectFile() {
+		Close();
+	}
+
+	///	<summary>
+	///		Open the file for writing and write the header.
+	///	</summary>
+	void Open(
+		const std::string & strFile
+	);
+
+	///	<summary>
+	///		Close the file.
+	///	</summary>
+	void Close();
+
+	///	<summary>
+	///		Determine if the file is open.
+	///	</summary>
+	bool IsOpen() const {
+		return (m_fp != NULL);
+	}
+
+	///	<summary>
+	///		Write the statistics of all objects at one time.
+	///	</summary>
+	void Write(
+		int iTime,
+		const std::vector<ARObject> & vecObjects
+	);
+
+private:
+	///	<summary>
+	///		Copying would close the file twice.
+	///	</summary>
+	ARObjectFile(const ARObjectFile &);
+	ARObjectFile & operator=(const ARObjectFile &);
+
+protected:
+	///	<summary>
+	///		File handle.
+	///	</summary>
+	FILE * m_fp;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
+
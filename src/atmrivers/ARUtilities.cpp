@@ -0,0 +1,620 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    ARUtilities.cpp
+///
+///	<remarks>
+///		Copyright 2000-2014 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "ARUtilities.h"
+#include "Exception.h"
+#include "Announce.h"
+
+#include "DataMatrix3D.h"
+
+#include "NetCDFUtilities.h"
+
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+#if defined(TEMPEST_MPIOMP)
+#include <mpi.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReadFileList(
+	const std::string & strFileList,
+	std::vector<std::string> & vecFiles
+) {
+	std::ifstream ifFileList(strFileList.c_str());
+	if (!ifFileList.is_open()) {
+		_EXCEPTION1("Unable to open file \"%s\"",
+			strFileList.c_str());
+	}
+	std::string strFileLine;
+	while (std::getline(ifFileList, strFileLine)) {
+		if (strFileLine.length() == 0) {
+			continue;
+		}
+		if (strFileLine[0] == '#') {
+			continue;
+		}
+		vecFiles.push_back(strFileLine);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void RowColumnSumMax(
+	const DataMatrix<float> & dData,
+	DataVector<float> & dRowSum,
+	DataVector<float> & dRowMax,
+	DataVector<float> & dColumnSum,
+	DataVector<float> & dColumnMax
+) {
+	const int nLat = dData.GetRows();
+	const int nLon = dData.GetColumns();
+
+	dRowSum.Initialize(nLat);
+	dRowMax.Initialize(nLat);
+	dColumnSum.Initialize(nLon);
+	dColumnMax.Initialize(nLon);
+
+	if ((nLat == 0) || (nLon == 0)) {
+		return;
+	}
+
+	float * __restrict dColSum = &(dColumnSum[0]);
+	float * __restrict dColMax = &(dColumnMax[0]);
+
+	memcpy(dColMax, dData[0], nLon * sizeof(float));
+
+	for (int j = 0; j < nLat; j++) {
+		const float * __restrict dRow = dData[j];
+
+		float dSum = 0.0f;
+		float dMax = dRow[0];
+		for (int i = 0; i < nLon; i++) {
+			dSum += dRow[i];
+			if (dRow[i] > dMax) {
+				dMax = dRow[i];
+			}
+			dColSum[i] += dRow[i];
+			if (dRow[i] > dColMax[i]) {
+				dColMax[i] = dRow[i];
+			}
+		}
+
+		dRowSum[j] = dSum;
+		dRowMax[j] = dMax;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ZonalMeridThresholds(
+	const DataMatrix<float> & dData,
+	double dZonalMeanWeight,
+	double dZonalMaxWeight,
+	double dMeridMeanWeight,
+	double dMeridMaxWeight,
+	DataVector<float> & dZonalThreshold,
+	DataVector<float> & dMeridThreshold
+) {
+	const int nLat = dData.GetRows();
+	const int nLon = dData.GetColumns();
+
+	DataVector<float> dZonalMax;
+	DataVector<float> dMeridMax;
+
+	RowColumnSumMax(
+		dData,
+		dZonalThreshold,
+		dZonalMax,
+		dMeridThreshold,
+		dMeridMax);
+
+	// Compute zonal threshold
+	for (int j = 0; j < nLat; j++) {
+		dZonalThreshold[j] /= static_cast<float>(nLon);
+
+		dZonalThreshold[j] =
+			dZonalMeanWeight * dZonalThreshold[j]
+			+ dZonalMaxWeight * dZonalMax[j];
+	}
+
+	// Compute meridional threshold
+	for (int i = 0; i < nLon; i++) {
+		dMeridThreshold[i] /= static_cast<float>(nLon);
+
+		dMeridThreshold[i] =
+			dMeridMeanWeight * dMeridThreshold[i]
+			+ dMeridMaxWeight * dMeridMax[i];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Laplacian9Point(
+	const DataMatrix<float> & dData,
+	int iSize,
+	double dX2,
+	double dY2,
+	DataMatrix<float> & dPadded,
+	DataMatrix<double> & dLaplacian
+) {
+	const int nLat = dData.GetRows();
+	const int nLon = dData.GetColumns();
+
+	if ((iSize < 1) || (iSize > nLon)) {
+		_EXCEPTION1("Invalid Laplacian size (%i)", iSize);
+	}
+
+	// Copy the field with iSize columns of periodic halo on each side
+	const int nPadLon = nLon + 2 * iSize;
+	dPadded.Initialize(nLat, nPadLon, false);
+
+	for (int j = 0; j < nLat; j++) {
+		const float * dRow = dData[j];
+		float * dPadRow = dPadded[j];
+
+		memcpy(dPadRow, dRow + nLon - iSize, iSize * sizeof(float));
+		memcpy(dPadRow + iSize, dRow, nLon * sizeof(float));
+		memcpy(dPadRow + iSize + nLon, dRow, iSize * sizeof(float));
+	}
+
+	// Stencil weights
+	const double dA = 1.0 / 12.0 * (1.0/dX2 + 1.0/dY2);
+	const double dB = 5.0 / (6.0 * dX2) - 1.0 / (6.0 * dY2);
+	const double dC = -1.0 / (6.0 * dX2) + 5.0 / (6.0 * dY2);
+	const double dD = -5.0 / 3.0 * (1.0/dX2 + 1.0/dY2);
+
+	for (int j = iSize; j < nLat - iSize; j++) {
+
+		// Padded rows, offset so that index i is the cell (j, i)
+		const float * __restrict dS = dPadded[j - iSize] + iSize;
+		const float * __restrict dM = dPadded[j] + iSize;
+		const float * __restrict dN = dPadded[j + iSize] + iSize;
+
+		double * __restrict dOut = dLaplacian[j];
+
+		for (int i = 0; i < nLon; i++) {
+			const int i0 = i - iSize;
+			const int i2 = i + iSize;
+
+			dOut[i] =
+				  dA * dS[i0]
+				+ dB * dM[i0]
+				+ dA * dN[i0]
+				+ dC * dS[i ]
+				+ dD * dM[i ]
+				+ dC * dN[i ]
+				+ dA * dS[i2]
+				+ dB * dM[i2]
+				+ dA * dN[i2];
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Write a block of nt time slices starting at time t to a (time,
+///		lat, lon) variable, or a single slice to a (lat, lon) variable.
+///	</summary>
+template <typename T>
+static void PutTimeBlock(
+	NcVar * var,
+	bool fHasTime,
+	const T * data,
+	int t,
+	int nt,
+	int nLat,
+	int nLon
+) {
+	if (fHasTime) {
+		var->set_cur(t, 0, 0);
+		var->put(data, nt, nLat, nLon);
+	} else {
+		var->set_cur(0, 0);
+		var->put(data, nLat, nLon);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ARTagFile(
+	const std::string & strInputFile,
+	const std::string & strOutputFile,
+	const ARPipelineParam & param,
+	ARSliceTagger & tagger
+) {
+	AnnounceStartBlock("Loading data");
+
+	// Open the NetCDF input file
+	NcFile ncInput(strInputFile.c_str());
+
+	if (!ncInput.is_valid()) {
+		_EXCEPTION1("Unable to open NetCDF file \"%s\" for reading",
+			strInputFile.c_str());
+	}
+
+	// Get the time dimension
+	NcDim * dimTime = ncInput.get_dim("time");
+	//if (dimTime == NULL) {
+	//	_EXCEPTIONT("Error accessing dimension \"time\"");
+	//}
+
+	// Get the longitude dimension
+	NcDim * dimLon = ncInput.get_dim("lon");
+	if (dimLon == NULL) {
+		_EXCEPTIONT("Error accessing dimension \"lon\"");
+	}
+
+	// Get the longitude variable
+	NcVar * varLon = ncInput.get_var("lon");
+	if (varLon == NULL) {
+		_EXCEPTIONT("Error accessing variable \"lon\"");
+	}
+
+	DataVector<double> dLonDeg(dimLon->size());
+	varLon->get(&(dLonDeg[0]), dimLon->size());
+
+	// Get the latitude dimension
+	NcDim * dimLat = ncInput.get_dim("lat");
+	if (dimLat == NULL) {
+		_EXCEPTIONT("Error accessing dimension \"lat\"");
+	}
+
+	// Get the latitude variable
+	NcVar * varLat = ncInput.get_var("lat");
+	if (varLat == NULL) {
+		_EXCEPTIONT("Error accessing variable \"lat\"");
+	}
+
+	DataVector<double> dLatDeg(dimLat->size());
+	varLat->get(&(dLatDeg[0]), dimLat->size());
+
+	// Get the integrated water vapor variable
+	NcVar * varIWV = ncInput.get_var(param.strIWVVariable.c_str());
+	if (varIWV == NULL) {
+		_EXCEPTION1("Error accessing variable \"%s\"",
+			param.strIWVVariable.c_str());
+	}
+
+	// Open the NetCDF output file
+	NcFile ncOutput(strOutputFile.c_str(), NcFile::Replace);
+	if (!ncOutput.is_valid()) {
+		_EXCEPTION1("Unable to open NetCDF file \"%s\" for writing",
+			strOutputFile.c_str());
+	}
+
+	// Copy over latitude, longitude and time variables to output file
+	NcDim * dimTimeOut = NULL;
+	if (dimTime != NULL) {
+		CopyNcVar(ncInput, ncOutput, "time", true);
+		dimTimeOut = ncOutput.get_dim("time");
+		if (dimTimeOut == NULL) {
+			_EXCEPTIONT("Error copying variable \"time\" to output file");
+		}
+	}
+
+	CopyNcVar(ncInput, ncOutput, "lat", true);
+	CopyNcVar(ncInput, ncOutput, "lon", true);
+
+	NcDim * dimLonOut = ncOutput.get_dim("lon");
+	if (dimLonOut == NULL) {
+		_EXCEPTIONT("Error copying variable \"lon\" to output file");
+	}
+	NcDim * dimLatOut = ncOutput.get_dim("lat");
+	if (dimLatOut == NULL) {
+		_EXCEPTIONT("Error copying variable \"lat\" to output file");
+	}
+
+	NcVar * varIWVtag = NULL;
+	if (dimTime != NULL) {
+		varIWVtag = ncOutput.add_var(
+			"ar_binary_tag",
+			ncByte,
+			dimTimeOut,
+			dimLatOut,
+			dimLonOut);
+
+	} else {
+		varIWVtag = ncOutput.add_var(
+			"ar_binary_tag",
+			ncByte,
+			dimLatOut,
+			dimLonOut);
+	}
+
+	tagger.DescribeTagVariable(varIWVtag);
+
+	// Diagnostic field
+	NcVar * varDiagnostic = NULL;
+	const char * szDiagnostic = tagger.GetDiagnosticName();
+	if (szDiagnostic != NULL) {
+		if (dimTime != NULL) {
+			varDiagnostic = ncOutput.add_var(
+				szDiagnostic,
+				ncDouble,
+				dimTimeOut,
+				dimLatOut,
+				dimLonOut);
+
+		} else {
+			varDiagnostic = ncOutput.add_var(
+				szDiagnostic,
+				ncDouble,
+				dimLatOut,
+				dimLonOut);
+		}
+	}
+
+	// Object ids and statistics
+	NcVar * varObjectId = NULL;
+	ARObjectFile fileObjects;
+	ARObjectTracker tracker;
+
+	if (param.fObjects) {
+		if (dimTime != NULL) {
+			varObjectId = ncOutput.add_var(
+				"ar_object_id",
+				ncInt,
+				dimTimeOut,
+				dimLatOut,
+				dimLonOut);
+
+		} else {
+			varObjectId = ncOutput.add_var(
+				"ar_object_id",
+				ncInt,
+				dimLatOut,
+				dimLonOut);
+		}
+
+		varObjectId->add_att("description", "id of atmospheric river object");
+
+		// Statistics are written next to the output file
+		std::string strObjectFile = strOutputFile;
+		if ((strObjectFile.length() > 3) &&
+		    (strObjectFile.substr(strObjectFile.length()-3) == ".nc")
+		) {
+			strObjectFile.resize(strObjectFile.length()-3);
+		}
+		strObjectFile += "_objects.txt";
+
+		fileObjects.Open(strObjectFile);
+
+		tracker.Initialize(param.objparam, dLatDeg, dLonDeg);
+	}
+
+	tagger.Initialize(dLatDeg, dLonDeg);
+
+	AnnounceEndBlock("Done");
+
+	const int nLat = dimLat->size();
+	const int nLon = dimLon->size();
+
+	// Number of times and blocks
+	int nTimes = 1;
+	if (dimTime != NULL) {
+		nTimes = dimTime->size();
+	}
+	if (nTimes < 1) {
+		return;
+	}
+
+	const int nBlockSize = std::min(param.nTimeBlock, nTimes);
+	const int nBlocks = (nTimes + nBlockSize - 1) / nBlockSize;
+
+	// Input, diagnostic and tagged cell blocks (two of each, so that one
+	// block can be read and one written while a third is tagged)
+	DataMatrix3D<float> dIWVBlock[2];
+	DataMatrix3D<double> dDiagnosticBlock[2];
+	DataMatrix3D<int> dIWVtagBlock[2];
+	for (int k = 0; k < 2; k++) {
+		dIWVBlock[k].Initialize(nBlockSize, nLat, nLon);
+		dIWVtagBlock[k].Initialize(nBlockSize, nLat, nLon);
+		if (varDiagnostic != NULL) {
+			dDiagnosticBlock[k].Initialize(nBlockSize, nLat, nLon);
+		}
+	}
+
+	// Object id blocks and the objects of each slice of a block
+	DataMatrix3D<int> dObjectIdBlock[2];
+	std::vector< std::vector<ARObject> > vecBlockObjects(nBlockSize);
+	if (param.fObjects) {
+		for (int k = 0; k < 2; k++) {
+			dObjectIdBlock[k].Initialize(nBlockSize, nLat, nLon);
+		}
+	}
+
+	// Get the IWV array for the first block
+	if (dimTime != NULL) {
+		varIWV->set_cur(0, 0, 0);
+		varIWV->get(dIWVBlock[0].GetData(), nBlockSize, nLat, nLon);
+	} else {
+		varIWV->set_cur(0, 0);
+		varIWV->get(dIWVBlock[0].GetData(), nLat, nLon);
+	}
+
+	for (int k = 0; k <= nBlocks; k++) {
+		const int t0 = k * nBlockSize;
+		const int nt = (k < nBlocks)?(std::min(nBlockSize, nTimes - t0)):(0);
+
+		if (nt > 0) {
+			Announce("Time %i to %i", t0, t0 + nt - 1);
+		}
+
+#pragma omp parallel
+		{
+			DataMatrix<float> dIWV(nLat, nLon);
+			DataMatrix<float> dWorkspace;
+			DataMatrix<double> dDiagnostic;
+			DataMatrix<int> dIWVtag(nLat, nLon);
+			DataMatrix<int> dLabel;
+
+			if (varDiagnostic != NULL) {
+				dDiagnostic.Initialize(nLat, nLon);
+			}
+
+#pragma omp single nowait
+			{
+				// Output diagnostic field, tagged cell array and object
+				// ids of the previous block
+				if (k > 0) {
+					const int tPrev = t0 - nBlockSize;
+					const int ntPrev = std::min(nBlockSize, nTimes - tPrev);
+
+					if (varDiagnostic != NULL) {
+						PutTimeBlock(varDiagnostic, (dimTime != NULL),
+							dDiagnosticBlock[(k-1)%2].GetData(),
+							tPrev, ntPrev, nLat, nLon);
+					}
+
+					PutTimeBlock(varIWVtag, (dimTime != NULL),
+						dIWVtagBlock[(k-1)%2].GetData(),
+						tPrev, ntPrev, nLat, nLon);
+
+					if (varObjectId != NULL) {
+						PutTimeBlock(varObjectId, (dimTime != NULL),
+							dObjectIdBlock[(k-1)%2].GetData(),
+							tPrev, ntPrev, nLat, nLon);
+					}
+				}
+
+				// Get the IWV array of the next block
+				if (k+1 < nBlocks) {
+					const int tNext = t0 + nBlockSize;
+					const int ntNext = std::min(nBlockSize, nTimes - tNext);
+					varIWV->set_cur(tNext, 0, 0);
+					varIWV->get(
+						dIWVBlock[(k+1)%2].GetData(),
+						ntNext, nLat, nLon);
+				}
+			}
+
+#pragma omp for schedule(dynamic)
+			for (int s = 0; s < nt; s++) {
+				memcpy(&(dIWV[0][0]),
+					dIWVBlock[k%2].GetRow(s,0),
+					nLat * nLon * sizeof(float));
+
+				tagger.TagSlice(dIWV, dWorkspace, dDiagnostic, dIWVtag);
+
+				if (varDiagnostic != NULL) {
+					memcpy(dDiagnosticBlock[k%2].GetRow(s,0),
+						&(dDiagnostic[0][0]),
+						nLat * nLon * sizeof(double));
+				}
+				memcpy(dIWVtagBlock[k%2].GetRow(s,0),
+					&(dIWVtag[0][0]),
+					nLat * nLon * sizeof(int));
+
+				// Label objects (ids are assigned below, in time order)
+				if (param.fObjects) {
+					tracker.Label(dIWVtag, dIWV, dLabel, vecBlockObjects[s]);
+
+					memcpy(dObjectIdBlock[k%2].GetRow(s,0),
+						&(dLabel[0][0]),
+						nLat * nLon * sizeof(int));
+				}
+			}
+		}
+
+		// Assign object ids and write statistics
+		if (param.fObjects) {
+			for (int s = 0; s < nt; s++) {
+				tracker.AssignIds(
+					dObjectIdBlock[k%2].GetRow(s,0),
+					vecBlockObjects[s]);
+
+				fileObjects.Write(t0 + s, vecBlockObjects[s]);
+			}
+		}
+	}
+
+	fileObjects.Close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ARTagFiles(
+	const std::string & strInputFile,
+	const std::string & strInputFileList,
+	const std::string & strOutputFile,
+	const std::string & strOutputFileList,
+	const ARPipelineParam & param,
+	ARSliceTagger & tagger
+) {
+	// Check input
+	if ((strInputFile == "") && (strInputFileList == "")) {
+		_EXCEPTIONT("No input file (--in) or (--inlist) specified");
+	}
+	if ((strInputFile != "") && (strInputFileList != "")) {
+		_EXCEPTIONT("Only one of (--in) or (--inlist) may be specified");
+	}
+
+	// Check output
+	if ((strInputFile != "") && (strOutputFile == "")) {
+		_EXCEPTIONT("No output file (--out) specified");
+	}
+	if ((strInputFileList != "") && (strOutputFileList == "")) {
+		_EXCEPTIONT("No output file list (--outlist) specified");
+	}
+
+	// Check time block
+	if (param.nTimeBlock < 1) {
+		_EXCEPTIONT("--timeblock must be at least 1");
+	}
+
+	// Load input and output file lists
+	std::vector<std::string> vecInputFiles;
+	std::vector<std::string> vecOutputFiles;
+
+	if (strInputFile != "") {
+		vecInputFiles.push_back(strInputFile);
+		vecOutputFiles.push_back(strOutputFile);
+
+	} else {
+		ReadFileList(strInputFileList, vecInputFiles);
+		ReadFileList(strOutputFileList, vecOutputFiles);
+
+		if (vecOutputFiles.size() != vecInputFiles.size()) {
+			_EXCEPTIONT("File --inlist must match --outlist");
+		}
+	}
+
+#if defined(TEMPEST_MPIOMP)
+	// Spread files across nodes
+	int nMPIRank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &nMPIRank);
+
+	int nMPISize;
+	MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
+#endif
+
+	// Loop over all files to be processed
+	for (int f = 0; f < vecInputFiles.size(); f++) {
+#if defined(TEMPEST_MPIOMP)
+		if (f % nMPISize != nMPIRank) {
+			continue;
+		}
+#endif
+		Announce("Processing \"%s\"", vecInputFiles[f].c_str());
+
+		ARTagFile(vecInputFiles[f], vecOutputFiles[f], param, tagger);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
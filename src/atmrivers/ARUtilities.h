@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    ARUtilities.h
+///
+///	<remarks>
+///		Copyright 2000-2014 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _ARUTILITIES_H_
+#define _ARUTILITIES_H_
+
+#include "DataVector.h"
+#include "DataMatrix.h"
+
+#include "ARObjects.h"
+
+#include "netcdfcpp.h"
+
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Read a list of file names, skipping blank lines and comments.
+///	</summary>
+void ReadFileList(
+	const std::string & strFileList,
+	std::vector<std::string> & vecFiles
+);
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Compute the sum and maximum of every row and every column of a
+///		(lat, lon) field in a single pass over the data.  Rows are
+///		streamed in memory order and the column sums and maxima are
+///		updated as contiguous vectors, so no strided column walk is
+///		needed.
+///	</summary>
+void RowColumnSumMax(
+	const DataMatrix<float> & dData,
+	DataVector<float> & dRowSum,
+	DataVector<float> & dRowMax,
+	DataVector<float> & dColumnSum,
+	DataVector<float> & dColumnMax
+);
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Compute the zonal and meridional thresholds used to tag
+///		atmospheric river cells: a weighted sum of the mean and the
+///		maximum of the field along each latitude row and each longitude
+///		column.  As in the original tools, the meridional mean is
+///		normalized by the number of longitudes.
+///	</summary>
+void ZonalMeridThresholds(
+	const DataMatrix<float> & dData,
+	double dZonalMeanWeight,
+	double dZonalMaxWeight,
+	double dMeridMeanWeight,
+	double dMeridMaxWeight,
+	DataVector<float> & dZonalThreshold,
+	DataVector<float> & dMeridThreshold
+);
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Compute the 9-point Laplacian of a (lat, lon) field with a
+///		stencil of iSize grid cells on rows iSize to nLat-iSize-1;
+///		other rows of dLaplacian are not modified.  The field is first
+///		copied into dPadded with iSize columns of periodic halo on each
+///		side, so the inner loop needs no modulo indexing.
+///	</summary>
+void Laplacian9Point(
+	const DataMatrix<float> & dData,
+	int iSize,
+	double dX2,
+	double dY2,
+	DataMatrix<float> & dPadded,
+	DataMatrix<double> & dLaplacian
+);
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Parameters of the block pipeline shared by the AR tagging tools.
+///	</summary>
+struct ARPipelineParam {
+
+	// Input integrated water vapor variable name
+	std::string strIWVVariable;
+
+	// Number of time slices read, tagged and written together
+	int nTimeBlock;
+
+	// Identify AR objects and write their ids and statistics
+	bool fObjects;
+
+	// Object criteria
+	ARObjectParam objparam;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Per-timestep tagging callback of the block pipeline.  TagSlice is
+///		called concurrently from several threads and must not modify the
+///		tagger.
+///	</summary>
+class ARSliceTagger {
+
+public:
+	///	<summary>
+	///		Virtual destructor.
+	///	</summary>
+	virtual ~ARSliceTagger() { }
+
+	///	<summary>
+	///		Prepare for a file on the given grid (in degrees).
+	///	</summary>
+	virtual void Initialize(
+		const DataVector<double> & dLatDeg,
+		const DataVector<double> & dLonDeg
+	) = 0;
+
+	///	<summary>
+	///		Add scheme attributes to the output tag variable.
+	///	</summary>
+	virtual void DescribeTagVariable(
+		NcVar * varTag
+	) const { }
+
+	///	<summary>
+	///		Name of an additional (lat, lon) diagnostic field written with
+	///		the tags, or NULL if there is none.
+	///	</summary>
+	virtual const char * GetDiagnosticName() const {
+		return NULL;
+	}
+
+	///	<summary>
+	///		Build the tagged cell array (and diagnostic field) of a single
+	///		time slice.  dWorkspace persists across the slices tagged by
+	///		one thread; dDiagnostic is zero on the first call.
+	///	</summary>
+	virtual void TagSlice(
+		const DataMatrix<float> & dIWV,
+		DataMatrix<float> & dWorkspace,
+		DataMatrix<double> & dDiagnostic,
+		DataMatrix<int> & dIWVtag
+	) const = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Tag atmospheric rivers in a single input file.  Time slices are
+///		processed in blocks of param.nTimeBlock: while the slices of one
+///		block are tagged in parallel, one thread writes the previous
+///		block and reads the next one.
+///	</summary>
+void ARTagFile(
+	const std::string & strInputFile,
+	const std::string & strOutputFile,
+	const ARPipelineParam & param,
+	ARSliceTagger & tagger
+);
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Tag atmospheric rivers in a single file (--in/--out) or in each
+///		file of a list (--inlist/--outlist).  Under MPI the files are
+///		spread across ranks in round-robin order.
+///	</summary>
+void ARTagFiles(
+	const std::string & strInputFile,
+	const std::string & strInputFileList,
+	const std::string & strOutputFile,
+	const std::string & strOutputFileList,
+	const ARPipelineParam & param,
+	ARSliceTagger & tagger
+);
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
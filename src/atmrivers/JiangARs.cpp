@@ -22,26 +22,19 @@
 #include "DataMatrix.h"
 
 #include "netcdfcpp.h"
-#include "NetCDFUtilities.h"
 
-///////////////////////////////////////////////////////////////////////////////
-
-int main(int argc, char** argv) {
-
-	NcError error(NcError::silent_nonfatal);
+#include "ARUtilities.h"
 
-try {
-	// Input file
-	std::string strInputFile;
+#if defined(TEMPEST_MPIOMP)
+#include <mpi.h>
+#endif
 
-	// Output file
-	std::string strOutputFile;
+///////////////////////////////////////////////////////////////////////////////
 
-	// Input integrated water vapor variable name
-	std::string strIWVVariable;
-
-	// Output variable name
-	std::string strOutputVariable;
+///	<summary>
+///		Parameters for JiangARs.
+///	</summary>
+struct JiangARsParam {
 
 	// Minimum absolute latitude
 	double dMinAbsLat;
@@ -52,12 +45,6 @@ try {
 	// Minimum pointwise integrated water vapor
 	double dMinIWV;
 
-	// Minimum area
-	double dMinArea;
-
-	// Maximal areal fraction
-	double dMaxArealFraction;
-
 	// Zonal mean weight
 	double dZonalMeanWeight;
 
@@ -70,299 +57,250 @@ try {
 	// Meridional max weight
 	double dMeridMaxWeight;
 
-	// Parse the command line
-	BeginCommandLine()
-		CommandLineString(strInputFile, "in", "");
-		//CommandLineString(strInputFileList, "inlist", "");
-		CommandLineString(strOutputFile, "out", "");
-		CommandLineString(strIWVVariable, "iwvvar", "");
-		CommandLineString(strOutputVariable, "outvar", "");
-		CommandLineDouble(dMinAbsLat, "minabslat", 15.0);
-		CommandLineDouble(dEqBandMaxLat, "eqbandmaxlat", 15.0);
-		CommandLineDouble(dMinIWV, "miniwv", 20.0);
-		CommandLineDouble(dZonalMeanWeight, "zonalmeanwt", 0.7);
-		CommandLineDouble(dZonalMaxWeight, "zonalmaxwt", 0.3);
-		CommandLineDouble(dMeridMeanWeight, "meridmeanwt", 0.9);
-		CommandLineDouble(dMeridMaxWeight, "meridmaxwt", 0.1);
-		//CommandLineBool(fRegional, "regional");
-
-		ParseCommandLine(argc, argv);
-	EndCommandLine(argv)
-
-	AnnounceBanner();
-
-	AnnounceStartBlock("Loading data");
-
-	// Check input
-	if (strInputFile == "") {
-		_EXCEPTIONT("No input file (--in) specified");
-	}
-
-	// Check output
-	if (strOutputFile == "") {
-		_EXCEPTIONT("No output file (--out) specified");
-	}
-
-	// Check variable
-	if (strIWVVariable == "") {
-		_EXCEPTIONT("No IWV variable name (--iwvvar) specified");
-	}
-
-	// Check output variable
-	if (strOutputVariable.length() == 0) {
-		strOutputVariable = strIWVVariable + "tag";
-	}
-
-	// Open the NetCDF input file
-	NcFile ncInput(strInputFile.c_str());
-
-	if (!ncInput.is_valid()) {
-		_EXCEPTION1("Unable to open NetCDF file \"%s\" for reading",
-			strInputFile.c_str());
-	}
-
-
-	// Get the time dimension
-	NcDim * dimTime = ncInput.get_dim("time");
-	//if (dimTime == NULL) {
-	//	_EXCEPTIONT("Error accessing dimension \"time\"");
-	//}
+};
 
-	// Get the longitude dimension
-	NcDim * dimLon = ncInput.get_dim("lon");
-	if (dimLon == NULL) {
-		_EXCEPTIONT("Error accessing dimension \"lon\"");
-	}
-
-	// Get the longitude variable
-	NcVar * varLon = ncInput.get_var("lon");
-	if (varLon == NULL) {
-		_EXCEPTIONT("Error accessing variable \"lon\"");
-	}
-
-	DataVector<double> dLonDeg(dimLon->size());
-	varLon->get(&(dLonDeg[0]), dimLon->size());
+///////////////////////////////////////////////////////////////////////////////
 
-	// Get the latitude dimension
-	NcDim * dimLat = ncInput.get_dim("lat");
-	if (dimLat == NULL) {
-		_EXCEPTIONT("Error accessing dimension \"lat\"");
-	}
+///	<summary>
+///		Build the tagged cell array for a single time slice.
+///	</summary>
+void JiangARsTagSlice(
+	const JiangARsParam & param,
+	const DataVector<double> & dLatDeg,
+	const DataMatrix<float> & dIWV,
+	DataMatrix<int> & dIWVtag
+) {
+	const int nLat = dIWV.GetRows();
+	const int nLon = dIWV.GetColumns();
+
+	// Compute zonal/meridional thresholds
+	DataVector<float> dZonalThreshold;
+	DataVector<float> dMeridThreshold;
+
+	ZonalMeridThresholds(
+		dIWV,
+		param.dZonalMeanWeight,
+		param.dZonalMaxWeight,
+		param.dMeridMeanWeight,
+		param.dMeridMaxWeight,
+		dZonalThreshold,
+		dMeridThreshold);
+
+	// Build tagged cell array
+	dIWVtag.Zero();
+
+	for (int j = 0; j < nLat; j++) {
+	for (int i = 0; i < nLon; i++) {
+		if (fabs(dLatDeg[j]) < param.dMinAbsLat) {
+			continue;
+		}
+		if (dIWV[j][i] < param.dMinIWV) {
+			continue;
+		}
+		if (dIWV[j][i] < dZonalThreshold[j]) {
+			continue;
+		}
+		if (dIWV[j][i] < dMeridThreshold[i]) {
+			continue;
+		}
 
-	// Get the latitude variable
-	NcVar * varLat = ncInput.get_var("lat");
-	if (varLat == NULL) {
-		_EXCEPTIONT("Error accessing variable \"lat\"");
+		dIWVtag[j][i] = 1;
 	}
-
-	DataVector<double> dLatDeg(dimLat->size());
-	varLat->get(&(dLatDeg[0]), dimLat->size());
-
-	// Get the integrated water vapor variable
-	NcVar * varIWV = ncInput.get_var(strIWVVariable.c_str());
-	if (varIWV == NULL) {
-		_EXCEPTION1("Error accessing variable \"%s\"",
-			strIWVVariable.c_str());
 	}
 
-	DataMatrix<float> dIWV(dimLat->size(), dimLon->size());
-
-	// Open the NetCDF output file
-	NcFile ncOutput(strOutputFile.c_str(), NcFile::Replace);
-	if (!ncOutput.is_valid()) {
-		_EXCEPTION1("Unable to open NetCDF file \"%s\" for writing",
-			strOutputFile.c_str());
-	}
+	// Remove points connected with equatorial moisture band
+	for (int i = 0; i < nLon; i++) {
+		bool fSouthDone = false;
+		bool fNorthDone = false;
 
-	// Copy over latitude, longitude and time variables to output file
-	NcDim * dimTimeOut = NULL;
-	if (dimTime != NULL) {
-		CopyNcVar(ncInput, ncOutput, "time", true);
-		dimTimeOut = ncOutput.get_dim("time");
-		if (dimTimeOut == NULL) {
-			_EXCEPTIONT("Error copying variable \"time\" to output file");
+		for (int j = 0; j < nLat; j++) {
+			if ((!fSouthDone) && (dLatDeg[j] > -param.dMinAbsLat)) {
+				for (int k = j-1; k > 0; k--) {
+					if (dIWVtag[k][i] == 0) {
+						break;
+					}
+					if (dLatDeg[k] < -param.dEqBandMaxLat) {
+						break;
+					}
+					dIWVtag[k][i] = 0;
+				}
+				fSouthDone = true;
+			}
+			if ((!fNorthDone) && (dLatDeg[j] > param.dMinAbsLat)) {
+				for (int k = j-1; k < nLat; k++) {
+					if (dIWVtag[k][i] == 0) {
+						break;
+					}
+					if (dLatDeg[k] > param.dEqBandMaxLat) {
+						break;
+					}
+					dIWVtag[k][i] = 0;
+				}
+				fNorthDone = true;
+			}
 		}
 	}
+}
 
-	CopyNcVar(ncInput, ncOutput, "lat", true);
-	CopyNcVar(ncInput, ncOutput, "lon", true);
+///////////////////////////////////////////////////////////////////////////////
 
-	NcDim * dimLonOut = ncOutput.get_dim("lon");
-	if (dimLonOut == NULL) {
-		_EXCEPTIONT("Error copying variable \"lon\" to output file");
-	}
-	NcDim * dimLatOut = ncOutput.get_dim("lat");
-	if (dimLatOut == NULL) {
-		_EXCEPTIONT("Error copying variable \"lat\" to output file");
+///	<summary>
+///		Per-timestep tagging callback for JiangARs.
+///	</summary>
+class JiangARsTagger : public ARSliceTagger {
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	JiangARsTagger(
+		const JiangARsParam & param
+	) :
+		m_param(param)
+	{ }
+
+	///	<summary>
+	///		Store the latitudes of the grid.
+	///	</summary>
+	virtual void Initialize(
+		const DataVector<double> & dLatDeg,
+		const DataVector<double> & dLonDeg
+	) {
+		m_dLatDeg = dLatDeg;
 	}
 
-	NcVar * varIWVtag = NULL;
-	if (dimTime != NULL) {
-		varIWVtag = ncOutput.add_var(
-			"ar_binary_tag",
-			ncByte,
-			dimTimeOut,
-			dimLatOut,
-			dimLonOut);
-
-	} else {
-		varIWVtag = ncOutput.add_var(
-			"ar_binary_tag",
-			ncByte,
-			dimLatOut,
-			dimLonOut);
+	///	<summary>
+	///		Add scheme attributes to the output tag variable.
+	///	</summary>
+	virtual void DescribeTagVariable(
+		NcVar * varTag
+	) const {
+		varTag->add_att("description", "binary indicator of atmospheric river");
+		varTag->add_att("scheme", "Jiang");
+		varTag->add_att("version", "1.0");
 	}
 
-	varIWVtag->add_att("description", "binary indicator of atmospheric river");
-	varIWVtag->add_att("scheme", "Jiang");
-	varIWVtag->add_att("version", "1.0");
+	///	<summary>
+	///		Build the tagged cell array for a single time slice.
+	///	</summary>
+	virtual void TagSlice(
+		const DataMatrix<float> & dIWV,
+		DataMatrix<float> & dWorkspace,
+		DataMatrix<double> & dDiagnostic,
+		DataMatrix<int> & dIWVtag
+	) const {
+		JiangARsTagSlice(m_param, m_dLatDeg, dIWV, dIWVtag);
+	}
 
-	AnnounceEndBlock("Done");
+protected:
+	///	<summary>
+	///		Parameters for JiangARs.
+	///	</summary>
+	const JiangARsParam & m_param;
 
-	// Tagged cell array
-	DataMatrix<ncbyte> dIWVtag(dimLat->size(), dimLon->size());
+	///	<summary>
+	///		Latitudes of the grid (in degrees).
+	///	</summary>
+	DataVector<double> m_dLatDeg;
+};
 
-	// Loop through all times
-	int nTimes = 1;
-	if (dimTime != NULL) {
-		nTimes = dimTime->size();
-	}
-	for (int t = 0; t < nTimes; t++) {
-
-		char szBuffer[20];
-		sprintf(szBuffer, "Time %i", t);
-		AnnounceStartBlock(szBuffer);
-
-		// Get the IWV array
-		if (dimTime != NULL) {
-			varIWV->set_cur(t, 0, 0);
-			varIWV->get(&(dIWV[0][0]), 1, dimLat->size(), dimLon->size());
-		} else {
-			varIWV->set_cur(0, 0);
-			varIWV->get(&(dIWV[0][0]), dimLat->size(), dimLon->size());
-		}
+///////////////////////////////////////////////////////////////////////////////
 
-		AnnounceStartBlock("Compute zonal/meridional thresholds");
+int main(int argc, char** argv) {
 
-		// Compute zonal threshold
-		DataVector<float> dZonalThreshold(dimLat->size());
-		for (int j = 0; j < dimLat->size(); j++) {
-			float dMaxZonalIWV = dIWV[j][0];
-			for (int i = 0; i < dimLon->size(); i++) {
-				dZonalThreshold[j] += dIWV[j][i];
-				if (dIWV[j][i] > dMaxZonalIWV) {
-					dMaxZonalIWV = dIWV[j][i];
-				}
-			}
-			dZonalThreshold[j] /= static_cast<float>(dimLon->size());
+#if defined(TEMPEST_MPIOMP)
+	// Initialize MPI
+	MPI_Init(&argc, &argv);
+#endif
 
-			dZonalThreshold[j] =
-				dZonalMeanWeight * dZonalThreshold[j]
-				+ dZonalMaxWeight * dMaxZonalIWV;
-		}
+	NcError error(NcError::silent_nonfatal);
 
-		// Compute meridional threshold
-		DataVector<float> dMeridThreshold(dimLon->size());
-		for (int i = 0; i < dimLon->size(); i++) {
-			float dMaxMeridIWV = dIWV[0][i];
-			for (int j = 0; j < dimLat->size(); j++) {
-				dMeridThreshold[i] += dIWV[j][i];
-				if (dIWV[j][i] > dMaxMeridIWV) {
-					dMaxMeridIWV = dIWV[j][i];
-				}
-			}
-			dMeridThreshold[i] /= static_cast<float>(dimLon->size());
+	// Enable output only on rank zero
+	AnnounceOnlyOutputOnRankZero();
 
-			dMeridThreshold[i] =
-				dMeridMeanWeight * dMeridThreshold[i]
-				+ dMeridMaxWeight * dMaxMeridIWV;
-		}
+try {
+	// Parameters for JiangARs
+	JiangARsParam arparam;
 
-		// Announce
-		AnnounceEndBlock("Done");
+	// Parameters of the block pipeline
+	ARPipelineParam pipeparam;
 
-		AnnounceStartBlock("Build tagged cell array");
+	// Input file
+	std::string strInputFile;
 
-		// Build tagged cell array
-		dIWVtag.Zero();
+	// Input file list
+	std::string strInputFileList;
 
-		for (int j = 0; j < dimLat->size(); j++) {
-		for (int i = 0; i < dimLon->size(); i++) {
-			if (fabs(dLatDeg[j]) < dMinAbsLat) {
-				continue;
-			}
-			if (dIWV[j][i] < dMinIWV) {
-				continue;
-			}
-			if (dIWV[j][i] < dZonalThreshold[j]) {
-				continue;
-			}
-			if (dIWV[j][i] < dMeridThreshold[i]) {
-				continue;
-			}
+	// Output file
+	std::string strOutputFile;
 
-			dIWVtag[j][i] = 1;
-		}
-		}
+	// Output file list
+	std::string strOutputFileList;
 
-		// Remove points connected with equatorial moisture band
-		for (int i = 0; i < dimLon->size(); i++) {
-			bool fSouthDone = false;
-			bool fNorthDone = false;
-
-			for (int j = 0; j < dimLat->size(); j++) {
-				if ((!fSouthDone) && (dLatDeg[j] > -dMinAbsLat)) {
-					for (int k = j-1; k > 0; k--) {
-						if (dIWVtag[k][i] == 0) {
-							break;
-						}
-						if (dLatDeg[k] < -dEqBandMaxLat) {
-							break;
-						}
-						dIWVtag[k][i] = 0;
-					}
-					fSouthDone = true;
-				}
-				if ((!fNorthDone) && (dLatDeg[j] > dMinAbsLat)) {
-					for (int k = j-1; k < dimLat->size(); k++) {
-						if (dIWVtag[k][i] == 0) {
-							break;
-						}
-						if (dLatDeg[k] > dEqBandMaxLat) {
-							break;
-						}
-						dIWVtag[k][i] = 0;
-					}
-					fNorthDone = true;
-				}
-			}
-		}
+	// Output variable name
+	std::string strOutputVariable;
 
-		AnnounceEndBlock("Done");
+	// Parse the command line
+	BeginCommandLine()
+		CommandLineString(strInputFile, "in", "");
+		CommandLineString(strInputFileList, "inlist", "");
+		CommandLineString(strOutputFile, "out", "");
+		CommandLineString(strOutputFileList, "outlist", "");
+		CommandLineString(pipeparam.strIWVVariable, "iwvvar", "");
+		CommandLineString(strOutputVariable, "outvar", "");
+		CommandLineDouble(arparam.dMinAbsLat, "minabslat", 15.0);
+		CommandLineDouble(arparam.dEqBandMaxLat, "eqbandmaxlat", 15.0);
+		CommandLineDouble(arparam.dMinIWV, "miniwv", 20.0);
+		CommandLineDouble(arparam.dZonalMeanWeight, "zonalmeanwt", 0.7);
+		CommandLineDouble(arparam.dZonalMaxWeight, "zonalmaxwt", 0.3);
+		CommandLineDouble(arparam.dMeridMeanWeight, "meridmeanwt", 0.9);
+		CommandLineDouble(arparam.dMeridMaxWeight, "meridmaxwt", 0.1);
+		CommandLineInt(pipeparam.nTimeBlock, "timeblock", 8);
+		CommandLineBool(pipeparam.fObjects, "objects");
+		CommandLineBool(pipeparam.objparam.fRegional, "regional");
+		CommandLineDouble(pipeparam.objparam.dMinArea, "minarea", 0.0);
+		CommandLineDouble(pipeparam.objparam.dMinLength, "minlength", 0.0);
+		CommandLineDouble(pipeparam.objparam.dMinAspect, "minaspect", 0.0);
+		CommandLineDouble(pipeparam.objparam.dMinAbsOrientation, "minabsorient", 0.0);
+		CommandLineDouble(pipeparam.objparam.dMaxAbsOrientation, "maxabsorient", 90.0);
+		CommandLineBool(pipeparam.objparam.fLinkTime, "linktime");
 
-		AnnounceStartBlock("Writing results");
+		ParseCommandLine(argc, argv);
+	EndCommandLine(argv)
 
-		// Output tagged cell array
-		if (dimTime != NULL) {
-			varIWVtag->set_cur(t, 0, 0);
-			varIWVtag->put(&(dIWVtag[0][0]), 1, dimLatOut->size(), dimLonOut->size());
-		} else {
-			varIWVtag->set_cur(0, 0);
-			varIWVtag->put(&(dIWVtag[0][0]), dimLatOut->size(), dimLonOut->size());
-		}
+	AnnounceBanner();
 
-		AnnounceEndBlock("Done");
+	// Check variable
+	if (pipeparam.strIWVVariable == "") {
+		_EXCEPTIONT("No IWV variable name (--iwvvar) specified");
+	}
 
-		AnnounceEndBlock(NULL);
+	// Check output variable
+	if (strOutputVariable.length() == 0) {
+		strOutputVariable = pipeparam.strIWVVariable + "tag";
 	}
 
-	AnnounceEndBlock("Done");
+	// Tag all files
+	JiangARsTagger tagger(arparam);
+
+	ARTagFiles(
+		strInputFile,
+		strInputFileList,
+		strOutputFile,
+		strOutputFileList,
+		pipeparam,
+		tagger);
 
 	AnnounceBanner();
 
 } catch(Exception & e) {
 	Announce(e.ToString().c_str());
 }
+
+#if defined(TEMPEST_MPIOMP)
+	// Deinitialize MPI
+	MPI_Finalize();
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////////
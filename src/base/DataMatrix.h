@@ -78,6 +78,22 @@ class DataMatrix {
 			Assign(dm);
 		}
 
+		///	<summary>
+		///		Move constructor.  Ownership of the data of dm is transferred
+		///		to this object and dm is left uninitialized.
+		///	</summary>
+		DataMatrix(
+			DataMatrix<DataType> && dm
+		) noexcept :
+			m_sRows(dm.m_sRows),
+			m_sColumns(dm.m_sColumns),
+			m_data(dm.m_data)
+		{
+			dm.m_sRows = 0;
+			dm.m_sColumns = 0;
+			dm.m_data = NULL;
+		}
+
 		///	<summary>
 		///		Destructor.
 		///	</summary>
@@ -217,6 +233,24 @@ class DataMatrix {
 			return (*this);
 		}
 
+		///	<summary>
+		///		Move assignment operator.
+		///	</summary>
+		DataMatrix & operator= (DataMatrix<DataType> && dm) noexcept {
+			if (this != &dm) {
+				Deinitialize();
+
+				m_sRows = dm.m_sRows;
+				m_sColumns = dm.m_sColumns;
+				m_data = dm.m_data;
+
+				dm.m_sRows = 0;
+				dm.m_sColumns = 0;
+				dm.m_data = NULL;
+			}
+			return (*this);
+		}
+
 		///	<summary>
 		///		Zero the data content of this object.
 		///	</summary>
@@ -266,6 +300,49 @@ class DataMatrix {
 			return m_data;
 		}
 
+	public:
+		///	<summary>
+		///		Pointer to the first element of the contiguous data block.
+		///		Element (i,j) is located at offset i * GetColumns() + j.
+		///		Returns NULL if this DataMatrix is not initialized.
+		///	</summary>
+		inline DataType * GetData() {
+			if (!IsInitialized()) {
+				return NULL;
+			}
+			return m_data[0];
+		}
+
+		///	<summary>
+		///		Pointer to the first element of the contiguous data block.
+		///	</summary>
+		inline const DataType * GetData() const {
+			if (!IsInitialized()) {
+				return NULL;
+			}
+			return m_data[0];
+		}
+
+		///	<summary>
+		///		Element access without the row pointer lookup.
+		///	</summary>
+		inline DataType & operator()(
+			unsigned int i,
+			unsigned int j
+		) {
+			return m_data[0][static_cast<size_t>(i) * m_sColumns + j];
+		}
+
+		///	<summary>
+		///		Element access without the row pointer lookup.
+		///	</summary>
+		inline const DataType & operator()(
+			unsigned int i,
+			unsigned int j
+		) const {
+			return m_data[0][static_cast<size_t>(i) * m_sColumns + j];
+		}
+
 	public:
 		///	<summary>
 		///		Give a string representation of this object.
@@ -90,6 +90,27 @@ class DataMatrix3D {
 			}
 		}
 
+		///	<summary>
+		///		Move constructor.  Ownership (or attachment) of the data of dm
+		///		is transferred to this object and dm is left uninitialized.
+		///	</summary>
+		DataMatrix3D(
+			DataMatrix3D<DataType> && dm
+		) noexcept :
+			m_fAttached(dm.m_fAttached),
+			m_data(dm.m_data)
+		{
+			m_sSize[0] = dm.m_sSize[0];
+			m_sSize[1] = dm.m_sSize[1];
+			m_sSize[2] = dm.m_sSize[2];
+
+			dm.m_fAttached = false;
+			dm.m_sSize[0] = 0;
+			dm.m_sSize[1] = 0;
+			dm.m_sSize[2] = 0;
+			dm.m_data = NULL;
+		}
+
 		///	<summary>
 		///		Attach constructor.
 		///	</summary>
@@ -127,6 +148,14 @@ class DataMatrix3D {
 			}
 		}
 
+		///	<summary>
+		///		Determine if this DataMatrix3D is attached to an external
+		///		array (otherwise its data is stored contiguously).
+		///	</summary>
+		bool IsAttached() const {
+			return m_fAttached;
+		}
+
 	public:
 		///	<summary>
 		///		Deallocate data for this object.
@@ -293,6 +322,33 @@ class DataMatrix3D {
 			return (*this);
 		}
 
+		///	<summary>
+		///		Move assignment operator.  If this DataMatrix3D is attached
+		///		it is detached from its external storage (which is left
+		///		unchanged) and takes over the data of dm.
+		///	</summary>
+		DataMatrix3D & operator= (DataMatrix3D<DataType> && dm) noexcept {
+			if (this == &dm) {
+				return (*this);
+			}
+
+			Deinitialize();
+
+			m_fAttached = dm.m_fAttached;
+			m_sSize[0] = dm.m_sSize[0];
+			m_sSize[1] = dm.m_sSize[1];
+			m_sSize[2] = dm.m_sSize[2];
+			m_data = dm.m_data;
+
+			dm.m_fAttached = false;
+			dm.m_sSize[0] = 0;
+			dm.m_sSize[1] = 0;
+			dm.m_sSize[2] = 0;
+			dm.m_data = NULL;
+
+			return (*this);
+		}
+
 		///	<summary>
 		///		Zero the data content of this object.
 		///	</summary>
@@ -378,6 +434,81 @@ class DataMatrix3D {
 			return m_data;
 		}
 
+	public:
+		///	<summary>
+		///		Pointer to the first element of the contiguous data block.
+		///		Element (i,j,k) is located at offset
+		///		(i * GetColumns() + j) * GetSubColumns() + k.  Returns NULL if
+		///		this DataMatrix3D is not initialized.
+		///	</summary>
+		///	<warning>
+		///		Only valid if the data is stored contiguously, which is always
+		///		the case unless this object is attached to an external array.
+		///	</warning>
+		inline DataType * GetData() {
+			if (!IsInitialized()) {
+				return NULL;
+			}
+			return m_data[0][0];
+		}
+
+		///	<summary>
+		///		Pointer to the first element of the contiguous data block.
+		///	</summary>
+		inline const DataType * GetData() const {
+			if (!IsInitialized()) {
+				return NULL;
+			}
+			return m_data[0][0];
+		}
+
+		///	<summary>
+		///		Pointer to the first element of row (i,j), which holds
+		///		GetSubColumns() contiguous elements.
+		///	</summary>
+		inline DataType * GetRow(
+			unsigned int i,
+			unsigned int j
+		) {
+			return m_data[0][0]
+				+ (static_cast<size_t>(i) * m_sSize[1] + j) * m_sSize[2];
+		}
+
+		///	<summary>
+		///		Pointer to the first element of row (i,j).
+		///	</summary>
+		inline const DataType * GetRow(
+			unsigned int i,
+			unsigned int j
+		) const {
+			return m_data[0][0]
+				+ (static_cast<size_t>(i) * m_sSize[1] + j) * m_sSize[2];
+		}
+
+		///	<summary>
+		///		Element access without pointer table lookups.
+		///	</summary>
+		inline DataType & operator()(
+			unsigned int i,
+			unsigned int j,
+			unsigned int k
+		) {
+			return m_data[0][0][
+				(static_cast<size_t>(i) * m_sSize[1] + j) * m_sSize[2] + k];
+		}
+
+		///	<summary>
+		///		Element access without pointer table lookups.
+		///	</summary>
+		inline const DataType & operator()(
+			unsigned int i,
+			unsigned int j,
+			unsigned int k
+		) const {
+			return m_data[0][0][
+				(static_cast<size_t>(i) * m_sSize[1] + j) * m_sSize[2] + k];
+		}
+
 	private:
 		///	<summary>
 		///		Flag indicating that this DataMatrix3D is attached to an
@@ -81,6 +81,25 @@ class DataMatrix4D {
 			Assign(dm);
 		}
 
+		///	<summary>
+		///		Move constructor.  Ownership of the data of dm is transferred
+		///		to this object and dm is left uninitialized.
+		///	</summary>
+		DataMatrix4D(DataMatrix4D<DataType> && dm) noexcept
+			: m_data(dm.m_data)
+		{
+			m_sSize[0] = dm.m_sSize[0];
+			m_sSize[1] = dm.m_sSize[1];
+			m_sSize[2] = dm.m_sSize[2];
+			m_sSize[3] = dm.m_sSize[3];
+
+			dm.m_sSize[0] = 0;
+			dm.m_sSize[1] = 0;
+			dm.m_sSize[2] = 0;
+			dm.m_sSize[3] = 0;
+			dm.m_data = NULL;
+		}
+
 		///	<summary>
 		///		Destructor.
 		///	</summary>
@@ -262,6 +281,28 @@ class DataMatrix4D {
 			return (*this);
 		}
 
+		///	<summary>
+		///		Move assignment operator.
+		///	</summary>
+		DataMatrix4D & operator= (DataMatrix4D<DataType> && dm) noexcept {
+			if (this != &dm) {
+				Deinitialize();
+
+				m_sSize[0] = dm.m_sSize[0];
+				m_sSize[1] = dm.m_sSize[1];
+				m_sSize[2] = dm.m_sSize[2];
+				m_sSize[3] = dm.m_sSize[3];
+				m_data = dm.m_data;
+
+				dm.m_sSize[0] = 0;
+				dm.m_sSize[1] = 0;
+				dm.m_sSize[2] = 0;
+				dm.m_sSize[3] = 0;
+				dm.m_data = NULL;
+			}
+			return (*this);
+		}
+
 		///	<summary>
 		///		Zero the data content of this object.
 		///	</summary>
@@ -312,6 +353,85 @@ class DataMatrix4D {
 			return m_data;
 		}
 
+	public:
+		///	<summary>
+		///		Pointer to the first element of the contiguous data block.
+		///		Element (i,j,k,l) is located at offset
+		///		((i * GetSize(1) + j) * GetSize(2) + k) * GetSize(3) + l.
+		///		Returns NULL if this DataMatrix4D is not initialized.
+		///	</summary>
+		inline DataType * GetData() {
+			if (!IsInitialized()) {
+				return NULL;
+			}
+			return m_data[0][0][0];
+		}
+
+		///	<summary>
+		///		Pointer to the first element of the contiguous data block.
+		///	</summary>
+		inline const DataType * GetData() const {
+			if (!IsInitialized()) {
+				return NULL;
+			}
+			return m_data[0][0][0];
+		}
+
+		///	<summary>
+		///		Pointer to the first element of row (i,j,k), which holds
+		///		GetSize(3) contiguous elements.
+		///	</summary>
+		inline DataType * GetRow(
+			unsigned int i,
+			unsigned int j,
+			unsigned int k
+		) {
+			return m_data[0][0][0]
+				+ ((static_cast<size_t>(i) * m_sSize[1] + j) * m_sSize[2] + k)
+				* m_sSize[3];
+		}
+
+		///	<summary>
+		///		Pointer to the first element of row (i,j,k).
+		///	</summary>
+		inline const DataType * GetRow(
+			unsigned int i,
+			unsigned int j,
+			unsigned int k
+		) const {
+			return m_data[0][0][0]
+				+ ((static_cast<size_t>(i) * m_sSize[1] + j) * m_sSize[2] + k)
+				* m_sSize[3];
+		}
+
+		///	<summary>
+		///		Element access without pointer table lookups.
+		///	</summary>
+		inline DataType & operator()(
+			unsigned int i,
+			unsigned int j,
+			unsigned int k,
+			unsigned int l
+		) {
+			return m_data[0][0][0][
+				((static_cast<size_t>(i) * m_sSize[1] + j) * m_sSize[2] + k)
+				* m_sSize[3] + l];
+		}
+
+		///	<summary>
+		///		Element access without pointer table lookups.
+		///	</summary>
+		inline const DataType & operator()(
+			unsigned int i,
+			unsigned int j,
+			unsigned int k,
+			unsigned int l
+		) const {
+			return m_data[0][0][0][
+				((static_cast<size_t>(i) * m_sSize[1] + j) * m_sSize[2] + k)
+				* m_sSize[3] + l];
+		}
+
 	private:
 		///	<summary>
 		///		The number of elements in each dimension of this matrix.
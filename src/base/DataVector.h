@@ -74,6 +74,20 @@ class DataVector {
 			Assign(dv);
 		}
 
+		///	<summary>
+		///		Move constructor.  Ownership of the data of dv is transferred
+		///		to this object and dv is left uninitialized.
+		///	</summary>
+		DataVector(
+			DataVector<DataType> && dv
+		) noexcept :
+			m_sRows(dv.m_sRows),
+			m_data(dv.m_data)
+		{
+			dv.m_sRows = 0;
+			dv.m_data = NULL;
+		}
+
 		///	<summary>
 		///		Destructor.
 		///	</summary>
@@ -180,6 +194,22 @@ class DataVector {
 			return (*this);
 		}
 
+		///	<summary>
+		///		Move assignment operator.
+		///	</summary>
+		DataVector & operator= (DataVector<DataType> && dv) noexcept {
+			if (this != &dv) {
+				Deinitialize();
+
+				m_sRows = dv.m_sRows;
+				m_data = dv.m_data;
+
+				dv.m_sRows = 0;
+				dv.m_data = NULL;
+			}
+			return (*this);
+		}
+
 		///	<summary>
 		///		Zero the data content of this object.
 		///	</summary>
@@ -0,0 +1,625 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    DataView.h
+///
+///	<remarks>
+///		Copyright 2000-2010 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _DATAVIEW_H_
+#define _DATAVIEW_H_
+
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DataVector.h"
+#include "DataMatrix.h"
+#include "DataMatrix3D.h"
+#include "DataMatrix4D.h"
+#include "Exception.h"
+
+#include <cstddef>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A read-only, non-owning view of a 1D array of data with an arbitrary
+///		element stride.  Views are cheap to copy and are intended to be
+///		passed by value in place of a const reference to the container.
+///	</summary>
+///	<warning>
+///		A view does not extend the lifetime of the data it refers to.
+///	</warning>
+
+template <typename DataType>
+class DataVectorView {
+
+	public:
+		///	<summary>
+		///		Default constructor.
+		///	</summary>
+		DataVectorView() :
+			m_data(NULL),
+			m_sSize(0),
+			m_dStride(1)
+		{ }
+
+		///	<summary>
+		///		Constructor from a raw pointer.
+		///	</summary>
+		DataVectorView(
+			const DataType * data,
+			unsigned int sSize,
+			std::ptrdiff_t dStride = 1
+		) :
+			m_data(data),
+			m_sSize(sSize),
+			m_dStride(dStride)
+		{ }
+
+		///	<summary>
+		///		Construct a view of an entire DataVector.
+		///	</summary>
+		DataVectorView(
+			const DataVector<DataType> & vec
+		) :
+			m_data(static_cast<const DataType *>(vec)),
+			m_sSize(vec.GetRows()),
+			m_dStride(1)
+		{ }
+
+	public:
+		///	<summary>
+		///		Get the number of elements in this view.
+		///	</summary>
+		inline unsigned int GetRows() const {
+			return m_sSize;
+		}
+
+		///	<summary>
+		///		Get the distance between consecutive elements.
+		///	</summary>
+		inline std::ptrdiff_t GetStride() const {
+			return m_dStride;
+		}
+
+		///	<summary>
+		///		Determine if the elements of this view are contiguous.
+		///	</summary>
+		inline bool IsContiguous() const {
+			return (m_dStride == 1);
+		}
+
+		///	<summary>
+		///		Pointer to the first element of this view.
+		///	</summary>
+		inline const DataType * GetData() const {
+			return m_data;
+		}
+
+	public:
+		///	<summary>
+		///		Element access.
+		///	</summary>
+		inline const DataType & operator[](unsigned int i) const {
+			return m_data[i * m_dStride];
+		}
+
+		///	<summary>
+		///		Element access.
+		///	</summary>
+		inline const DataType & operator()(unsigned int i) const {
+			return m_data[i * m_dStride];
+		}
+
+		///	<summary>
+		///		View of the sCount elements starting at sBegin.
+		///	</summary>
+		DataVectorView<DataType> Subview(
+			unsigned int sBegin,
+			unsigned int sCount
+		) const {
+			if (sBegin + sCount > m_sSize) {
+				_EXCEPTIONT("Subview out of range.");
+			}
+			return DataVectorView<DataType>(
+				m_data + sBegin * m_dStride, sCount, m_dStride);
+		}
+
+	private:
+		///	<summary>
+		///		Pointer to the first element.
+		///	</summary>
+		const DataType * m_data;
+
+		///	<summary>
+		///		Number of elements.
+		///	</summary>
+		unsigned int m_sSize;
+
+		///	<summary>
+		///		Distance (in elements) between consecutive elements.
+		///	</summary>
+		std::ptrdiff_t m_dStride;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A read-only, non-owning view of a 2D array of data with arbitrary
+///		strides along each dimension.
+///	</summary>
+
+template <typename DataType>
+class DataMatrixView {
+
+	public:
+		///	<summary>
+		///		Default constructor.
+		///	</summary>
+		DataMatrixView() :
+			m_data(NULL)
+		{
+			m_sSize[0] = 0;
+			m_sSize[1] = 0;
+			m_dStride[0] = 0;
+			m_dStride[1] = 1;
+		}
+
+		///	<summary>
+		///		Constructor from a raw pointer.
+		///	</summary>
+		DataMatrixView(
+			const DataType * data,
+			unsigned int sRows,
+			unsigned int sColumns,
+			std::ptrdiff_t dRowStride,
+			std::ptrdiff_t dColumnStride = 1
+		) :
+			m_data(data)
+		{
+			m_sSize[0] = sRows;
+			m_sSize[1] = sColumns;
+			m_dStride[0] = dRowStride;
+			m_dStride[1] = dColumnStride;
+		}
+
+		///	<summary>
+		///		Construct a view of an entire DataMatrix.
+		///	</summary>
+		DataMatrixView(
+			const DataMatrix<DataType> & mat
+		) :
+			m_data(NULL)
+		{
+			m_sSize[0] = mat.GetRows();
+			m_sSize[1] = mat.GetColumns();
+			m_dStride[0] = mat.GetColumns();
+			m_dStride[1] = 1;
+			if (mat.IsInitialized()) {
+				m_data = &(mat[0][0]);
+			}
+		}
+
+	public:
+		///	<summary>
+		///		Get the number of rows in this view.
+		///	</summary>
+		inline unsigned int GetRows() const {
+			return m_sSize[0];
+		}
+
+		///	<summary>
+		///		Get the number of columns in this view.
+		///	</summary>
+		inline unsigned int GetColumns() const {
+			return m_sSize[1];
+		}
+
+		///	<summary>
+		///		Get the number of elements along the specified dimension.
+		///	</summary>
+		inline unsigned int GetSize(int dim) const {
+			return m_sSize[dim];
+		}
+
+		///	<summary>
+		///		Get the stride along the specified dimension.
+		///	</summary>
+		inline std::ptrdiff_t GetStride(int dim) const {
+			return m_dStride[dim];
+		}
+
+		///	<summary>
+		///		Determine if the elements of this view are contiguous.
+		///	</summary>
+		inline bool IsContiguous() const {
+			return ((m_dStride[1] == 1) &&
+				(m_dStride[0] == static_cast<std::ptrdiff_t>(m_sSize[1])));
+		}
+
+		///	<summary>
+		///		Pointer to the first element of this view.
+		///	</summary>
+		inline const DataType * GetData() const {
+			return m_data;
+		}
+
+	public:
+		///	<summary>
+		///		Element access.
+		///	</summary>
+		inline const DataType & operator()(
+			unsigned int i,
+			unsigned int j
+		) const {
+			return m_data[i * m_dStride[0] + j * m_dStride[1]];
+		}
+
+		///	<summary>
+		///		View of a single row.
+		///	</summary>
+		inline DataVectorView<DataType> operator[](unsigned int i) const {
+			return DataVectorView<DataType>(
+				m_data + i * m_dStride[0], m_sSize[1], m_dStride[1]);
+		}
+
+		///	<summary>
+		///		View of the sCount rows starting at sBegin.
+		///	</summary>
+		DataMatrixView<DataType> Subview(
+			unsigned int sBegin,
+			unsigned int sCount
+		) const {
+			if (sBegin + sCount > m_sSize[0]) {
+				_EXCEPTIONT("Subview out of range.");
+			}
+			return DataMatrixView<DataType>(
+				m_data + sBegin * m_dStride[0],
+				sCount, m_sSize[1], m_dStride[0], m_dStride[1]);
+		}
+
+	private:
+		///	<summary>
+		///		Pointer to the first element.
+		///	</summary>
+		const DataType * m_data;
+
+		///	<summary>
+		///		Number of elements along each dimension.
+		///	</summary>
+		unsigned int m_sSize[2];
+
+		///	<summary>
+		///		Distance (in elements) between consecutive entries along
+		///		each dimension.
+		///	</summary>
+		std::ptrdiff_t m_dStride[2];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A read-only, non-owning view of a 3D array of data with arbitrary
+///		strides along each dimension.
+///	</summary>
+
+template <typename DataType>
+class DataMatrix3DView {
+
+	public:
+		///	<summary>
+		///		Default constructor.
+		///	</summary>
+		DataMatrix3DView() :
+			m_data(NULL)
+		{
+			for (int d = 0; d < 3; d++) {
+				m_sSize[d] = 0;
+				m_dStride[d] = 0;
+			}
+		}
+
+		///	<summary>
+		///		Constructor from a raw pointer.
+		///	</summary>
+		DataMatrix3DView(
+			const DataType * data,
+			unsigned int sRows,
+			unsigned int sColumns,
+			unsigned int sSubColumns,
+			std::ptrdiff_t dRowStride,
+			std::ptrdiff_t dColumnStride,
+			std::ptrdiff_t dSubColumnStride = 1
+		) :
+			m_data(data)
+		{
+			m_sSize[0] = sRows;
+			m_sSize[1] = sColumns;
+			m_sSize[2] = sSubColumns;
+			m_dStride[0] = dRowStride;
+			m_dStride[1] = dColumnStride;
+			m_dStride[2] = dSubColumnStride;
+		}
+
+		///	<summary>
+		///		Construct a view of an entire DataMatrix3D.  Strides of an
+		///		attached DataMatrix3D are obtained from its row pointers, so
+		///		it need not be contiguous, but its rows must be equally
+		///		spaced in memory.
+		///	</summary>
+		DataMatrix3DView(
+			const DataMatrix3D<DataType> & mat
+		) :
+			m_data(NULL)
+		{
+			m_sSize[0] = mat.GetRows();
+			m_sSize[1] = mat.GetColumns();
+			m_sSize[2] = mat.GetSubColumns();
+			m_dStride[0] = m_sSize[1] * m_sSize[2];
+			m_dStride[1] = m_sSize[2];
+			m_dStride[2] = 1;
+
+			if (!mat.IsInitialized()) {
+				return;
+			}
+
+			m_data = &(mat[0][0][0]);
+
+			if (!mat.IsAttached()) {
+				return;
+			}
+
+			if (m_sSize[0] > 1) {
+				m_dStride[0] = mat[1][0] - mat[0][0];
+			}
+			if (m_sSize[1] > 1) {
+				m_dStride[1] = mat[0][1] - mat[0][0];
+			}
+
+			for (unsigned int i = 0; i < m_sSize[0]; i++) {
+			for (unsigned int j = 0; j < m_sSize[1]; j++) {
+				if (mat[i][j] !=
+					m_data + i * m_dStride[0] + j * m_dStride[1]
+				) {
+					_EXCEPTIONT("DataMatrix3D rows are not equally spaced "
+						"in memory and cannot be viewed.");
+				}
+			}
+			}
+		}
+
+	public:
+		///	<summary>
+		///		Get the number of rows in this view.
+		///	</summary>
+		inline unsigned int GetRows() const {
+			return m_sSize[0];
+		}
+
+		///	<summary>
+		///		Get the number of columns in this view.
+		///	</summary>
+		inline unsigned int GetColumns() const {
+			return m_sSize[1];
+		}
+
+		///	<summary>
+		///		Get the number of subcolumns in this view.
+		///	</summary>
+		inline unsigned int GetSubColumns() const {
+			return m_sSize[2];
+		}
+
+		///	<summary>
+		///		Get the number of elements along the specified dimension.
+		///	</summary>
+		inline unsigned int GetSize(int dim) const {
+			return m_sSize[dim];
+		}
+
+		///	<summary>
+		///		Get the stride along the specified dimension.
+		///	</summary>
+		inline std::ptrdiff_t GetStride(int dim) const {
+			return m_dStride[dim];
+		}
+
+		///	<summary>
+		///		Determine if the elements of this view are contiguous, in
+		///		which case element (i,j,k) is located at offset
+		///		(i * GetColumns() + j) * GetSubColumns() + k of GetData().
+		///	</summary>
+		inline bool IsContiguous() const {
+			return ((m_dStride[2] == 1) &&
+				(m_dStride[1] == static_cast<std::ptrdiff_t>(m_sSize[2])) &&
+				(m_dStride[0] ==
+					static_cast<std::ptrdiff_t>(m_sSize[1]) * m_sSize[2]));
+		}
+
+		///	<summary>
+		///		Pointer to the first element of this view.
+		///	</summary>
+		inline const DataType * GetData() const {
+			return m_data;
+		}
+
+	public:
+		///	<summary>
+		///		Element access.
+		///	</summary>
+		inline const DataType & operator()(
+			unsigned int i,
+			unsigned int j,
+			unsigned int k
+		) const {
+			return m_data[
+				i * m_dStride[0] + j * m_dStride[1] + k * m_dStride[2]];
+		}
+
+		///	<summary>
+		///		View of a single 2D slice along the first dimension.
+		///	</summary>
+		inline DataMatrixView<DataType> operator[](unsigned int i) const {
+			return DataMatrixView<DataType>(
+				m_data + i * m_dStride[0],
+				m_sSize[1], m_sSize[2],
+				m_dStride[1], m_dStride[2]);
+		}
+
+		///	<summary>
+		///		View of the sCount entries starting at sBegin along the
+		///		specified dimension, leaving the other dimensions intact.
+		///	</summary>
+		DataMatrix3DView<DataType> Subview(
+			int dim,
+			unsigned int sBegin,
+			unsigned int sCount
+		) const {
+			if ((dim < 0) || (dim > 2)) {
+				_EXCEPTIONT("Invalid dimension.");
+			}
+			if (sBegin + sCount > m_sSize[dim]) {
+				_EXCEPTIONT("Subview out of range.");
+			}
+			DataMatrix3DView<DataType> view(*this);
+			view.m_data += sBegin * m_dStride[dim];
+			view.m_sSize[dim] = sCount;
+			return view;
+		}
+
+	private:
+		///	<summary>
+		///		Pointer to the first element.
+		///	</summary>
+		const DataType * m_data;
+
+		///	<summary>
+		///		Number of elements along each dimension.
+		///	</summary>
+		unsigned int m_sSize[3];
+
+		///	<summary>
+		///		Distance (in elements) between consecutive entries along
+		///		each dimension.
+		///	</summary>
+		std::ptrdiff_t m_dStride[3];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A read-only, non-owning view of a 4D array of data with arbitrary
+///		strides along each dimension.
+///	</summary>
+
+template <typename DataType>
+class DataMatrix4DView {
+
+	public:
+		///	<summary>
+		///		Default constructor.
+		///	</summary>
+		DataMatrix4DView() :
+			m_data(NULL)
+		{
+			for (int d = 0; d < 4; d++) {
+				m_sSize[d] = 0;
+				m_dStride[d] = 0;
+			}
+		}
+
+		///	<summary>
+		///		Construct a view of an entire DataMatrix4D.
+		///	</summary>
+		DataMatrix4DView(
+			const DataMatrix4D<DataType> & mat
+		) :
+			m_data(NULL)
+		{
+			for (int d = 0; d < 4; d++) {
+				m_sSize[d] = mat.GetSize(d);
+			}
+			m_dStride[3] = 1;
+			m_dStride[2] = m_sSize[3];
+			m_dStride[1] = m_sSize[2] * m_dStride[2];
+			m_dStride[0] = m_sSize[1] * m_dStride[1];
+			if (mat.IsInitialized()) {
+				m_data = &(mat[0][0][0][0]);
+			}
+		}
+
+	public:
+		///	<summary>
+		///		Get the number of elements along the specified dimension.
+		///	</summary>
+		inline unsigned int GetSize(int dim) const {
+			return m_sSize[dim];
+		}
+
+		///	<summary>
+		///		Get the stride along the specified dimension.
+		///	</summary>
+		inline std::ptrdiff_t GetStride(int dim) const {
+			return m_dStride[dim];
+		}
+
+		///	<summary>
+		///		Pointer to the first element of this view.
+		///	</summary>
+		inline const DataType * GetData() const {
+			return m_data;
+		}
+
+	public:
+		///	<summary>
+		///		Element access.
+		///	</summary>
+		inline const DataType & operator()(
+			unsigned int i,
+			unsigned int j,
+			unsigned int k,
+			unsigned int l
+		) const {
+			return m_data[
+				i * m_dStride[0] + j * m_dStride[1]
+				+ k * m_dStride[2] + l * m_dStride[3]];
+		}
+
+		///	<summary>
+		///		View of a single 3D slice along the first dimension.
+		///	</summary>
+		inline DataMatrix3DView<DataType> operator[](unsigned int i) const {
+			return DataMatrix3DView<DataType>(
+				m_data + i * m_dStride[0],
+				m_sSize[1], m_sSize[2], m_sSize[3],
+				m_dStride[1], m_dStride[2], m_dStride[3]);
+		}
+
+	private:
+		///	<summary>
+		///		Pointer to the first element.
+		///	</summary>
+		const DataType * m_data;
+
+		///	<summary>
+		///		Number of elements along each dimension.
+		///	</summary>
+		unsigned int m_sSize[4];
+
+		///	<summary>
+		///		Distance (in elements) between consecutive entries along
+		///		each dimension.
+		///	</summary>
+		std::ptrdiff_t m_dStride[4];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
+
@@ -18,6 +18,7 @@
 #include "Exception.h"
 #include "DataVector.h"
 #include "netcdfcpp.h"
+#include "netcdf.h"
 
 #include <vector>
 
@@ -281,4 +282,47 @@ void CopyNcVar(
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void SetNcVarCompression(
+	NcFile & ncFile,
+	NcVar * var,
+	int iDeflateLevel,
+	bool fShuffle,
+	const std::vector<size_t> & vecChunkSizes
+) {
+	if (var == NULL) {
+		_EXCEPTIONT("Invalid variable specified");
+	}
+	if ((iDeflateLevel < 0) || (iDeflateLevel > 9)) {
+		_EXCEPTION1("Deflate level must be between 0 and 9 (given %i)",
+			iDeflateLevel);
+	}
+	if (vecChunkSizes.size() != var->num_dims()) {
+		_EXCEPTION2("Chunk sizes (%i) do not match dimensions of \"%s\"",
+			static_cast<int>(vecChunkSizes.size()), var->name());
+	}
+
+	int iNcErr =
+		nc_def_var_chunking(
+			ncFile.id(), var->id(), NC_CHUNKED, &(vecChunkSizes[0]));
+
+	if (iNcErr != NC_NOERR) {
+		_EXCEPTION2("Unable to set chunking for \"%s\" (%s)",
+			var->name(), nc_strerror(iNcErr));
+	}
+
+	if (iDeflateLevel == 0) {
+		return;
+	}
+
+	iNcErr =
+		nc_def_var_deflate(
+			ncFile.id(), var->id(), (fShuffle)?(1):(0), 1, iDeflateLevel);
+
+	if (iNcErr != NC_NOERR) {
+		_EXCEPTION2("Unable to set compression for \"%s\" (%s)",
+			var->name(), nc_strerror(iNcErr));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
 
@@ -21,6 +21,8 @@ class NcFile;
 class NcVar;
 
 #include <string>
+#include <vector>
+#include <cstddef>
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -47,5 +49,20 @@ void CopyNcVar(
 
 ////////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		Enable chunking and deflate compression for a variable in a
+///		NetCDF-4 file.  This must be called before data is written to the
+///		variable.  A deflate level of zero only applies chunking.
+///	</summary>
+void SetNcVarCompression(
+	NcFile & ncFile,
+	NcVar * var,
+	int iDeflateLevel,
+	bool fShuffle,
+	const std::vector<size_t> & vecChunkSizes
+);
+
+////////////////////////////////////////////////////////////////////////////////
+
 #endif
 
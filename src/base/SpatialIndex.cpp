@@ -0,0 +1,291 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    SpatialIndex.cpp
+///
+///	<remarks>
+///		Copyright 2000-2014 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "SpatialIndex.h"
+#include "Exception.h"
+
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Comparator for ordering nodes along one axis (ties are broken by
+///		index so that the tree does not depend on the sort implementation).
+///	</summary>
+template <typename NodeType>
+struct SpatialIndexAxisLess {
+
+	int m_iAxis;
+
+	SpatialIndexAxisLess(int iAxis) :
+		m_iAxis(iAxis)
+	{ }
+
+	bool operator()(const NodeType & a, const NodeType & b) const {
+		if (a.x[m_iAxis] != b.x[m_iAxis]) {
+			return (a.x[m_iAxis] < b.x[m_iAxis]);
+		}
+		return (a.ix < b.ix);
+	}
+};
+
+///	<summary>
+///		An entry on the stack of subtrees that remain to be searched.
+///	</summary>
+struct SpatialIndexStackEntry {
+	int iBegin;
+	int iEnd;
+	int iAxis;
+	double dBoundSq;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SpatialIndex::Build(
+	const double * dX,
+	const double * dY,
+	const double * dZ,
+	int nPoints
+) {
+	if (nPoints < 0) {
+		_EXCEPTIONT("Number of points must be nonnegative");
+	}
+
+	m_nPoints = nPoints;
+	m_vecNodes.resize(nPoints);
+
+	for (int i = 0; i < nPoints; i++) {
+		m_vecNodes[i].x[0] = dX[i];
+		m_vecNodes[i].x[1] = dY[i];
+		m_vecNodes[i].x[2] = dZ[i];
+		m_vecNodes[i].ix = i;
+	}
+
+	BuildRecurse(0, nPoints, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SpatialIndex::BuildRecurse(
+	int iBegin,
+	int iEnd,
+	int iAxis
+) {
+	if (iEnd - iBegin <= 1) {
+		return;
+	}
+
+	int iMid = (iBegin + iEnd) / 2;
+
+	std::nth_element(
+		m_vecNodes.begin() + iBegin,
+		m_vecNodes.begin() + iMid,
+		m_vecNodes.begin() + iEnd,
+		SpatialIndexAxisLess<Node>(iAxis));
+
+	int iNextAxis = (iAxis + 1) % 3;
+
+	BuildRecurse(iBegin, iMid, iNextAxis);
+	BuildRecurse(iMid + 1, iEnd, iNextAxis);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int SpatialIndex::Nearest(
+	double dX,
+	double dY,
+	double dZ,
+	double * pdDistSq
+) const {
+	if (m_nPoints == 0) {
+		return (-1);
+	}
+
+	const double dPos[3] = {dX, dY, dZ};
+
+	int iBest = (-1);
+	int ixBest = (-1);
+	double dBestSq = 0.0;
+
+	SpatialIndexStackEntry stack[2 * MaxDepth];
+	int nStack = 0;
+
+	stack[0].iBegin = 0;
+	stack[0].iEnd = m_nPoints;
+	stack[0].iAxis = 0;
+	stack[0].dBoundSq = 0.0;
+	nStack = 1;
+
+	while (nStack != 0) {
+		const SpatialIndexStackEntry entry = stack[--nStack];
+
+		if (entry.iBegin >= entry.iEnd) {
+			continue;
+		}
+
+		// Subtree cannot contain a closer point (points at the same
+		// distance may still have a smaller index)
+		if ((iBest != (-1)) && (entry.dBoundSq > dBestSq)) {
+			continue;
+		}
+
+		int iMid = (entry.iBegin + entry.iEnd) / 2;
+		const Node & node = m_vecNodes[iMid];
+
+		double dDX = node.x[0] - dPos[0];
+		double dDY = node.x[1] - dPos[1];
+		double dDZ = node.x[2] - dPos[2];
+		double dDistSq = dDX * dDX + dDY * dDY + dDZ * dDZ;
+
+		if ((iBest == (-1)) ||
+		    (dDistSq < dBestSq) ||
+		    ((dDistSq == dBestSq) && (node.ix < ixBest))
+		) {
+			iBest = iMid;
+			ixBest = node.ix;
+			dBestSq = dDistSq;
+		}
+
+		// Search the near side first
+		double dDiff = dPos[entry.iAxis] - node.x[entry.iAxis];
+		int iNextAxis = (entry.iAxis + 1) % 3;
+
+		SpatialIndexStackEntry & entryFar = stack[nStack++];
+		entryFar.iAxis = iNextAxis;
+		entryFar.dBoundSq = std::max(entry.dBoundSq, dDiff * dDiff);
+
+		SpatialIndexStackEntry & entryNear = stack[nStack++];
+		entryNear.iAxis = iNextAxis;
+		entryNear.dBoundSq = entry.dBoundSq;
+
+		if (dDiff < 0.0) {
+			entryNear.iBegin = entry.iBegin;
+			entryNear.iEnd = iMid;
+			entryFar.iBegin = iMid + 1;
+			entryFar.iEnd = entry.iEnd;
+		} else {
+			entryNear.iBegin = iMid + 1;
+			entryNear.iEnd = entry.iEnd;
+			entryFar.iBegin = entry.iBegin;
+			entryFar.iEnd = iMid;
+		}
+	}
+
+	if (pdDistSq != NULL) {
+		*pdDistSq = dBestSq;
+	}
+
+	return ixBest;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int SpatialIndex::Range(
+	double dX,
+	double dY,
+	double dZ,
+	double dRange,
+	int * piResults,
+	int nMaxResults
+) const {
+	const double dPos[3] = {dX, dY, dZ};
+
+	const double dRangeSq = dRange * dRange;
+
+	int nResults = 0;
+
+	SpatialIndexStackEntry stack[2 * MaxDepth];
+	int nStack = 0;
+
+	stack[0].iBegin = 0;
+	stack[0].iEnd = m_nPoints;
+	stack[0].iAxis = 0;
+	stack[0].dBoundSq = 0.0;
+	nStack = 1;
+
+	while (nStack != 0) {
+		const SpatialIndexStackEntry entry = stack[--nStack];
+
+		if (entry.iBegin >= entry.iEnd) {
+			continue;
+		}
+
+		int iMid = (entry.iBegin + entry.iEnd) / 2;
+		const Node & node = m_vecNodes[iMid];
+
+		double dDX = node.x[0] - dPos[0];
+		double dDY = node.x[1] - dPos[1];
+		double dDZ = node.x[2] - dPos[2];
+		double dDistSq = dDX * dDX + dDY * dDY + dDZ * dDZ;
+
+		if (dDistSq <= dRangeSq) {
+			if (nResults < nMaxResults) {
+				piResults[nResults] = node.ix;
+			}
+			nResults++;
+		}
+
+		// Children on each side of the splitting plane
+		double dDiff = dPos[entry.iAxis] - node.x[entry.iAxis];
+		int iNextAxis = (entry.iAxis + 1) % 3;
+
+		if (dDiff - dRange <= 0.0) {
+			SpatialIndexStackEntry & lower = stack[nStack++];
+			lower.iBegin = entry.iBegin;
+			lower.iEnd = iMid;
+			lower.iAxis = iNextAxis;
+			lower.dBoundSq = 0.0;
+		}
+		if (dDiff + dRange >= 0.0) {
+			SpatialIndexStackEntry & upper = stack[nStack++];
+			upper.iBegin = iMid + 1;
+			upper.iEnd = entry.iEnd;
+			upper.iAxis = iNextAxis;
+			upper.dBoundSq = 0.0;
+		}
+	}
+
+	return nResults;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int SpatialIndex::Range(
+	double dX,
+	double dY,
+	double dZ,
+	double dRange,
+	std::vector<int> & vecResults
+) const {
+	if (vecResults.capacity() < 16) {
+		vecResults.reserve(16);
+	}
+	vecResults.resize(vecResults.capacity());
+
+	int nResults =
+		Range(dX, dY, dZ, dRange, &(vecResults[0]), vecResults.size());
+
+	// Buffer was too small; search again with the exact size
+	if (nResults > vecResults.size()) {
+		vecResults.resize(nResults);
+		Range(dX, dY, dZ, dRange, &(vecResults[0]), vecResults.size());
+	}
+
+	vecResults.resize(nResults);
+
+	return nResults;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    SpatialIndex.h
+///
+///	<remarks>
+///		Copyright 2000-2014 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _SPATIALINDEX_H_
+#define _SPATIALINDEX_H_
+
+///////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <cstddef>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A static kd-tree over a set of points in three-dimensional
+///		Cartesian space, intended as a replacement for the kd_* functions
+///		of kdtree.h when all points are known in advance.
+///
+///		The tree is built in one pass from arrays of coordinates and is
+///		stored in a single array (in tree order), so that building the
+///		tree performs one allocation and queries perform none.  Points are
+///		identified by their index in the input arrays.  Queries do not
+///		modify the tree, so any number of threads may query the same tree
+///		concurrently without locking.
+///	</summary>
+class SpatialIndex {
+
+public:
+	///	<summary>
+	///		Maximum depth of the tree (the tree is balanced, so this
+	///		supports far more points than can be indexed by an int).
+	///	</summary>
+	static const int MaxDepth = 64;
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	SpatialIndex() :
+		m_nPoints(0)
+	{ }
+
+	///	<summary>
+	///		Build a balanced tree from arrays of coordinates.  Any existing
+	///		tree is replaced; its memory is reused if sufficient.
+	///	</summary>
+	void Build(
+		const double * dX,
+		const double * dY,
+		const double * dZ,
+		int nPoints
+	);
+
+	///	<summary>
+	///		Remove all points from the tree.
+	///	</summary>
+	void Clear() {
+		m_nPoints = 0;
+		m_vecNodes.clear();
+	}
+
+	///	<summary>
+	///		Number of points in the tree.
+	///	</summary>
+	int GetSize() const {
+		return m_nPoints;
+	}
+
+public:
+	///	<summary>
+	///		Find the point nearest to (dX, dY, dZ).  Returns the index of
+	///		the point, or (-1) if the tree is empty.  Of several points at
+	///		the same distance the one with the smallest index is returned.
+	///		If pdDistSq is not NULL it is set to the squared distance.
+	///	</summary>
+	int Nearest(
+		double dX,
+		double dY,
+		double dZ,
+		double * pdDistSq = NULL
+	) const;
+
+	///	<summary>
+	///		Find all points within (Euclidean) distance dRange of
+	///		(dX, dY, dZ), inclusive.  The indices of up to nMaxResults points
+	///		are written to piResults, in no particular order.  Returns the
+	///		total number of points in range, which may exceed nMaxResults.
+	///	</summary>
+	int Range(
+		double dX,
+		double dY,
+		double dZ,
+		double dRange,
+		int * piResults,
+		int nMaxResults
+	) const;
+
+	///	<summary>
+	///		Find all points within (Euclidean) distance dRange of
+	///		(dX, dY, dZ), inclusive.  The indices of all points in range
+	///		replace the contents of vecResults, whose capacity is reused
+	///		between calls.  Returns the number of points in range.
+	///	</summary>
+	int Range(
+		double dX,
+		double dY,
+		double dZ,
+		double dRange,
+		std::vector<int> & vecResults
+	) const;
+
+protected:
+	///	<summary>
+	///		Recursively arrange nodes [iBegin, iEnd) so that the median
+	///		along the splitting axis of this depth is at the midpoint.
+	///	</summary>
+	void BuildRecurse(
+		int iBegin,
+		int iEnd,
+		int iAxis
+	);
+
+protected:
+	///	<summary>
+	///		A point in the tree.  The node for the range [b,e) is stored at
+	///		m=(b+e)/2, with children covering [b,m) and [m+1,e), and splits
+	///		along axis (depth % 3).
+	///	</summary>
+	struct Node {
+		double x[3];
+		int ix;
+	};
+
+	///	<summary>
+	///		Number of points.
+	///	</summary>
+	int m_nPoints;
+
+	///	<summary>
+	///		Nodes of the tree.
+	///	</summary>
+	std::vector<Node> m_vecNodes;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
+
@@ -0,0 +1,307 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    TimeDecoder.cpp
+///
+///	<remarks>
+///		Copyright 2000-2010 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "TimeDecoder.h"
+#include "TimeObj.h"
+#include "Exception.h"
+
+#include <cmath>
+#include <cstring>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Cumulative number of days before each month in a 365 day year.
+///	</summary>
+static const int s_nCumDaysNoLeap[13] =
+	{0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365};
+
+///	<summary>
+///		Integer division rounding towards negative infinity.
+///	</summary>
+static inline long long FloorDiv(long long a, long long b) {
+	long long q = a / b;
+	if ((a % b != 0) && ((a < 0) != (b < 0))) {
+		q--;
+	}
+	return q;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TimeDecoder::TimeDecoder() :
+	m_eCalendar(CalendarStandard),
+	m_eUnits(UnitsDays),
+	m_nRefDays(0),
+	m_nRefSecond(0)
+{ }
+
+///////////////////////////////////////////////////////////////////////////////
+
+TimeDecoder::TimeDecoder(
+	const std::string & strTimeUnits,
+	const std::string & strCalendar
+) {
+	Initialize(strTimeUnits, strCalendar);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TimeDecoder::CalendarType TimeDecoder::ParseCalendar(
+	const std::string & strCalendar
+) {
+	const char * szCalendar = strCalendar.c_str();
+
+	if ((strncmp(szCalendar, "noleap", 6) == 0) ||
+	    (strncmp(szCalendar, "no_leap", 7) == 0) ||
+	    (strncmp(szCalendar, "365_day", 7) == 0)
+	) {
+		return CalendarNoLeap;
+
+	} else if (
+	    (strncmp(szCalendar, "standard", 8) == 0) ||
+	    (strncmp(szCalendar, "gregorian", 9) == 0) ||
+	    (strncmp(szCalendar, "proleptic_gregorian", 19) == 0)
+	) {
+		return CalendarStandard;
+
+	} else if (strncmp(szCalendar, "360_day", 7) == 0) {
+		return Calendar360Day;
+	}
+
+	_EXCEPTION1("Unknown calendar type \"%s\"", szCalendar);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TimeDecoder::Initialize(
+	const std::string & strTimeUnits,
+	const std::string & strCalendar
+) {
+	m_eCalendar = ParseCalendar(strCalendar);
+
+	// Time units
+	std::string strRefTime;
+	if (strncmp(strTimeUnits.c_str(), "days since ", 11) == 0) {
+		m_eUnits = UnitsDays;
+		strRefTime = strTimeUnits.substr(11);
+
+	} else if (strncmp(strTimeUnits.c_str(), "hours since ", 12) == 0) {
+		m_eUnits = UnitsHours;
+		strRefTime = strTimeUnits.substr(12);
+
+	} else if (strncmp(strTimeUnits.c_str(), "minutes since ", 14) == 0) {
+		m_eUnits = UnitsMinutes;
+		strRefTime = strTimeUnits.substr(14);
+
+	} else if (strncmp(strTimeUnits.c_str(), "seconds since ", 14) == 0) {
+		m_eUnits = UnitsSeconds;
+		strRefTime = strTimeUnits.substr(14);
+
+	} else {
+		_EXCEPTIONT("Unknown \"time::units\" format");
+	}
+
+	// Reference time (parsed once)
+	Time timeRef(
+		(m_eCalendar == CalendarStandard)?
+			(Time::CalendarStandard):(Time::CalendarNoLeap));
+
+	timeRef.FromFormattedString(strRefTime);
+
+	m_nRefDays = DaysFromDate(
+		m_eCalendar,
+		timeRef.GetYear(),
+		timeRef.GetMonth(),
+		timeRef.GetDay());
+
+	m_nRefSecond = timeRef.GetSecond();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+long long TimeDecoder::DaysFromDate(
+	CalendarType eCalendar,
+	int nYear,
+	int nMonth,
+	int nDay
+) {
+	if ((nMonth < 1) || (nMonth > 12)) {
+		_EXCEPTION1("Month out of range (%i)", nMonth);
+	}
+
+	// 365 day years
+	if (eCalendar == CalendarNoLeap) {
+		return (static_cast<long long>(nYear) * 365
+			+ s_nCumDaysNoLeap[nMonth-1] + (nDay - 1));
+
+	// 12 months of 30 days
+	} else if (eCalendar == Calendar360Day) {
+		return (static_cast<long long>(nYear) * 360
+			+ (nMonth - 1) * 30 + (nDay - 1));
+	}
+
+	// Proleptic Gregorian calendar, counted in 400 year eras
+	// starting on March 1 so that the leap day is last
+	long long y = nYear - ((nMonth <= 2)?(1):(0));
+	long long era = FloorDiv(y, 400);
+	long long yoe = y - era * 400;
+	long long doy =
+		(153 * (nMonth + ((nMonth > 2)?(-3):(9))) + 2) / 5 + (nDay - 1);
+	long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	// Offset from 0000-03-01 to 0000-01-01
+	return (era * 146097 + doe + 60);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TimeDecoder::DateFromDays(
+	CalendarType eCalendar,
+	long long nDays,
+	int & nYear,
+	int & nMonth,
+	int & nDay
+) {
+	// 365 day years
+	if (eCalendar == CalendarNoLeap) {
+		long long y = FloorDiv(nDays, 365);
+		int doy = static_cast<int>(nDays - y * 365);
+		int m = doy / 31;
+		if (doy >= s_nCumDaysNoLeap[m+1]) {
+			m++;
+		}
+		nYear = static_cast<int>(y);
+		nMonth = m + 1;
+		nDay = doy - s_nCumDaysNoLeap[m] + 1;
+		return;
+
+	// 12 months of 30 days
+	} else if (eCalendar == Calendar360Day) {
+		long long y = FloorDiv(nDays, 360);
+		int doy = static_cast<int>(nDays - y * 360);
+		nYear = static_cast<int>(y);
+		nMonth = doy / 30 + 1;
+		nDay = doy % 30 + 1;
+		return;
+	}
+
+	// Proleptic Gregorian calendar (inverse of DaysFromDate)
+	long long z = nDays - 60;
+	long long era = FloorDiv(z, 146097);
+	long long doe = z - era * 146097;
+	long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	long long mp = (5 * doy + 2) / 153;
+
+	nDay = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+	nMonth = static_cast<int>((mp < 10)?(mp + 3):(mp - 9));
+	nYear = static_cast<int>(yoe + era * 400 + ((nMonth <= 2)?(1):(0)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TimeDecoder::Decode(
+	double dTime,
+	Date & date
+) const {
+
+	// Offset from the reference time in whole days and seconds,
+	// truncated in the same way as Time::AddDays/AddHours/AddMinutes
+	long long nDays = m_nRefDays;
+	long long nSeconds = m_nRefSecond;
+
+	if (m_eUnits == UnitsDays) {
+		nDays += static_cast<int>(dTime);
+		nSeconds += static_cast<int>(fmod(dTime, 1.0) * 86400.0);
+
+	} else if (m_eUnits == UnitsHours) {
+		nSeconds += static_cast<long long>(static_cast<int>(dTime)) * 3600;
+
+	} else if (m_eUnits == UnitsMinutes) {
+		nSeconds += static_cast<long long>(static_cast<int>(dTime)) * 60;
+
+	} else {
+		nSeconds += static_cast<long long>(dTime);
+	}
+
+	long long nExtraDays = FloorDiv(nSeconds, 86400);
+	nDays += nExtraDays;
+	nSeconds -= nExtraDays * 86400;
+
+	DateFromDays(m_eCalendar, nDays, date.nYear, date.nMonth, date.nDay);
+	date.nSecond = static_cast<int>(nSeconds);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TimeDecoder::Decode(
+	double dTime,
+	int & nDateYear,
+	int & nDateMonth,
+	int & nDateDay,
+	int & nDateHour
+) const {
+	Date date;
+	Decode(dTime, date);
+
+	nDateYear = date.nYear;
+	nDateMonth = date.nMonth;
+	nDateDay = date.nDay;
+	nDateHour = date.GetHour();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TimeDecoder::DecodeVector(
+	const double * pTime,
+	int nTimes,
+	std::vector<Date> & vecDates
+) const {
+	vecDates.resize(nTimes);
+	for (int t = 0; t < nTimes; t++) {
+		Decode(pTime[t], vecDates[t]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool TimeDecoder::IsLeapDay(
+	double dTime
+) const {
+	if (m_eCalendar != CalendarStandard) {
+		return false;
+	}
+
+	Date date;
+	Decode(dTime, date);
+
+	return ((date.nMonth == 2) && (date.nDay == 29));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+double TimeDecoder::GetUnitsInDays() const {
+	if (m_eUnits == UnitsDays) {
+		return 1.0;
+	} else if (m_eUnits == UnitsHours) {
+		return (1.0 / 24.0);
+	} else if (m_eUnits == UnitsMinutes) {
+		return (1.0 / 1440.0);
+	}
+	return (1.0 / 86400.0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
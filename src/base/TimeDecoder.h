@@ -0,0 +1,199 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    TimeDecoder.h
+///
+///	<remarks>
+///		Copyright 2000-2010 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _TIMEDECODER_H_
+#define _TIMEDECODER_H_
+
+///////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		A class for converting CF time values ("days since ...", "hours
+///		since ...", etc.) into calendar dates.  The units and calendar are
+///		parsed once; each time value is then converted with a constant
+///		number of operations by counting days from a fixed epoch in the
+///		given calendar, rather than by stepping month-by-month from the
+///		reference date.
+///	</summary>
+class TimeDecoder {
+
+public:
+	///	<summary>
+	///		Supported calendars.
+	///	</summary>
+	enum CalendarType {
+		CalendarStandard,
+		CalendarNoLeap,
+		Calendar360Day
+	};
+
+	///	<summary>
+	///		Supported time units.
+	///	</summary>
+	enum UnitsType {
+		UnitsDays,
+		UnitsHours,
+		UnitsMinutes,
+		UnitsSeconds
+	};
+
+	///	<summary>
+	///		A decoded calendar date.  Month and day are one-based.
+	///	</summary>
+	struct Date {
+		int nYear;
+		int nMonth;
+		int nDay;
+		int nSecond;
+
+		///	<summary>
+		///		Hour of the day.
+		///	</summary>
+		int GetHour() const {
+			return (nSecond / 3600);
+		}
+	};
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	TimeDecoder();
+
+	///	<summary>
+	///		Constructor from the "units" and "calendar" attributes.
+	///	</summary>
+	TimeDecoder(
+		const std::string & strTimeUnits,
+		const std::string & strCalendar
+	);
+
+	///	<summary>
+	///		Parse the "units" and "calendar" attributes.
+	///	</summary>
+	void Initialize(
+		const std::string & strTimeUnits,
+		const std::string & strCalendar
+	);
+
+	///	<summary>
+	///		Determine the CalendarType from a "calendar" attribute.
+	///	</summary>
+	static CalendarType ParseCalendar(
+		const std::string & strCalendar
+	);
+
+public:
+	///	<summary>
+	///		Number of days from 0000-01-01 to the given date.
+	///	</summary>
+	static long long DaysFromDate(
+		CalendarType eCalendar,
+		int nYear,
+		int nMonth,
+		int nDay
+	);
+
+	///	<summary>
+	///		Date that is nDays days after 0000-01-01.
+	///	</summary>
+	static void DateFromDays(
+		CalendarType eCalendar,
+		long long nDays,
+		int & nYear,
+		int & nMonth,
+		int & nDay
+	);
+
+public:
+	///	<summary>
+	///		Convert a single time value.
+	///	</summary>
+	void Decode(
+		double dTime,
+		Date & date
+	) const;
+
+	///	<summary>
+	///		Convert a single time value.
+	///	</summary>
+	void Decode(
+		double dTime,
+		int & nDateYear,
+		int & nDateMonth,
+		int & nDateDay,
+		int & nDateHour
+	) const;
+
+	///	<summary>
+	///		Convert an array of time values.
+	///	</summary>
+	void DecodeVector(
+		const double * pTime,
+		int nTimes,
+		std::vector<Date> & vecDates
+	) const;
+
+	///	<summary>
+	///		Determine if the time value falls on February 29.
+	///	</summary>
+	bool IsLeapDay(
+		double dTime
+	) const;
+
+	///	<summary>
+	///		Get the calendar.
+	///	</summary>
+	CalendarType GetCalendarType() const {
+		return m_eCalendar;
+	}
+
+	///	<summary>
+	///		Get the time units.
+	///	</summary>
+	UnitsType GetUnitsType() const {
+		return m_eUnits;
+	}
+
+	///	<summary>
+	///		Length of one unit of time in days.
+	///	</summary>
+	double GetUnitsInDays() const;
+
+protected:
+	///	<summary>
+	///		Calendar of the time axis.
+	///	</summary>
+	CalendarType m_eCalendar;
+
+	///	<summary>
+	///		Units of the time axis.
+	///	</summary>
+	UnitsType m_eUnits;
+
+	///	<summary>
+	///		Reference date as a day number and seconds within that day.
+	///	</summary>
+	long long m_nRefDays;
+	int m_nRefSecond;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
+
@@ -35,6 +35,12 @@
 #include <string>
 #include <set>
 #include <map>
+#include <algorithm>
+#include <cfloat>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -53,7 +59,9 @@ struct BlobQuantities {
 		MaxLon,
 		CentroidLat,
 		CentroidLon,
-		Area
+		Area,
+		FieldMean,
+		FieldMax
 	};
 
 	///	<summary>
@@ -66,10 +74,29 @@ struct BlobQuantities {
 	///	</summary>
 	double dArea;
 
+	///	<summary>
+	///		Area-weighted sum of the field variable over the blob.
+	///	</summary>
+	double dFieldSum;
+
+	///	<summary>
+	///		Maximum of the field variable over the blob.
+	///	</summary>
+	double dFieldMax;
+
 	///	<summary>
 	///		Array of output variables associated with blob.
 	///	</summary>
 	std::vector<double> dOutputVars;
+
+	///	<summary>
+	///		Default constructor.
+	///	</summary>
+	BlobQuantities() :
+		dArea(0.0),
+		dFieldSum(0.0),
+		dFieldMax(-DBL_MAX)
+	{ }
 };
 
 ///	<summary>
@@ -84,6 +111,152 @@ typedef std::map<int, TimedBlobQuantitiesMap> AllTimedBlobQuantitiesMap;
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		Flat per-blob accumulators for a single time, indexed by blob tag.
+///		Negative tags have slots of their own, so any nonzero tag can be
+///		accumulated.  Entries are lazily reset using a time stamp so that the cost of
+///		each time is proportional to the number of grid points.
+///	</summary>
+class BlobAccumulator {
+
+public:
+	///	<summary>
+	///		Default constructor.
+	///	</summary>
+	BlobAccumulator() :
+		m_iStamp(0)
+	{ }
+
+	///	<summary>
+	///		Begin accumulating a new time.
+	///	</summary>
+	void BeginTime() {
+		m_iStamp++;
+		m_vecActiveTags.clear();
+	}
+
+	///	<summary>
+	///		Get the accumulator for the given tag at the current time.
+	///	</summary>
+	BlobQuantities & Get(int iTag) {
+
+		// Positive and negative tags are interleaved in the slot arrays
+		size_t sSlot;
+		if (iTag >= 0) {
+			sSlot = 2 * static_cast<size_t>(iTag);
+		} else {
+			sSlot = 2 * static_cast<size_t>(-(iTag + 1)) + 1;
+		}
+
+		if (sSlot >= m_vecQuantities.size()) {
+			m_vecQuantities.resize(sSlot + 1);
+			m_vecStamp.resize(sSlot + 1, 0);
+		}
+		if (m_vecStamp[sSlot] != m_iStamp) {
+			m_vecStamp[sSlot] = m_iStamp;
+			m_vecQuantities[sSlot] = BlobQuantities();
+			m_vecActiveTags.push_back(iTag);
+		}
+		return m_vecQuantities[sSlot];
+	}
+
+	///	<summary>
+	///		Tags encountered at the current time.
+	///	</summary>
+	const std::vector<int> & GetActiveTags() const {
+		return m_vecActiveTags;
+	}
+
+protected:
+	///	<summary>
+	///		Current time stamp.
+	///	</summary>
+	int m_iStamp;
+
+	///	<summary>
+	///		Time stamp of the last update of each tag.
+	///	</summary>
+	std::vector<int> m_vecStamp;
+
+	///	<summary>
+	///		Quantities associated with each tag.
+	///	</summary>
+	std::vector<BlobQuantities> m_vecQuantities;
+
+	///	<summary>
+	///		Tags encountered at the current time.
+	///	</summary>
+	std::vector<int> m_vecActiveTags;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Compute the quantities associated with all blobs at a single time
+///		in one pass over the tag field.  Points are visited in the same
+///		order as the tag field is stored so that bounding boxes do not
+///		depend on how times are distributed among threads.
+///	</summary>
+void AccumulateBlobQuantities(
+	const DataMatrix<int> & dataIndex,
+	const DataMatrix<double> * pdataField,
+	const LatLonGridMetrics & grid,
+	BlobAccumulator & accum,
+	std::vector< std::pair<int, BlobQuantities> > & vecBlobQuantities
+) {
+	int nLat = dataIndex.GetRows();
+	int nLon = dataIndex.GetColumns();
+
+	accum.BeginTime();
+
+	for (int j = 0; j < nLat; j++) {
+
+		double dCellArea = grid.CellArea(j);
+
+		const int * pIndex = dataIndex[j];
+
+		for (int i = 0; i < nLon; i++) {
+
+			// Ignore non-blob data
+			if (pIndex[i] == 0) {
+				continue;
+			}
+
+			BlobQuantities & quants = accum.Get(pIndex[i]);
+
+			// Insert point into array
+			quants.box.InsertPoint(j, i, nLat, nLon);
+
+			// Add blob area
+			quants.dArea += dCellArea;
+
+			// Field-weighted quantities
+			if (pdataField != NULL) {
+				double dValue = (*pdataField)[j][i];
+
+				quants.dFieldSum += dValue * dCellArea;
+				if (dValue > quants.dFieldMax) {
+					quants.dFieldMax = dValue;
+				}
+			}
+		}
+	}
+
+	// Store quantities for all blobs at this time
+	const std::vector<int> & vecActiveTags = accum.GetActiveTags();
+
+	vecBlobQuantities.clear();
+	vecBlobQuantities.reserve(vecActiveTags.size());
+	for (int i = 0; i < vecActiveTags.size(); i++) {
+		vecBlobQuantities.push_back(
+			std::pair<int, BlobQuantities>(
+				vecActiveTags[i],
+				accum.Get(vecActiveTags[i])));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 int main(int argc, char** argv) {
 
 	NcError error(NcError::silent_nonfatal);
@@ -105,6 +278,9 @@ try {
 	// Summary quantities
 	std::string strOutputQuantities;
 
+	// Field variable used for field-weighted quantities
+	std::string strFieldVariable;
+
 	// Display help message
 	bool fHelp;
 
@@ -115,6 +291,7 @@ try {
 		CommandLineString(strOutputFile, "outfile", "");
 		CommandLineString(strInputVariable, "invar", "");
 		CommandLineString(strOutputQuantities, "out", "");
+		CommandLineString(strFieldVariable, "fieldvar", "");
 		CommandLineBool(fHelp, "help");
 
 		ParseCommandLine(argc, argv);
@@ -157,19 +334,9 @@ try {
 
 	int nFiles = vecInputFiles.size();
 
-	// Load in spatial dimension data
-	int nLat;
-	int nLon;
-
-	DataVector<double> dataLatDeg;
-	DataVector<double> dataLat;
-
-	DataVector<double> dataLonDeg;
-	DataVector<double> dataLon;
-
-	bool fFlippedLat = false;
-
-	double dAreaElement;
+	// Load in spatial dimension data and grid metrics (areas on the
+	// unit sphere)
+	LatLonGridMetrics grid;
 
 	{
 		// Load the first netcdf input file
@@ -180,59 +347,24 @@ try {
 				vecInputFiles[0].c_str());
 		}
 
-		// Get latitude/longitude dimensions
-		NcDim * dimLat = ncInput.get_dim("lat");
-		if (dimLat == NULL) {
-			_EXCEPTIONT("No dimension \"lat\" found in input file");
-		}
+		grid.Initialize(ncInput, 1.0);
 
-		NcDim * dimLon = ncInput.get_dim("lon");
-		if (dimLon == NULL) {
-			_EXCEPTIONT("No dimension \"lon\" found in input file");
-		}
-
-		NcVar * varLat = ncInput.get_var("lat");
-		if (varLat == NULL) {
-			_EXCEPTIONT("No variable \"lat\" found in input file");
-		}
-
-		NcVar * varLon = ncInput.get_var("lon");
-		if (varLon == NULL) {
-			_EXCEPTIONT("No variable \"lon\" found in input file");
-		}
-
-		nLat = dimLat->size();
-		nLon = dimLon->size();
-
-		dataLatDeg.Initialize(nLat);
-		dataLat.Initialize(nLat);
-
-		dataLonDeg.Initialize(nLon);
-		dataLon.Initialize(nLon);
-
-		varLat->get(dataLatDeg, nLat);
-		for (int j = 0; j < nLat; j++) {
-			dataLat[j] = dataLatDeg[j] * M_PI / 180.0;
-		}
+		// Close first netcdf file
+		ncInput.close();
+	}
 
-		varLon->get(dataLonDeg, nLon);
-		for (int i = 0; i < nLon; i++) {
-			dataLon[i] = dataLonDeg[i] * M_PI / 180.0;
-		}
+	int nLat = grid.GetLatCount();
+	int nLon = grid.GetLonCount();
 
-		dAreaElement =
-			M_PI / static_cast<double>(nLat)
-			* 2.0 * M_PI / static_cast<double>(nLon);
+	const DataVector<double> & dataLatDeg = grid.GetLatDeg();
+	const DataVector<double> & dataLonDeg = grid.GetLonDeg();
 
-		// Check for flipped latitude
-		if (dataLatDeg.GetRows() >= 2) {
-			if (dataLatDeg[1] < dataLatDeg[0]) {
-				fFlippedLat = true;
-			}
+	// Check for flipped latitude
+	bool fFlippedLat = false;
+	if (nLat >= 2) {
+		if (dataLatDeg[1] < dataLatDeg[0]) {
+			fFlippedLat = true;
 		}
-
-		// Close first netcdf file
-		ncInput.close();
 	}
 
 	// Parse the list of output quantities
@@ -269,10 +401,23 @@ try {
 					vecOutputVars[iNextOp] = BlobQuantities::CentroidLon;
 				} else if (strSubStr == "area") {
 					vecOutputVars[iNextOp] = BlobQuantities::Area;
+				} else if (strSubStr == "fieldmean") {
+					vecOutputVars[iNextOp] = BlobQuantities::FieldMean;
+				} else if (strSubStr == "fieldmax") {
+					vecOutputVars[iNextOp] = BlobQuantities::FieldMax;
 				} else {
 					_EXCEPTIONT("Invalid output quantity:  Expected\n"
 						"[minlat, maxlat, minlon, maxlon, "
-						"centlat, centlon, area]");
+						"centlat, centlon, area, fieldmean, fieldmax]");
+				}
+
+				if ((vecOutputVars[iNextOp] == BlobQuantities::FieldMean) ||
+				    (vecOutputVars[iNextOp] == BlobQuantities::FieldMax)
+				) {
+					if (strFieldVariable == "") {
+						_EXCEPTION1("Output quantity \"%s\" requires a "
+							"field variable (--fieldvar)", strSubStr.c_str());
+					}
 				}
 
 				iLast = i + 1;
@@ -294,6 +439,41 @@ try {
 		_EXCEPTIONT("Error opening output file");
 	}
 
+	// Number of time levels loaded before parallel accumulation
+	int nBatchTimes = 1;
+	int nThreads = 1;
+#if defined(_OPENMP)
+	nThreads = omp_get_max_threads();
+	nBatchTimes = nThreads;
+#endif
+
+	// Per-thread accumulators
+	std::vector<BlobAccumulator> vecAccumulators;
+	vecAccumulators.resize(nThreads);
+
+	// Blob index and field data for each time in the batch
+	std::vector< DataMatrix<int> > vecDataIndex;
+	vecDataIndex.resize(nBatchTimes);
+
+	std::vector< DataMatrix<double> > vecDataField;
+	if (strFieldVariable != "") {
+		vecDataField.resize(nBatchTimes);
+	}
+
+	for (int b = 0; b < nBatchTimes; b++) {
+		vecDataIndex[b].Initialize(nLat, nLon);
+		if (strFieldVariable != "") {
+			vecDataField[b].Initialize(nLat, nLon);
+		}
+	}
+
+	// Quantities for each blob at each time in the batch
+	std::vector< std::vector< std::pair<int, BlobQuantities> > >
+		vecBatchQuantities;
+	vecBatchQuantities.resize(nBatchTimes);
+
+	AnnounceStartBlock("Computing blob quantities");
+
 	// Loop through all files
 	for (int f = 0; f < nFiles; f++) {
 
@@ -304,11 +484,11 @@ try {
 				vecInputFiles[f].c_str());
 		}
 
-		// Blob index data
-		DataMatrix<int> dataIndex(nLat, nLon);
-
 		// Get current time dimension
 		NcDim * dimTime = ncInput.get_dim("time");
+		if (dimTime == NULL) {
+			_EXCEPTIONT("No dimension \"time\" found in input file");
+		}
 
 		int nLocalTimes = dimTime->size();
 
@@ -325,184 +505,164 @@ try {
 				" (3 expected)", strInputVariable.c_str());
 		}
 
-		// Loop through all times
-		for (int t = 0; t < nLocalTimes; t++, iTime++) {
-
-			// Load in the data at this time
-			varIndicator->set_cur(t, 0, 0);
-			varIndicator->get(&(dataIndex[0][0]), 1, nLat, nLon);
-
-			// Last data index
-			int iLastDataIndex = 0;
-
-			// Iterator to BlobQuantities with iLastDataIndex and iTime
-			TimedBlobQuantitiesMap::iterator iterBlobQuantities;
-
-			// Loop over all locations
-			for (int j = 0; j < nLat; j++) {
-			for (int i = 0; i < nLon; i++) {
-
-				// Ignore non-blob data
-				if (dataIndex[j][i] == 0) {
-					continue;
-				}
-
-				// Check if iterator already points to correct data
-				if (dataIndex[j][i] != iLastDataIndex) {
-
-					// Iterator to TimedBlobQuantities with iLastDataIndex
-					AllTimedBlobQuantitiesMap::iterator
-						iterTimedBlobQuantities;
+		// Load in field variable
+		NcVar * varField = NULL;
+		if (strFieldVariable != "") {
+			varField = ncInput.get_var(strFieldVariable.c_str());
 
-					// Get new iterator for this dataIndex
-					iterTimedBlobQuantities =
-						mapAllQuantities.find(
-							dataIndex[j][i]);
-
-					if (iterTimedBlobQuantities == mapAllQuantities.end()) {
-
-						std::pair<AllTimedBlobQuantitiesMap::iterator,bool> pr =
-							mapAllQuantities.insert(
-								AllTimedBlobQuantitiesMap::value_type(
-									dataIndex[j][i],
-									TimedBlobQuantitiesMap()));
-
-						if (pr.second == false) {
-							_EXCEPTIONT("Map insertion failed");
-						}
-						iterTimedBlobQuantities = pr.first;
-					}
-
-					// Get the BlobQuantities at the current time
-					TimedBlobQuantitiesMap & mapTimedBlobQuantities =
-						iterTimedBlobQuantities->second;
+			if (varField == NULL) {
+				_EXCEPTION1("Unable to load variable \"%s\"",
+					strFieldVariable.c_str());
+			}
 
-					iterBlobQuantities =
-						mapTimedBlobQuantities.find(iTime);
+			if (varField->num_dims() != 3) {
+				_EXCEPTION1("Incorrect number of dimensions for \"%s\""
+					" (3 expected)", strFieldVariable.c_str());
+			}
+		}
 
-					if (iterBlobQuantities == mapTimedBlobQuantities.end()) {
-						std::pair<TimedBlobQuantitiesMap::iterator,bool> pr =
-							mapTimedBlobQuantities.insert(
-								TimedBlobQuantitiesMap::value_type(
-									iTime,
-									BlobQuantities()));
+		// Loop through all times in batches
+		for (int tBatch = 0; tBatch < nLocalTimes; tBatch += nBatchTimes) {
 
-						if (pr.second == false) {
-							_EXCEPTIONT("Map insertion failed");
-						}
-						iterBlobQuantities = pr.first;
-					}
+			int nBatch = std::min(nBatchTimes, nLocalTimes - tBatch);
 
-					// Update last data index
-					iLastDataIndex = dataIndex[j][i];
-				}
+			// Load in the data at these times (NetCDF is not thread-safe)
+			for (int b = 0; b < nBatch; b++) {
+				varIndicator->set_cur(tBatch + b, 0, 0);
+				varIndicator->get(&(vecDataIndex[b][0][0]), 1, nLat, nLon);
 
-				//std::cout << iterBlobQuantities->first << std::endl;
-/*
-				if ((dataIndex[j][i] == 1) && (iTime == 1)) {
-					printf("%i %i : %i %i\n",
-						j, i,
-						iterBlobQuantities->second.box.lon[0],
-						iterBlobQuantities->second.box.lon[1]);
+				if (varField != NULL) {
+					varField->set_cur(tBatch + b, 0, 0);
+					varField->get(&(vecDataField[b][0][0]), 1, nLat, nLon);
 				}
-*/
-				// Insert point into array
-				iterBlobQuantities->second.box.InsertPoint(j, i, nLat, nLon);
-
-				// Add blob area
-				iterBlobQuantities->second.dArea +=
-					cos(dataLat[j]) * dAreaElement;
+			}
 
+			// Accumulate quantities at each time independently
+#pragma omp parallel for schedule(dynamic)
+			for (int b = 0; b < nBatch; b++) {
+				int iThread = 0;
+#if defined(_OPENMP)
+				iThread = omp_get_thread_num();
+#endif
+				AccumulateBlobQuantities(
+					vecDataIndex[b],
+					(varField != NULL)?(&(vecDataField[b])):(NULL),
+					grid,
+					vecAccumulators[iThread],
+					vecBatchQuantities[b]);
 			}
+
+			// Reduce into the map of all quantities
+			for (int b = 0; b < nBatch; b++, iTime++) {
+				for (int p = 0; p < vecBatchQuantities[b].size(); p++) {
+					mapAllQuantities[vecBatchQuantities[b][p].first].insert(
+						TimedBlobQuantitiesMap::value_type(
+							iTime, vecBatchQuantities[b][p].second));
+				}
 			}
 		}
+	}
 
-		// Output all BlobQuantities
-		{
-			AllTimedBlobQuantitiesMap::iterator iterBlobs =
-				mapAllQuantities.begin();
+	AnnounceEndBlock("Done");
 
-			for (; iterBlobs != mapAllQuantities.end(); iterBlobs++) {
+	AnnounceStartBlock("Writing blob quantities");
 
-				fprintf(fpout, "Blob %i (%lu)\n",
-					iterBlobs->first,
-					iterBlobs->second.size());
+	// Output all BlobQuantities
+	{
+		AllTimedBlobQuantitiesMap::iterator iterBlobs =
+			mapAllQuantities.begin();
 
-				TimedBlobQuantitiesMap::iterator iterTimes =
-					iterBlobs->second.begin();
+		for (; iterBlobs != mapAllQuantities.end(); iterBlobs++) {
 
-				for (; iterTimes != iterBlobs->second.end(); iterTimes++) {
+			fprintf(fpout, "Blob %i (%lu)\n",
+				iterBlobs->first,
+				iterBlobs->second.size());
 
-					fprintf(fpout, "%i", iterTimes->first);
+			TimedBlobQuantitiesMap::iterator iterTimes =
+				iterBlobs->second.begin();
 
-					BlobQuantities & quants = iterTimes->second;
-					for (int i = 0; i < vecOutputVars.size(); i++) {
+			for (; iterTimes != iterBlobs->second.end(); iterTimes++) {
 
-						// Bounding box coordinates
-						double dLat0 = dataLatDeg[quants.box.lat[0]];
-						double dLat1 = dataLatDeg[quants.box.lat[1]];
-						double dLon0 = dataLonDeg[quants.box.lon[0]];
-						double dLon1 = dataLonDeg[quants.box.lon[1]];
+				fprintf(fpout, "%i", iterTimes->first);
 
-						// Minimum latitude
-						if (vecOutputVars[i] == BlobQuantities::MinLat) {
-							if (fFlippedLat) {
-								fprintf(fpout, "\t%1.5f", dLat1);
-							} else {
-								fprintf(fpout, "\t%1.5f", dLat0);
-							}
-						}
+				BlobQuantities & quants = iterTimes->second;
+				for (int i = 0; i < vecOutputVars.size(); i++) {
 
-						// Maximum latitude
-						if (vecOutputVars[i] == BlobQuantities::MaxLat) {
-							if (fFlippedLat) {
-								fprintf(fpout, "\t%1.5f", dLat0);
-							} else {
-								fprintf(fpout, "\t%1.5f", dLat1);
-							}
-						}
+					// Bounding box coordinates
+					double dLat0 = dataLatDeg[quants.box.lat[0]];
+					double dLat1 = dataLatDeg[quants.box.lat[1]];
+					double dLon0 = dataLonDeg[quants.box.lon[0]];
+					double dLon1 = dataLonDeg[quants.box.lon[1]];
 
-						// Minimum longitude
-						if (vecOutputVars[i] == BlobQuantities::MinLon) {
-							fprintf(fpout, "\t%1.5f", dLon0);
+					// Minimum latitude
+					if (vecOutputVars[i] == BlobQuantities::MinLat) {
+						if (fFlippedLat) {
+							fprintf(fpout, "\t%1.5f", dLat1);
+						} else {
+							fprintf(fpout, "\t%1.5f", dLat0);
 						}
+					}
 
-						// Maximum longitude
-						if (vecOutputVars[i] == BlobQuantities::MaxLon) {
-							fprintf(fpout, "\t%1.5f", dLon1);
+					// Maximum latitude
+					if (vecOutputVars[i] == BlobQuantities::MaxLat) {
+						if (fFlippedLat) {
+							fprintf(fpout, "\t%1.5f", dLat0);
+						} else {
+							fprintf(fpout, "\t%1.5f", dLat1);
 						}
+					}
 
-						// Centroid latitude
-						if (vecOutputVars[i] == BlobQuantities::CentroidLat) {
-							double dMidLat = 0.5 * (dLat0 + dLat1);
+					// Minimum longitude
+					if (vecOutputVars[i] == BlobQuantities::MinLon) {
+						fprintf(fpout, "\t%1.5f", dLon0);
+					}
 
-							fprintf(fpout, "\t%1.5f", dMidLat);
-						}
+					// Maximum longitude
+					if (vecOutputVars[i] == BlobQuantities::MaxLon) {
+						fprintf(fpout, "\t%1.5f", dLon1);
+					}
 
-						// Centroid longitude
-						if (vecOutputVars[i] == BlobQuantities::CentroidLon) {
-							double dMidLon;
-							if (dLon0 <= dLon1) {
-								dMidLon = 0.5 * (dLon0 + dLon1);
-							} else {
-								dMidLon = 0.5 * (dLon0 + dLon1 + 360.0);
-								if (dMidLon > 360.0) {
-									dMidLon -= 360.0;
-								}
-							}
+					// Centroid latitude
+					if (vecOutputVars[i] == BlobQuantities::CentroidLat) {
+						double dMidLat = 0.5 * (dLat0 + dLat1);
 
-							fprintf(fpout, "\t%1.5f", dMidLon);
-						}
+						fprintf(fpout, "\t%1.5f", dMidLat);
+					}
 
-						// Area
-						if (vecOutputVars[i] == BlobQuantities::Area) {
-							fprintf(fpout, "\t%1.5f", quants.dArea);
+					// Centroid longitude
+					if (vecOutputVars[i] == BlobQuantities::CentroidLon) {
+						double dMidLon;
+						if (dLon0 <= dLon1) {
+							dMidLon = 0.5 * (dLon0 + dLon1);
+						} else {
+							dMidLon = 0.5 * (dLon0 + dLon1 + 360.0);
+							if (dMidLon > 360.0) {
+								dMidLon -= 360.0;
+							}
 						}
+
+						fprintf(fpout, "\t%1.5f", dMidLon);
+					}
+
+					// Area
+					if (vecOutputVars[i] == BlobQuantities::Area) {
+						fprintf(fpout, "\t%1.5f", quants.dArea);
 					}
 
-					// Endline
-					fprintf(fpout, "\n");
+					// Area-weighted mean of field variable
+					if (vecOutputVars[i] == BlobQuantities::FieldMean) {
+						fprintf(fpout, "\t%1.5e",
+							quants.dFieldSum / quants.dArea);
+					}
+
+					// Maximum of field variable
+					if (vecOutputVars[i] == BlobQuantities::FieldMax) {
+						fprintf(fpout, "\t%1.5e", quants.dFieldMax);
+					}
 				}
+
+				// Endline
+				fprintf(fpout, "\n");
 			}
 		}
 	}
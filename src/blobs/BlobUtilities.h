@@ -27,6 +27,7 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <cmath>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -279,6 +280,183 @@ public:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		Radius of the Earth (in m).
+///	</summary>
+static const double EarthRadius = 6.37122e6;
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Metrics associated with a regular latitude-longitude grid, shared
+///		among the blob tools.  Cell areas are a function of latitude only
+///		and cumulative row areas allow the area of any bounding box to be
+///		computed in constant time.
+///	</summary>
+class LatLonGridMetrics {
+
+public:
+	///	<summary>
+	///		Initialize from latitude and longitude arrays (in degrees).
+	///		Areas are scaled by the square of dRadius.
+	///	</summary>
+	void Initialize(
+		const DataVector<double> & dataLatDeg,
+		const DataVector<double> & dataLonDeg,
+		double dRadius
+	) {
+		int nLat = dataLatDeg.GetRows();
+		int nLon = dataLonDeg.GetRows();
+
+		if ((nLat == 0) || (nLon == 0)) {
+			_EXCEPTIONT("Latitude-longitude grid must be non-empty");
+		}
+
+		m_dataLatDeg = dataLatDeg;
+		m_dataLonDeg = dataLonDeg;
+
+		// Calculate cell areas
+		double dDeltaLon = 2.0 * M_PI / static_cast<double>(nLon);
+		double dDeltaLat = M_PI / static_cast<double>(nLat);
+
+		m_dCellArea.Initialize(nLat);
+		for (int j = 0; j < nLat; j++) {
+			m_dCellArea[j] =
+				dRadius
+				* dRadius
+				* cos(m_dataLatDeg[j] * M_PI / 180.0)
+				* dDeltaLon
+				* dDeltaLat;
+		}
+
+		// Cumulative cell areas (sum of one cell from each of rows [0,j))
+		m_dCumulativeCellArea.Initialize(nLat+1);
+		for (int j = 0; j < nLat; j++) {
+			m_dCumulativeCellArea[j+1] =
+				m_dCumulativeCellArea[j] + m_dCellArea[j];
+		}
+	}
+
+	///	<summary>
+	///		Initialize from the "lat" and "lon" variables of a NetCDF file.
+	///	</summary>
+	void Initialize(
+		NcFile & ncFile,
+		double dRadius
+	) {
+		NcDim * dimLat = ncFile.get_dim("lat");
+		if (dimLat == NULL) {
+			_EXCEPTIONT("No dimension \"lat\" found in input file");
+		}
+
+		NcDim * dimLon = ncFile.get_dim("lon");
+		if (dimLon == NULL) {
+			_EXCEPTIONT("No dimension \"lon\" found in input file");
+		}
+
+		NcVar * varLat = ncFile.get_var("lat");
+		if (varLat == NULL) {
+			_EXCEPTIONT("No variable \"lat\" found in input file");
+		}
+
+		NcVar * varLon = ncFile.get_var("lon");
+		if (varLon == NULL) {
+			_EXCEPTIONT("No variable \"lon\" found in input file");
+		}
+
+		int nLat = dimLat->size();
+		int nLon = dimLon->size();
+
+		DataVector<double> dataLatDeg(nLat);
+		DataVector<double> dataLonDeg(nLon);
+
+		varLat->get(dataLatDeg, nLat);
+		varLon->get(dataLonDeg, nLon);
+
+		Initialize(dataLatDeg, dataLonDeg, dRadius);
+	}
+
+public:
+	///	<summary>
+	///		Number of latitudes.
+	///	</summary>
+	inline int GetLatCount() const {
+		return m_dataLatDeg.GetRows();
+	}
+
+	///	<summary>
+	///		Number of longitudes.
+	///	</summary>
+	inline int GetLonCount() const {
+		return m_dataLonDeg.GetRows();
+	}
+
+	///	<summary>
+	///		Latitudes (in degrees).
+	///	</summary>
+	inline const DataVector<double> & GetLatDeg() const {
+		return m_dataLatDeg;
+	}
+
+	///	<summary>
+	///		Longitudes (in degrees).
+	///	</summary>
+	inline const DataVector<double> & GetLonDeg() const {
+		return m_dataLonDeg;
+	}
+
+	///	<summary>
+	///		Cell areas as a function of latitude index.
+	///	</summary>
+	inline const DataVector<double> & GetCellArea() const {
+		return m_dCellArea;
+	}
+
+	///	<summary>
+	///		Area of a cell in the given row.
+	///	</summary>
+	inline double CellArea(int iLat) const {
+		return m_dCellArea[iLat];
+	}
+
+	///	<summary>
+	///		Sum of one cell area from each row in [iLat0, iLat1].
+	///	</summary>
+	inline double ColumnArea(int iLat0, int iLat1) const {
+		return (m_dCumulativeCellArea[iLat1+1] - m_dCumulativeCellArea[iLat0]);
+	}
+
+	///	<summary>
+	///		Area of all cells within a bounding box.
+	///	</summary>
+	inline double BoxArea(const LatLonBox & box) const {
+		if (box.is_null) {
+			return 0.0;
+		}
+		return ColumnArea(box.lat[0], box.lat[1])
+			* static_cast<double>(box.Width(GetLonCount()));
+	}
+
+protected:
+	///	<summary>
+	///		Latitudes and longitudes (in degrees).
+	///	</summary>
+	DataVector<double> m_dataLatDeg;
+	DataVector<double> m_dataLonDeg;
+
+	///	<summary>
+	///		Cell areas as a function of latitude index.
+	///	</summary>
+	DataVector<double> m_dCellArea;
+
+	///	<summary>
+	///		Cumulative cell areas as a function of latitude index.
+	///	</summary>
+	DataVector<double> m_dCumulativeCellArea;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 ///	<summary>
 ///		Load in the contents of a text file containing one filename per
 ///		line and store in a vector of strings.
@@ -38,10 +38,6 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 
-static const double EarthRadius = 6.37122e6;
-
-///////////////////////////////////////////////////////////////////////////////
-
 struct Tag {
 
 	///	<summary>
@@ -260,14 +256,13 @@ public:
 	///		Verify that the specified path satisfies the threshold op.
 	///	</summary>
 	bool Apply(
-		const DataVector<double> & dCellArea,
-		const DataVector<double> & dLatDeg,
-		const DataVector<double> & dLonDeg,
+		const LatLonGridMetrics & grid,
 		const IndicatorSet & setBlobPoints,
 		const LatLonBox & boxBlob
-	) {
-		// Number of longitudes
-		int nLonCount = dLonDeg.GetRows();
+	) const {
+		const DataVector<double> & dLatDeg = grid.GetLatDeg();
+		const DataVector<double> & dLonDeg = grid.GetLonDeg();
+		const DataVector<double> & dCellArea = grid.GetCellArea();
 
 		// Thresholds related to area
 		if ((m_eQuantity == MinArea) ||
@@ -275,42 +270,52 @@ public:
 		    (m_eQuantity == MinArealFraction) ||
 		    (m_eQuantity == MaxArealFraction)
 		) {
-			double dBoxArea = 0.0;
-			double dBlobArea = 0.0;
+			// Calculate the area of the blob box
+			double dBoxArea = grid.BoxArea(boxBlob);
 
-			// Calculate the area of each blob box
-			for (int i = boxBlob.lat[0]; i <= boxBlob.lat[1]; i++) {
-				dBoxArea += dCellArea[i]
-					* static_cast<double>(boxBlob.Width(nLonCount));
+			// Area against which the blob area is compared
+			double dThresholdArea = m_dValue;
+			if ((m_eQuantity == MinArealFraction) ||
+			    (m_eQuantity == MaxArealFraction)
+			) {
+				dThresholdArea = m_dValue * dBoxArea;
 			}
 
-			// Calculate the area and mean lat/lon of each blob
-			IndicatorSetIterator iterBlob = setBlobPoints.begin();
-			for (; iterBlob != setBlobPoints.end(); iterBlob++) {
-				dBlobArea += dCellArea[iterBlob->lat];
+			bool fMinimum =
+				((m_eQuantity == MinArea) ||
+				 (m_eQuantity == MinArealFraction));
+
+			// The blob is contained in its bounding box
+			if (fMinimum && (dBoxArea < dThresholdArea)) {
+				return false;
+			}
+			if (!fMinimum && (dBoxArea <= dThresholdArea)) {
+				return true;
 			}
 
-			// Minimum area
-			if (m_eQuantity == MinArea) {
-				if (dBlobArea < m_dValue) {
-					return false;
-				}
+			// Calculate the area of the blob, stopping as soon as the
+			// threshold area is exceeded
+			double dBlobArea = 0.0;
+			bool fExceedsThreshold = false;
 
-			// Maximum area
-			} else if (m_eQuantity == MaxArea) {
-				if (dBlobArea > m_dValue) {
-					return false;
+			IndicatorSetConstIterator iterBlob = setBlobPoints.begin();
+			for (; iterBlob != setBlobPoints.end(); iterBlob++) {
+				dBlobArea += dCellArea[iterBlob->lat];
+				if (dBlobArea > dThresholdArea) {
+					fExceedsThreshold = true;
+					break;
 				}
+			}
 
-			// Minimum areal fraction
-			} else if (m_eQuantity == MinArealFraction) {
-				if (dBlobArea < m_dValue * dBoxArea) {
+			// Minimum area or areal fraction
+			if (fMinimum) {
+				if ((!fExceedsThreshold) && (dBlobArea < dThresholdArea)) {
 					return false;
 				}
 
-			// Maximum areal fraction
-			} else if (m_eQuantity == MaxArealFraction) {
-				if (dBlobArea > m_dValue * dBoxArea) {
+			// Maximum area or areal fraction
+			} else {
+				if (fExceedsThreshold) {
 					return false;
 				}
 			}
@@ -779,18 +784,8 @@ try {
 		AnnounceEndBlock("Done");
 	}
 
-	// Load in spatial dimension data
-	int nLat;
-	int nLon;
-
-	DataVector<double> dataLatDeg;
-	DataVector<double> dataLatRad;
-
-	DataVector<double> dataLonDeg;
-	DataVector<double> dataLonRad;
-
-	// Cell areas as a function of latitude index
-	DataVector<double> dCellArea;
+	// Load in spatial dimension data and grid metrics (areas in m^2)
+	LatLonGridMetrics grid;
 
 	{
 		// Load the first netcdf input file
@@ -801,64 +796,18 @@ try {
 				vecInputFiles[0].c_str());
 		}
 
-		// Get latitude/longitude dimensions
-		NcDim * dimLat = ncInput.get_dim("lat");
-		if (dimLat == NULL) {
-			_EXCEPTIONT("No dimension \"lat\" found in input file");
-		}
-
-		NcDim * dimLon = ncInput.get_dim("lon");
-		if (dimLon == NULL) {
-			_EXCEPTIONT("No dimension \"lon\" found in input file");
-		}
-
-		NcVar * varLat = ncInput.get_var("lat");
-		if (varLat == NULL) {
-			_EXCEPTIONT("No variable \"lat\" found in input file");
-		}
-
-		NcVar * varLon = ncInput.get_var("lon");
-		if (varLon == NULL) {
-			_EXCEPTIONT("No variable \"lon\" found in input file");
-		}
-
-		nLat = dimLat->size();
-		nLon = dimLon->size();
-
-		dataLatDeg.Initialize(nLat);
-		dataLatRad.Initialize(nLat);
-
-		dataLonDeg.Initialize(nLon);
-		dataLonRad.Initialize(nLon);
-
-		varLat->get(dataLatDeg, nLat);
-		for (int j = 0; j < nLat; j++) {
-			dataLatRad[j] = dataLatDeg[j] * M_PI / 180.0;
-		}
-
-		varLon->get(dataLonDeg, nLon);
-		for (int i = 0; i < nLon; i++) {
-			dataLonRad[i] = dataLonDeg[i] * M_PI / 180.0;
-		}
-
-		// Calculate cell areas in m^2
-		double dDeltaLon = 2.0 * M_PI / static_cast<double>(nLon);
-		double dDeltaLat = M_PI / static_cast<double>(nLat);
-
-		dCellArea.Initialize(nLat);
-		for (int j = 0; j < nLat; j++) {
-			dCellArea[j] =
-				EarthRadius
-				* EarthRadius
-				* cos(dataLatRad[j])
-				* dDeltaLon
-				* dDeltaLat;
-		}
+		grid.Initialize(ncInput, EarthRadius);
 
 		// Close first netcdf file
 		ncInput.close();
 	}
 
+	int nLat = grid.GetLatCount();
+	int nLon = grid.GetLonCount();
+
+	const DataVector<double> & dataLatDeg = grid.GetLatDeg();
+	const DataVector<double> & dataLonDeg = grid.GetLonDeg();
+
 	// Get time dimension over all files
 	DataVector<double> dTime;
 	GetAllTimes(vecInputFiles, dTime);
@@ -1134,9 +1083,7 @@ try {
 
 						bool fSatisfies =
 							vecThresholdOp[x].Apply(
-								dCellArea,
-								dataLatDeg,
-								dataLonDeg,
+								grid,
 								vecBlobs[ixBlob],
 								box);
 
@@ -35,10 +35,15 @@
 #include <string>
 #include <set>
 #include <map>
+#include <algorithm>
 
-///////////////////////////////////////////////////////////////////////////////
+#if defined(TEMPEST_MPIOMP)
+#include <mpi.h>
+#endif
 
-static const double EarthRadius = 6.37122e6;
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -105,6 +110,45 @@ struct Tag {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		A structure storing the overlap between a blob at one time and a
+///		blob at the previous time.
+///	</summary>
+struct BlobOverlap {
+
+	///	<summary>
+	///		Time index of the current blob.
+	///	</summary>
+	int time;
+
+	///	<summary>
+	///		Index of the blob at the previous time.
+	///	</summary>
+	int ixPrev;
+
+	///	<summary>
+	///		Index of the blob at the current time.
+	///	</summary>
+	int ixCurr;
+
+	///	<summary>
+	///		Area of the overlap region (in m^2).
+	///	</summary>
+	double dArea;
+
+	///	<summary>
+	///		Value-based constructor.
+	///	</summary>
+	BlobOverlap(int a_time, int a_ixPrev, int a_ixCurr, double a_dArea) :
+		time(a_time),
+		ixPrev(a_ixPrev),
+		ixCurr(a_ixCurr),
+		dArea(a_dArea)
+	{ }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 // Set of indicator locations stored as latitude-longitude pairs
 typedef std::set<LatLonPair> IndicatorSet;
 typedef IndicatorSet::iterator IndicatorSetIterator;
@@ -260,14 +304,13 @@ public:
 	///		Verify that the specified path satisfies the threshold op.
 	///	</summary>
 	bool Apply(
-		const DataVector<double> & dCellArea,
-		const DataVector<double> & dLatDeg,
-		const DataVector<double> & dLonDeg,
+		const LatLonGridMetrics & grid,
 		const IndicatorSet & setBlobPoints,
 		const LatLonBox & boxBlob
-	) {
-		// Number of longitudes
-		int nLonCount = dLonDeg.GetRows();
+	) const {
+		const DataVector<double> & dLatDeg = grid.GetLatDeg();
+		const DataVector<double> & dLonDeg = grid.GetLonDeg();
+		const DataVector<double> & dCellArea = grid.GetCellArea();
 
 		// Thresholds related to area
 		if ((m_eQuantity == MinArea) ||
@@ -275,42 +318,52 @@ public:
 		    (m_eQuantity == MinArealFraction) ||
 		    (m_eQuantity == MaxArealFraction)
 		) {
-			double dBoxArea = 0.0;
-			double dBlobArea = 0.0;
+			// Calculate the area of the blob box
+			double dBoxArea = grid.BoxArea(boxBlob);
 
-			// Calculate the area of each blob box
-			for (int i = boxBlob.lat[0]; i <= boxBlob.lat[1]; i++) {
-				dBoxArea += dCellArea[i]
-					* static_cast<double>(boxBlob.Width(nLonCount));
+			// Area against which the blob area is compared
+			double dThresholdArea = m_dValue;
+			if ((m_eQuantity == MinArealFraction) ||
+			    (m_eQuantity == MaxArealFraction)
+			) {
+				dThresholdArea = m_dValue * dBoxArea;
 			}
 
-			// Calculate the area and mean lat/lon of each blob
-			IndicatorSetIterator iterBlob = setBlobPoints.begin();
-			for (; iterBlob != setBlobPoints.end(); iterBlob++) {
-				dBlobArea += dCellArea[iterBlob->lat];
+			bool fMinimum =
+				((m_eQuantity == MinArea) ||
+				 (m_eQuantity == MinArealFraction));
+
+			// The blob is contained in its bounding box
+			if (fMinimum && (dBoxArea < dThresholdArea)) {
+				return false;
+			}
+			if (!fMinimum && (dBoxArea <= dThresholdArea)) {
+				return true;
 			}
 
-			// Minimum area
-			if (m_eQuantity == MinArea) {
-				if (dBlobArea < m_dValue) {
-					return false;
-				}
+			// Calculate the area of the blob, stopping as soon as the
+			// threshold area is exceeded
+			double dBlobArea = 0.0;
+			bool fExceedsThreshold = false;
 
-			// Maximum area
-			} else if (m_eQuantity == MaxArea) {
-				if (dBlobArea > m_dValue) {
-					return false;
+			IndicatorSetConstIterator iterBlob = setBlobPoints.begin();
+			for (; iterBlob != setBlobPoints.end(); iterBlob++) {
+				dBlobArea += dCellArea[iterBlob->lat];
+				if (dBlobArea > dThresholdArea) {
+					fExceedsThreshold = true;
+					break;
 				}
+			}
 
-			// Minimum areal fraction
-			} else if (m_eQuantity == MinArealFraction) {
-				if (dBlobArea < m_dValue * dBoxArea) {
+			// Minimum area or areal fraction
+			if (fMinimum) {
+				if ((!fExceedsThreshold) && (dBlobArea < dThresholdArea)) {
 					return false;
 				}
 
-			// Maximum areal fraction
-			} else if (m_eQuantity == MaxArealFraction) {
-				if (dBlobArea > m_dValue * dBoxArea) {
+			// Maximum area or areal fraction
+			} else {
+				if (fExceedsThreshold) {
 					return false;
 				}
 			}
@@ -652,10 +705,369 @@ protected:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		Diagnostics from blob detection at a single time.
+///	</summary>
+struct BlobDetectionStats {
+
+	///	<summary>
+	///		Number of tagged points.
+	///	</summary>
+	int nTaggedPoints;
+
+	///	<summary>
+	///		Number of blobs rejected due to insufficient node count.
+	///	</summary>
+	int nRejectedMinSize;
+
+	///	<summary>
+	///		Number of blobs rejected by each threshold operator.
+	///	</summary>
+	std::vector<int> vecRejectedThreshold;
+
+	///	<summary>
+	///		Default constructor.
+	///	</summary>
+	BlobDetectionStats() :
+		nTaggedPoints(0),
+		nRejectedMinSize(0)
+	{ }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Build the set of blobs from the indicator field at a single time.
+///		This function only depends on its arguments, so it may be called
+///		concurrently for different time levels.
+///	</summary>
+void BuildBlobsAtTime(
+	DataMatrix<int> & dataIndicator,
+	const LatLonGridMetrics & grid,
+	double dMinLat,
+	double dMaxLat,
+	double dMinLon,
+	double dMaxLon,
+	bool fRegional,
+	int nMinBlobSize,
+	const std::vector<BlobThresholdOp> & vecThresholdOp,
+	std::vector<IndicatorSet> & vecBlobs,
+	std::vector<LatLonBox> & vecBlobBoxes,
+	BlobDetectionStats & stats
+) {
+	int nLat = grid.GetLatCount();
+	int nLon = grid.GetLonCount();
+
+	const DataVector<double> & dataLatDeg = grid.GetLatDeg();
+	const DataVector<double> & dataLonDeg = grid.GetLonDeg();
+
+	// Buffer variables used for looping through indicators
+	IndicatorSet setIndicators;
+	IndicatorSet setNeighbors;
+
+	// Elminate detections out of range
+	if ((dMinLat != -90.0) || (dMaxLat != 90.0) ||
+	    (dMinLon != 0.0) || (dMaxLon != 360.0)
+	) {
+		for (int j = 0; j < nLat; j++) {
+		for (int i = 0; i < nLon; i++) {
+			if (dataIndicator[j][i] != 0) {
+				if ((dMinLat != -90.0) || (dMaxLat != 90.0)) {
+					if (dataLatDeg[j] < dMinLat) {
+						dataIndicator[j][i] = 0;
+					}
+					if (dataLatDeg[j] > dMaxLat) {
+						dataIndicator[j][i] = 0;
+					}
+				}
+				if ((dMinLon != 0.0) || (dMaxLon != 360.0)) {
+					if (dMinLon < dMaxLon) {
+						if (dataLonDeg[i] < dMinLon) {
+							dataIndicator[j][i] = 0;
+						}
+						if (dataLonDeg[i] > dMaxLon) {
+							dataIndicator[j][i] = 0;
+						}
+
+					} else {
+						if ((dataLonDeg[i] < dMinLon) &&
+						    (dataLonDeg[i] > dMaxLon)
+						) {
+							dataIndicator[j][i] = 0;
+						}
+					}
+				}
+			}
+		}
+		}
+	}
+
+	// Insert all detected locations into set
+	for (int j = 0; j < nLat; j++) {
+	for (int i = 0; i < nLon; i++) {
+		if (dataIndicator[j][i] != 0) {
+			setIndicators.insert( LatLonPair(j, i));
+		}
+	}
+	}
+
+	stats.nTaggedPoints = setIndicators.size();
+
+	// Rejections due to insufficient node count
+	stats.nRejectedMinSize = 0;
+	stats.vecRejectedThreshold.clear();
+	stats.vecRejectedThreshold.resize(vecThresholdOp.size(), 0);
+
+	// Find all patches
+	for (; setIndicators.size() != 0;) {
+
+		// Next starting location
+		LatLonPair pr = *(setIndicators.begin());
+
+		// Current patch
+		int ixBlob = vecBlobs.size();
+		vecBlobs.resize(ixBlob+1);
+		vecBlobBoxes.resize(ixBlob+1);
+
+		// Initialize bounding box
+		LatLonBox & box = vecBlobBoxes[ixBlob];
+
+		box.lat[0] = pr.lat;
+		box.lat[1] = pr.lat;
+		box.lon[0] = pr.lon;
+		box.lon[1] = pr.lon;
+
+		// Find all connecting elements in patch
+		setNeighbors.clear();
+		setNeighbors.insert(pr);
+		while (setNeighbors.size() != 0) {
+			pr = *(setNeighbors.begin());
+			setNeighbors.erase(setNeighbors.begin());
+
+			// This node is already included in the patch
+			if (vecBlobs[ixBlob].find(pr) !=
+				vecBlobs[ixBlob].end()
+			) {
+				continue;
+			}
+
+			// This node has not been tagged
+			IndicatorSetIterator iterIndicator = setIndicators.find(pr);
+			if (iterIndicator == setIndicators.end()) {
+				continue;
+			}
+
+			// Remove this from the set of available indicators
+			setIndicators.erase(iterIndicator);
+
+			// Insert the node into the patch
+			vecBlobs[ixBlob].insert(pr);
+
+			// Update bounding box
+			box.InsertPoint(pr.lat, pr.lon, nLat, nLon);
+
+			// Insert neighbors (regional case)
+			if (fRegional) {
+				setNeighbors.insert(
+					LatLonPair(pr.lat, pr.lon));
+
+				if (pr.lon != 0) {
+					setNeighbors.insert(
+						LatLonPair(pr.lat, pr.lon-1));
+				}
+				if (pr.lon != nLon-1) {
+					setNeighbors.insert(
+						LatLonPair(pr.lat, pr.lon+1));
+				}
+
+				if (pr.lat != 0) {
+					setNeighbors.insert(
+						LatLonPair(pr.lat-1, pr.lon));
+
+					if (pr.lon != 0) {
+						setNeighbors.insert(
+							LatLonPair(pr.lat-1, pr.lon-1));
+					}
+					if (pr.lon != nLon-1) {
+						setNeighbors.insert(
+							LatLonPair(pr.lat-1, pr.lon+1));
+					}
+				}
+
+				if (pr.lat != nLat-1) {
+					setNeighbors.insert(
+						LatLonPair(pr.lat+1, pr.lon));
+
+					if (pr.lon != 0) {
+						setNeighbors.insert(
+							LatLonPair(pr.lat+1, pr.lon-1));
+					}
+					if (pr.lon != nLon-1) {
+						setNeighbors.insert(
+							LatLonPair(pr.lat+1, pr.lon+1));
+					}
+				}
+
+			// Insert neighbors (global case)
+			} else if (pr.lat == 0) {
+				for (int i = 0; i < nLon; i++) {
+					setNeighbors.insert(LatLonPair(0, i));
+				}
+				setNeighbors.insert(LatLonPair(1, (pr.lon+nLon-1)%nLon));
+				setNeighbors.insert(LatLonPair(1, pr.lon));
+				setNeighbors.insert(LatLonPair(1, (pr.lon+1)%nLon));
+
+			} else if (pr.lat == nLat - 1) {
+				for (int i = 0; i < nLon; i++) {
+					setNeighbors.insert(LatLonPair(nLat-1, i));
+				}
+				setNeighbors.insert(
+					LatLonPair(nLat-2, (pr.lon+nLon-1)%nLon));
+				setNeighbors.insert(
+					LatLonPair(nLat-2, pr.lon));
+				setNeighbors.insert(
+					LatLonPair(nLat-2, (pr.lon+1)%nLon));
+
+			} else {
+
+				setNeighbors.insert(
+					LatLonPair(pr.lat+1, (pr.lon+nLon-1)%nLon));
+				setNeighbors.insert(
+					LatLonPair(pr.lat  , (pr.lon+nLon-1)%nLon));
+				setNeighbors.insert(
+					LatLonPair(pr.lat-1, (pr.lon+nLon-1)%nLon));
+
+				setNeighbors.insert(
+					LatLonPair(pr.lat+1, pr.lon));
+				setNeighbors.insert(
+					LatLonPair(pr.lat-1, pr.lon));
+
+				setNeighbors.insert(
+					LatLonPair(pr.lat+1, (pr.lon+1)%nLon));
+				setNeighbors.insert(
+					LatLonPair(pr.lat,   (pr.lon+1)%nLon));
+				setNeighbors.insert(
+					LatLonPair(pr.lat-1, (pr.lon+1)%nLon));
+			}
+		}
+
+		// Check patch size
+		if (vecBlobs[ixBlob].size() < nMinBlobSize) {
+			stats.nRejectedMinSize++;
+			vecBlobs.resize(ixBlob);
+			vecBlobBoxes.resize(ixBlob);
+
+		// Check other thresholds
+		} else {
+			for (int x = 0; x < vecThresholdOp.size(); x++) {
+
+				bool fSatisfies =
+					vecThresholdOp[x].Apply(
+						grid,
+						vecBlobs[ixBlob],
+						box);
+
+				if (!fSatisfies) {
+					stats.vecRejectedThreshold[x]++;
+					vecBlobs.resize(ixBlob);
+					vecBlobBoxes.resize(ixBlob);
+					break;
+				}
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+#if defined(TEMPEST_MPIOMP)
+///	<summary>
+///		Pack the blobs at a range of times into a flat integer buffer.
+///		Each time is stored as the number of blobs followed by, for each
+///		blob, its bounding box, its point count and its points.
+///	</summary>
+void PackBlobs(
+	const std::vector< std::vector<IndicatorSet> > & vecAllBlobs,
+	const std::vector< std::vector<LatLonBox> > & vecAllBlobBoxes,
+	int iTimeBegin,
+	int iTimeEnd,
+	std::vector<int> & vecBuffer
+) {
+	vecBuffer.clear();
+
+	for (int t = iTimeBegin; t < iTimeEnd; t++) {
+		vecBuffer.push_back(vecAllBlobs[t].size());
+
+		for (int p = 0; p < vecAllBlobs[t].size(); p++) {
+			const LatLonBox & box = vecAllBlobBoxes[t][p];
+			vecBuffer.push_back(box.lat[0]);
+			vecBuffer.push_back(box.lat[1]);
+			vecBuffer.push_back(box.lon[0]);
+			vecBuffer.push_back(box.lon[1]);
+
+			vecBuffer.push_back(vecAllBlobs[t][p].size());
+
+			IndicatorSetConstIterator iter = vecAllBlobs[t][p].begin();
+			for (; iter != vecAllBlobs[t][p].end(); iter++) {
+				vecBuffer.push_back(iter->lat);
+				vecBuffer.push_back(iter->lon);
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Unpack the blobs at a range of times from a flat integer buffer
+///		produced by PackBlobs.
+///	</summary>
+void UnpackBlobs(
+	const int * pBuffer,
+	int iTimeBegin,
+	int iTimeEnd,
+	std::vector< std::vector<IndicatorSet> > & vecAllBlobs,
+	std::vector< std::vector<LatLonBox> > & vecAllBlobBoxes
+) {
+	int ix = 0;
+	for (int t = iTimeBegin; t < iTimeEnd; t++) {
+		int nBlobs = pBuffer[ix++];
+
+		vecAllBlobs[t].resize(nBlobs);
+		vecAllBlobBoxes[t].resize(nBlobs);
+
+		for (int p = 0; p < nBlobs; p++) {
+			LatLonBox & box = vecAllBlobBoxes[t][p];
+			box.is_null = false;
+			box.lat[0] = pBuffer[ix++];
+			box.lat[1] = pBuffer[ix++];
+			box.lon[0] = pBuffer[ix++];
+			box.lon[1] = pBuffer[ix++];
+
+			int nPoints = pBuffer[ix++];
+			for (int i = 0; i < nPoints; i++, ix += 2) {
+				vecAllBlobs[t][p].insert(
+					LatLonPair(pBuffer[ix], pBuffer[ix+1]));
+			}
+		}
+	}
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
 int main(int argc, char** argv) {
 
+#if defined(TEMPEST_MPIOMP)
+	// Initialize MPI
+	MPI_Init(&argc, &argv);
+#endif
+
 	NcError error(NcError::silent_nonfatal);
 
+	// Enable output only on rank zero
+	AnnounceOnlyOutputOnRankZero();
+
 try {
 
 	// Input file
@@ -697,6 +1109,24 @@ try {
 	// Threshold commands
 	std::string strThresholdCmd;
 
+	// Output file for overlap areas between blobs at adjacent times
+	std::string strOverlapFile;
+
+	// Output file for merge and split events
+	std::string strEventFile;
+
+	// Deflate level for NetCDF-4 output (0 for classic output)
+	int iDeflateLevel;
+
+	// Disable the shuffle filter for NetCDF-4 output
+	bool fNoShuffle;
+
+	// Number of time levels per chunk for NetCDF-4 output
+	int nChunkTimes;
+
+	// Output file for sparse blob runs
+	std::string strSparseFile;
+
 	// Parse the command line
 	BeginCommandLine()
 		CommandLineString(strInputFile, "in", "");
@@ -712,6 +1142,12 @@ try {
 		CommandLineDouble(dMinLon, "minlon", 0.0);
 		CommandLineDouble(dMaxLon, "maxlon", 360.0);
 		CommandLineString(strThresholdCmd, "thresholdcmd", "");
+		CommandLineString(strOverlapFile, "outoverlap", "");
+		CommandLineString(strEventFile, "outevents", "");
+		CommandLineInt(iDeflateLevel, "deflate", 0);
+		CommandLineBool(fNoShuffle, "noshuffle");
+		CommandLineInt(nChunkTimes, "chunktime", 0);
+		CommandLineString(strSparseFile, "outsparse", "");
 
 		ParseCommandLine(argc, argv);
 	EndCommandLine(argv)
@@ -736,6 +1172,14 @@ try {
 		_EXCEPTIONT("No variable name (--var) specified");
 	}
 
+	// Check compression
+	if ((iDeflateLevel < 0) || (iDeflateLevel > 9)) {
+		_EXCEPTIONT("Deflate level (--deflate) must be between 0 and 9");
+	}
+	if (nChunkTimes < 0) {
+		_EXCEPTIONT("Time levels per chunk (--chunktime) must be nonnegative");
+	}
+
 	// Check output variable
 	if (strOutputVariable.length() == 0) {
 		strOutputVariable = strVariable + "tag";
@@ -753,6 +1197,15 @@ try {
 
 	int nFiles = vecInputFiles.size();
 
+#if defined(TEMPEST_MPIOMP)
+	// Spread time levels across ranks
+	int nMPIRank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &nMPIRank);
+
+	int nMPISize;
+	MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
+#endif
+
 	// Parse the threshold string
 	std::vector<BlobThresholdOp> vecThresholdOp;
 
@@ -779,18 +1232,8 @@ try {
 		AnnounceEndBlock("Done");
 	}
 
-	// Load in spatial dimension data
-	int nLat;
-	int nLon;
-
-	DataVector<double> dataLatDeg;
-	DataVector<double> dataLatRad;
-
-	DataVector<double> dataLonDeg;
-	DataVector<double> dataLonRad;
-
-	// Cell areas as a function of latitude index
-	DataVector<double> dCellArea;
+	// Load in spatial dimension data and grid metrics (areas in m^2)
+	LatLonGridMetrics grid;
 
 	{
 		// Load the first netcdf input file
@@ -801,80 +1244,73 @@ try {
 				vecInputFiles[0].c_str());
 		}
 
-		// Get latitude/longitude dimensions
-		NcDim * dimLat = ncInput.get_dim("lat");
-		if (dimLat == NULL) {
-			_EXCEPTIONT("No dimension \"lat\" found in input file");
-		}
+		grid.Initialize(ncInput, EarthRadius);
 
-		NcDim * dimLon = ncInput.get_dim("lon");
-		if (dimLon == NULL) {
-			_EXCEPTIONT("No dimension \"lon\" found in input file");
-		}
+		// Close first netcdf file
+		ncInput.close();
+	}
 
-		NcVar * varLat = ncInput.get_var("lat");
-		if (varLat == NULL) {
-			_EXCEPTIONT("No variable \"lat\" found in input file");
-		}
+	int nLat = grid.GetLatCount();
+	int nLon = grid.GetLonCount();
 
-		NcVar * varLon = ncInput.get_var("lon");
-		if (varLon == NULL) {
-			_EXCEPTIONT("No variable \"lon\" found in input file");
-		}
+	const DataVector<double> & dataLatDeg = grid.GetLatDeg();
+	const DataVector<double> & dataLonDeg = grid.GetLonDeg();
 
-		nLat = dimLat->size();
-		nLon = dimLon->size();
+	// Cell areas as a function of latitude index
+	const DataVector<double> & dCellArea = grid.GetCellArea();
 
-		dataLatDeg.Initialize(nLat);
-		dataLatRad.Initialize(nLat);
+	// Get time dimension over all files
+	DataVector<double> dTime;
+	GetAllTimes(vecInputFiles, dTime);
 
-		dataLonDeg.Initialize(nLon);
-		dataLonRad.Initialize(nLon);
+	int nTime = dTime.GetRows();
 
-		varLat->get(dataLatDeg, nLat);
-		for (int j = 0; j < nLat; j++) {
-			dataLatRad[j] = dataLatDeg[j] * M_PI / 180.0;
-		}
+	// Time offset of each input file in the global time index
+	std::vector<int> vecFileTimeOffset;
+	vecFileTimeOffset.resize(nFiles+1, 0);
 
-		varLon->get(dataLonDeg, nLon);
-		for (int i = 0; i < nLon; i++) {
-			dataLonRad[i] = dataLonDeg[i] * M_PI / 180.0;
+	for (int f = 0; f < nFiles; f++) {
+		NcFile ncInput(vecInputFiles[f].c_str());
+		if (!ncInput.is_valid()) {
+			_EXCEPTION1("Unable to open input file \"%s\"",
+				vecInputFiles[f].c_str());
 		}
 
-		// Calculate cell areas in m^2
-		double dDeltaLon = 2.0 * M_PI / static_cast<double>(nLon);
-		double dDeltaLat = M_PI / static_cast<double>(nLat);
-
-		dCellArea.Initialize(nLat);
-		for (int j = 0; j < nLat; j++) {
-			dCellArea[j] =
-				EarthRadius
-				* EarthRadius
-				* cos(dataLatRad[j])
-				* dDeltaLon
-				* dDeltaLat;
+		NcDim * dimTime = ncInput.get_dim("time");
+		if (dimTime == NULL) {
+			_EXCEPTIONT("No dimension \"time\" found in input file");
 		}
 
-		// Close first netcdf file
-		ncInput.close();
+		vecFileTimeOffset[f+1] = vecFileTimeOffset[f] + dimTime->size();
 	}
 
-	// Get time dimension over all files
-	DataVector<double> dTime;
-	GetAllTimes(vecInputFiles, dTime);
+	// Range of global time indices processed on this rank
+	int iTimeBegin = 0;
+	int iTimeEnd = nTime;
 
-	int nTime = dTime.GetRows();
+#if defined(TEMPEST_MPIOMP)
+	iTimeBegin = static_cast<int>(
+		static_cast<long>(nTime) * nMPIRank / nMPISize);
+	iTimeEnd = static_cast<int>(
+		static_cast<long>(nTime) * (nMPIRank + 1) / nMPISize);
+#endif
+
+	// Number of time levels loaded before parallel detection
+	int nBatchTimes = 1;
+#if defined(_OPENMP)
+	nBatchTimes = omp_get_max_threads();
+#endif
 
 	// Allocate indicator data
-	DataMatrix<int> dataIndicator(nLat, nLon);
+	std::vector< DataMatrix<int> > vecDataIndicator;
+	vecDataIndicator.resize(nBatchTimes);
+	for (int b = 0; b < nBatchTimes; b++) {
+		vecDataIndicator[b].Initialize(nLat, nLon);
+	}
 
 	// Build blobs at each time level
 	AnnounceStartBlock("Building blob set at each time level");
 
-	// Buffer variables used for looping through indicators
-	IndicatorSet setIndicators;
-	IndicatorSet setNeighbors;
-
 	///////////////////////////////////////////////////////////////////////////
 	// Build the set of nodes at each time contained in each blob
 	///////////////////////////////////////////////////////////////////////////
@@ -887,12 +1323,22 @@ try {
 	std::vector< std::vector<LatLonBox> > vecAllBlobBoxes;
 	vecAllBlobBoxes.resize(nTime);
 
-	// Time index across all files
-	int iTime = 0;
+	// Detection diagnostics at each time
+	std::vector<BlobDetectionStats> vecStats;
+	vecStats.resize(nTime);
 
 	// Loop through all files
 	for (int f = 0; f < nFiles; f++) {
 
+		// Range of local times in this file processed on this rank
+		int tBegin = std::max(iTimeBegin - vecFileTimeOffset[f], 0);
+		int tEnd = std::min(iTimeEnd, vecFileTimeOffset[f+1])
+			- vecFileTimeOffset[f];
+
+		if (tBegin >= tEnd) {
+			continue;
+		}
+
 		// Load in each file
 		NcFile ncInput(vecInputFiles[f].c_str());
 		if (!ncInput.is_valid()) {
@@ -900,11 +1346,6 @@ try {
 				vecInputFiles[f].c_str());
 		}
 
-		// Get current time dimension
-		NcDim * dimTime = ncInput.get_dim("time");
-
-		int nLocalTimes = dimTime->size();
-
 		// Load in indicator variable
 		NcVar * varIndicator = ncInput.get_var(strVariable.c_str());
 
@@ -918,255 +1359,71 @@ try {
 				strVariable.c_str());
 		}
 
-		// Loop through all times
-		for (int t = 0; t < nLocalTimes; t++, iTime++) {
+		// Loop through all times in batches
+		for (int tBatch = tBegin; tBatch < tEnd; tBatch += nBatchTimes) {
 
-			// Get the current patch vector
-			std::vector<IndicatorSet> & vecBlobs = vecAllBlobs[iTime];
+			int nBatch = std::min(nBatchTimes, tEnd - tBatch);
 
-			std::vector<LatLonBox> & vecBlobBoxes = vecAllBlobBoxes[iTime];
-
-			// New announcement block for timestep
-			char szStartBlock[128];
-			sprintf(szStartBlock, "Time %i (%i)", iTime, t);
-			AnnounceStartBlock(szStartBlock);
-
-			// Load in the data at this time
-			varIndicator->set_cur(t, 0, 0);
-			varIndicator->get(&(dataIndicator[0][0]), 1, nLat, nLon);
-
-			// Elminate detections out of range
-			if ((dMinLat != -90.0) || (dMaxLat != 90.0) ||
-			    (dMinLon != 0.0) || (dMaxLon != 360.0)
-			) {
-				for (int j = 0; j < nLat; j++) {
-				for (int i = 0; i < nLon; i++) {
-					if (dataIndicator[j][i] != 0) {
-						if ((dMinLat != -90.0) || (dMaxLat != 90.0)) {
-							if (dataLatDeg[j] < dMinLat) {
-								dataIndicator[j][i] = 0;
-							}
-							if (dataLatDeg[j] > dMaxLat) {
-								dataIndicator[j][i] = 0;
-							}
-						}
-						if ((dMinLon != 0.0) || (dMaxLon != 360.0)) {
-							if (dMinLon < dMaxLon) {
-								if (dataLonDeg[i] < dMinLon) {
-									dataIndicator[j][i] = 0;
-								}
-								if (dataLonDeg[i] > dMaxLon) {
-									dataIndicator[j][i] = 0;
-								}
-
-							} else {
-								if ((dataLonDeg[i] < dMinLon) &&
-								    (dataLonDeg[i] > dMaxLon)
-								) {
-									dataIndicator[j][i] = 0;
-								}
-							}
-						}
-					}
-				}
-				}
+			// Load in the data at these times (NetCDF is not thread-safe)
+			for (int b = 0; b < nBatch; b++) {
+				varIndicator->set_cur(tBatch + b, 0, 0);
+				varIndicator->get(&(vecDataIndicator[b][0][0]), 1, nLat, nLon);
 			}
 
-			// Insert all detected locations into set
-			for (int j = 0; j < nLat; j++) {
-			for (int i = 0; i < nLon; i++) {
-				if (dataIndicator[j][i] != 0) {
-					setIndicators.insert( LatLonPair(j, i));
-				}
-			}
+			// Detect blobs at each time independently
+#pragma omp parallel for schedule(dynamic)
+			for (int b = 0; b < nBatch; b++) {
+				int iTime = vecFileTimeOffset[f] + tBatch + b;
+
+				BuildBlobsAtTime(
+					vecDataIndicator[b],
+					grid,
+					dMinLat,
+					dMaxLat,
+					dMinLon,
+					dMaxLon,
+					fRegional,
+					nMinBlobSize,
+					vecThresholdOp,
+					vecAllBlobs[iTime],
+					vecAllBlobBoxes[iTime],
+					vecStats[iTime]);
 			}
 
-			Announce("Tagged points: %i", setIndicators.size());
-
-			// Rejections due to insufficient node count
-			int nRejectedMinSize = 0;
-
-			DataVector<int> nRejectedThreshold;
-			nRejectedThreshold.Initialize(vecThresholdOp.size());
-
-			// Find all patches
-			for (; setIndicators.size() != 0;) {
-
-				// Next starting location
-				LatLonPair pr = *(setIndicators.begin());
-
-				// Current patch
-				int ixBlob = vecBlobs.size();
-				vecBlobs.resize(ixBlob+1);
-				vecBlobBoxes.resize(ixBlob+1);
-
-				// Initialize bounding box
-				LatLonBox & box = vecBlobBoxes[ixBlob];
-
-				box.lat[0] = pr.lat;
-				box.lat[1] = pr.lat;
-				box.lon[0] = pr.lon;
-				box.lon[1] = pr.lon;
+			// Announce results in time order
+			for (int b = 0; b < nBatch; b++) {
+				int t = tBatch + b;
+				int iTime = vecFileTimeOffset[f] + t;
 
-				// Find all connecting elements in patch
-				setNeighbors.clear();
-				setNeighbors.insert(pr);
-				while (setNeighbors.size() != 0) {
-					pr = *(setNeighbors.begin());
-					setNeighbors.erase(setNeighbors.begin());
+				const std::vector<LatLonBox> & vecBlobBoxes =
+					vecAllBlobBoxes[iTime];
 
-					// This node is already included in the patch
-					if (vecBlobs[ixBlob].find(pr) !=
-						vecBlobs[ixBlob].end()
-					) {
-						continue;
-					}
-
-					// This node has not been tagged
-					IndicatorSetIterator iterIndicator = setIndicators.find(pr);
-					if (iterIndicator == setIndicators.end()) {
-						continue;
-					}
-
-					// Remove this from the set of available indicators
-					setIndicators.erase(iterIndicator);
+				const BlobDetectionStats & stats = vecStats[iTime];
 
-					// Insert the node into the patch
-					vecBlobs[ixBlob].insert(pr);
+				char szStartBlock[128];
+				sprintf(szStartBlock, "Time %i (%i)", iTime, t);
+				AnnounceStartBlock(szStartBlock);
 
-					// Update bounding box
-					box.InsertPoint(pr.lat, pr.lon, nLat, nLon);
+				Announce("Tagged points: %i", stats.nTaggedPoints);
 
-					// Insert neighbors (regional case)
-					if (fRegional) {
-						setNeighbors.insert(
-							LatLonPair(pr.lat, pr.lon));
-
-						if (pr.lon != 0) {
-							setNeighbors.insert(
-								LatLonPair(pr.lat, pr.lon-1));
-						}
-						if (pr.lon != nLon-1) {
-							setNeighbors.insert(
-								LatLonPair(pr.lat, pr.lon+1));
-						}
-
-						if (pr.lat != 0) {
-							setNeighbors.insert(
-								LatLonPair(pr.lat-1, pr.lon));
-
-							if (pr.lon != 0) {
-								setNeighbors.insert(
-									LatLonPair(pr.lat-1, pr.lon-1));
-							}
-							if (pr.lon != nLon-1) {
-								setNeighbors.insert(
-									LatLonPair(pr.lat-1, pr.lon+1));
-							}
-						}
-
-						if (pr.lat != nLat-1) {
-							setNeighbors.insert(
-								LatLonPair(pr.lat+1, pr.lon));
-
-							if (pr.lon != 0) {
-								setNeighbors.insert(
-									LatLonPair(pr.lat+1, pr.lon-1));
-							}
-							if (pr.lon != nLon-1) {
-								setNeighbors.insert(
-									LatLonPair(pr.lat+1, pr.lon+1));
-							}
-						}
-
-					// Insert neighbors (global case)
-					} else if (pr.lat == 0) {
-						for (int i = 0; i < nLon; i++) {
-							setNeighbors.insert(LatLonPair(0, i));
-						}
-						setNeighbors.insert(LatLonPair(1, (pr.lon+nLon-1)%nLon));
-						setNeighbors.insert(LatLonPair(1, pr.lon));
-						setNeighbors.insert(LatLonPair(1, (pr.lon+1)%nLon));
-
-					} else if (pr.lat == nLat - 1) {
-						for (int i = 0; i < nLon; i++) {
-							setNeighbors.insert(LatLonPair(nLat-1, i));
-						}
-						setNeighbors.insert(
-							LatLonPair(nLat-2, (pr.lon+nLon-1)%nLon));
-						setNeighbors.insert(
-							LatLonPair(nLat-2, pr.lon));
-						setNeighbors.insert(
-							LatLonPair(nLat-2, (pr.lon+1)%nLon));
-	
-					} else {
-
-						setNeighbors.insert(
-							LatLonPair(pr.lat+1, (pr.lon+nLon-1)%nLon));
-						setNeighbors.insert(
-							LatLonPair(pr.lat  , (pr.lon+nLon-1)%nLon));
-						setNeighbors.insert(
-							LatLonPair(pr.lat-1, (pr.lon+nLon-1)%nLon));
-
-						setNeighbors.insert(
-							LatLonPair(pr.lat+1, pr.lon));
-						setNeighbors.insert(
-							LatLonPair(pr.lat-1, pr.lon));
-
-						setNeighbors.insert(
-							LatLonPair(pr.lat+1, (pr.lon+1)%nLon));
-						setNeighbors.insert(
-							LatLonPair(pr.lat,   (pr.lon+1)%nLon));
-						setNeighbors.insert(
-							LatLonPair(pr.lat-1, (pr.lon+1)%nLon));
-					}
+				Announce("Blobs detected: %i", vecBlobBoxes.size());
+				Announce("Rejected (min size): %i", stats.nRejectedMinSize);
+				for (int x = 0; x < vecThresholdOp.size(); x++) {
+					Announce("Rejected (threshold %i): %i",
+						x, stats.vecRejectedThreshold[x]);
 				}
 
-				// Check patch size
-				if (vecBlobs[ixBlob].size() < nMinBlobSize) {
-					nRejectedMinSize++;
-					vecBlobs.resize(ixBlob);
-					vecBlobBoxes.resize(ixBlob);
-
-				// Check other thresholds
-				} else {
-					for (int x = 0; x < vecThresholdOp.size(); x++) {
-
-						bool fSatisfies =
-							vecThresholdOp[x].Apply(
-								dCellArea,
-								dataLatDeg,
-								dataLonDeg,
-								vecBlobs[ixBlob],
-								box);
-
-						if (!fSatisfies) {
-							nRejectedThreshold[x]++;
-							vecBlobs.resize(ixBlob);
-							vecBlobBoxes.resize(ixBlob);
-							break;
-						}
-					}
+				for (int p = 0; p < vecBlobBoxes.size(); p++) {
+					Announce("Blob %i [%i, %i] x [%i, %i]",
+						p+1,
+						vecBlobBoxes[p].lat[0],
+						vecBlobBoxes[p].lat[1],
+						vecBlobBoxes[p].lon[0],
+						vecBlobBoxes[p].lon[1]);
 				}
-			}
 
-			Announce("Blobs detected: %i", vecBlobs.size());
-			Announce("Rejected (min size): %i", nRejectedMinSize);
-			for (int x = 0; x < vecThresholdOp.size(); x++) {
-				Announce("Rejected (threshold %i): %i",
-					x, nRejectedThreshold[x]);
+				AnnounceEndBlock("Done");
 			}
-
-			for (int p = 0; p < vecBlobBoxes.size(); p++) {
-				Announce("Blob %i [%i, %i] x [%i, %i]",
-					p+1,
-					vecBlobBoxes[p].lat[0],
-					vecBlobBoxes[p].lat[1],
-					vecBlobBoxes[p].lon[0],
-					vecBlobBoxes[p].lon[1]);
-			}
-
-			AnnounceEndBlock("Done");
 		}
 
 		// Close NetCDF file
@@ -1175,6 +1432,72 @@ try {
 
 	AnnounceEndBlock("Done");
 
+#if defined(TEMPEST_MPIOMP)
+	// Gather blobs from all ranks on the root rank
+	{
+		std::vector<int> vecSendBuffer;
+		PackBlobs(
+			vecAllBlobs,
+			vecAllBlobBoxes,
+			iTimeBegin,
+			iTimeEnd,
+			vecSendBuffer);
+
+		int nSendCount = vecSendBuffer.size();
+
+		std::vector<int> vecRecvCounts;
+		std::vector<int> vecRecvDispls;
+		if (nMPIRank == 0) {
+			vecRecvCounts.resize(nMPISize);
+			vecRecvDispls.resize(nMPISize);
+		}
+
+		MPI_Gather(
+			&nSendCount, 1, MPI_INT,
+			(nMPIRank == 0)?(&(vecRecvCounts[0])):(NULL), 1, MPI_INT,
+			0, MPI_COMM_WORLD);
+
+		std::vector<int> vecRecvBuffer;
+		if (nMPIRank == 0) {
+			int nTotalCount = 0;
+			for (int r = 0; r < nMPISize; r++) {
+				vecRecvDispls[r] = nTotalCount;
+				nTotalCount += vecRecvCounts[r];
+			}
+			vecRecvBuffer.resize(nTotalCount + 1);
+		}
+
+		// Guarantee valid buffer addresses when no blobs are present
+		vecSendBuffer.push_back(0);
+
+		MPI_Gatherv(
+			&(vecSendBuffer[0]), nSendCount, MPI_INT,
+			(nMPIRank == 0)?(&(vecRecvBuffer[0])):(NULL),
+			(nMPIRank == 0)?(&(vecRecvCounts[0])):(NULL),
+			(nMPIRank == 0)?(&(vecRecvDispls[0])):(NULL),
+			MPI_INT, 0, MPI_COMM_WORLD);
+
+		if (nMPIRank == 0) {
+			for (int r = 1; r < nMPISize; r++) {
+				UnpackBlobs(
+					&(vecRecvBuffer[vecRecvDispls[r]]),
+					static_cast<int>(
+						static_cast<long>(nTime) * r / nMPISize),
+					static_cast<int>(
+						static_cast<long>(nTime) * (r + 1) / nMPISize),
+					vecAllBlobs,
+					vecAllBlobBoxes);
+			}
+		}
+	}
+
+	// Stitching and output are performed on the root rank only
+	if (nMPIRank != 0) {
+		MPI_Finalize();
+		return 0;
+	}
+#endif
+
 	///////////////////////////////////////////////////////////////////////////
 	// Stitch blobs together in time using graph search
 	///////////////////////////////////////////////////////////////////////////
@@ -1211,6 +1534,11 @@ try {
 
 	MapGraph multimapTagGraph;
 
+	// Overlaps between blobs at adjacent times (only stored if requested)
+	bool fStoreOverlaps = ((strOverlapFile != "") || (strEventFile != ""));
+
+	std::vector<BlobOverlap> vecOverlaps;
+
 	// Loop through all remaining time steps
 	for (int t = 1; t < nTime; t++) {
 
@@ -1244,14 +1572,20 @@ try {
 				}
 
 				// Verify that at least one node overlaps between blobs
+				// (accumulating the overlap area if overlaps are stored)
 				bool fHasOverlapNode = false;
+				double dOverlapArea = 0.0;
+
 				IndicatorSetConstIterator iter = vecBlobs[p].begin();
 				for (; iter != vecBlobs[p].end(); iter++) {
 					if (vecPrevBlobs[q].find(*iter) !=
 						vecPrevBlobs[q].end()
 					) {
 						fHasOverlapNode = true;
-						break;
+						if (!fStoreOverlaps) {
+							break;
+						}
+						dOverlapArea += dCellArea[iter->lat];
 					}
 				}
 
@@ -1259,6 +1593,11 @@ try {
 					continue;
 				}
 
+				if (fStoreOverlaps) {
+					vecOverlaps.push_back(
+						BlobOverlap(t, q, p, dOverlapArea));
+				}
+
 				// Insert bidirectional edge in graph
 				multimapTagGraph.insert(
 					std::pair<Tag, Tag>(
@@ -1367,6 +1706,162 @@ try {
 	}
 
 	Announce("Blobs found: %i", nTotalBlobCount);
+
+	// Output overlap areas and merge / split events
+	if (fStoreOverlaps) {
+		AnnounceStartBlock("Output overlaps and events");
+
+		// Area of each blob at each time
+		std::vector< std::vector<double> > vecAllBlobAreas;
+		vecAllBlobAreas.resize(nTime);
+
+		for (int t = 0; t < nTime; t++) {
+			vecAllBlobAreas[t].resize(vecAllBlobs[t].size(), 0.0);
+
+			for (int p = 0; p < vecAllBlobs[t].size(); p++) {
+				IndicatorSetConstIterator iter = vecAllBlobs[t][p].begin();
+				for (; iter != vecAllBlobs[t][p].end(); iter++) {
+					vecAllBlobAreas[t][p] += dCellArea[iter->lat];
+				}
+			}
+		}
+
+		// Overlap areas, with fractions relative to each blob
+		if (strOverlapFile != "") {
+			FILE * fpOverlap = fopen(strOverlapFile.c_str(), "w");
+			if (fpOverlap == NULL) {
+				_EXCEPTION1("Unable to open overlap file \"%s\"",
+					strOverlapFile.c_str());
+			}
+
+			fprintf(fpOverlap, "#time_id,time,global_id,prev_blob,blob,"
+				"overlap_area,prev_fraction,fraction\n");
+
+			for (int i = 0; i < vecOverlaps.size(); i++) {
+				const BlobOverlap & overlap = vecOverlaps[i];
+
+				int iGlobalId =
+					vecAllBlobTags[overlap.time][overlap.ixCurr].global_id;
+
+				if (iGlobalId == 0) {
+					continue;
+				}
+
+				fprintf(fpOverlap, "%i,\t%f,\t%i,\t%i,\t%i,\t%e,\t%f,\t%f\n",
+					overlap.time,
+					dTime[overlap.time],
+					iGlobalId,
+					overlap.ixPrev+1,
+					overlap.ixCurr+1,
+					overlap.dArea,
+					overlap.dArea
+						/ vecAllBlobAreas[overlap.time-1][overlap.ixPrev],
+					overlap.dArea
+						/ vecAllBlobAreas[overlap.time][overlap.ixCurr]);
+			}
+
+			fclose(fpOverlap);
+		}
+
+		// Merge events (one blob overlapping several previous blobs) and
+		// split events (one previous blob overlapping several blobs)
+		if (strEventFile != "") {
+			FILE * fpEvent = fopen(strEventFile.c_str(), "w");
+			if (fpEvent == NULL) {
+				_EXCEPTION1("Unable to open event file \"%s\"",
+					strEventFile.c_str());
+			}
+
+			fprintf(fpEvent, "#time_id,time,global_id,event,blob,count,"
+				"partner_blobs\n");
+
+			std::map< std::pair<int,int>, std::vector<int> > mapMerges;
+			std::map< std::pair<int,int>, std::vector<int> > mapSplits;
+
+			for (int i = 0; i < vecOverlaps.size(); i++) {
+				const BlobOverlap & overlap = vecOverlaps[i];
+
+				mapMerges[std::pair<int,int>(overlap.time, overlap.ixCurr)]
+					.push_back(overlap.ixPrev);
+				mapSplits[std::pair<int,int>(overlap.time, overlap.ixPrev)]
+					.push_back(overlap.ixCurr);
+			}
+
+			int nMerges = 0;
+			int nSplits = 0;
+
+			for (int t = 1; t < nTime; t++) {
+
+				// Splits are reported at the time the pieces first appear
+				std::map< std::pair<int,int>, std::vector<int> >::const_iterator
+					iterSplit = mapSplits.lower_bound(
+						std::pair<int,int>(t, 0));
+
+				for (; iterSplit != mapSplits.end(); iterSplit++) {
+					if (iterSplit->first.first != t) {
+						break;
+					}
+					if (iterSplit->second.size() < 2) {
+						continue;
+					}
+
+					int ixPrev = iterSplit->first.second;
+					int iGlobalId = vecAllBlobTags[t-1][ixPrev].global_id;
+					if (iGlobalId == 0) {
+						continue;
+					}
+
+					fprintf(fpEvent, "%i,\t%f,\t%i,\tsplit,\t%i,\t%i,\t",
+						t, dTime[t], iGlobalId, ixPrev+1,
+						static_cast<int>(iterSplit->second.size()));
+
+					for (int j = 0; j < iterSplit->second.size(); j++) {
+						fprintf(fpEvent, "%i%s",
+							iterSplit->second[j]+1,
+							(j == iterSplit->second.size()-1)?("\n"):(" "));
+					}
+					nSplits++;
+				}
+
+				std::map< std::pair<int,int>, std::vector<int> >::const_iterator
+					iterMerge = mapMerges.lower_bound(
+						std::pair<int,int>(t, 0));
+
+				for (; iterMerge != mapMerges.end(); iterMerge++) {
+					if (iterMerge->first.first != t) {
+						break;
+					}
+					if (iterMerge->second.size() < 2) {
+						continue;
+					}
+
+					int ixCurr = iterMerge->first.second;
+					int iGlobalId = vecAllBlobTags[t][ixCurr].global_id;
+					if (iGlobalId == 0) {
+						continue;
+					}
+
+					fprintf(fpEvent, "%i,\t%f,\t%i,\tmerge,\t%i,\t%i,\t",
+						t, dTime[t], iGlobalId, ixCurr+1,
+						static_cast<int>(iterMerge->second.size()));
+
+					for (int j = 0; j < iterMerge->second.size(); j++) {
+						fprintf(fpEvent, "%i%s",
+							iterMerge->second[j]+1,
+							(j == iterMerge->second.size()-1)?("\n"):(" "));
+					}
+					nMerges++;
+				}
+			}
+
+			fclose(fpEvent);
+
+			Announce("Merge events: %i", nMerges);
+			Announce("Split events: %i", nSplits);
+		}
+
+		AnnounceEndBlock("Done");
+	}
 /*
 	// Apply threshold operators
 	std::vector<bool> fRejectedBlob;
@@ -1469,8 +1964,15 @@ try {
 	// Output
 	AnnounceStartBlock("Output Blobs");
 
-	// Load the netcdf output file
-	NcFile ncOutput(strOutputFile.c_str(), NcFile::Replace);
+	// Load the netcdf output file (NetCDF-4 if compression or chunking
+	// is requested)
+	NcFile::FileFormat eOutputFormat = NcFile::Classic;
+	if ((iDeflateLevel != 0) || (nChunkTimes != 0)) {
+		eOutputFormat = NcFile::Netcdf4Classic;
+	}
+
+	NcFile ncOutput(
+		strOutputFile.c_str(), NcFile::Replace, NULL, 0, eOutputFormat);
 	if (!ncOutput.is_valid()) {
 		_EXCEPTION1("Unable to open output file \"%s\"",
 			strOutputFile.c_str());
@@ -1538,6 +2040,28 @@ try {
 			dimOutputLat,
 			dimOutputLon);
 
+	if (varData == NULL) {
+		_EXCEPTION1("Unable to create variable \"%s\" in output",
+			strOutputVariable.c_str());
+	}
+
+	// Chunk by time level and compress the (mostly zero) tag field
+	// (one time level per chunk unless otherwise specified)
+	if ((iDeflateLevel != 0) || (nChunkTimes != 0)) {
+		int nChunkSizeTime = std::min(nChunkTimes, nTime);
+		if (nChunkSizeTime < 1) {
+			nChunkSizeTime = 1;
+		}
+
+		std::vector<size_t> vecChunkSizes;
+		vecChunkSizes.push_back(nChunkSizeTime);
+		vecChunkSizes.push_back(nLat);
+		vecChunkSizes.push_back(nLon);
+
+		SetNcVarCompression(
+			ncOutput, varData, iDeflateLevel, !fNoShuffle, vecChunkSizes);
+	}
+
 	// Loop through all time steps
 	DataMatrix<int> dataBlobTag;
 	dataBlobTag.Initialize(nLat, nLon);
@@ -1576,13 +2100,87 @@ try {
 
 	ncOutput.close();
 
+	// Sparse output as runs of adjacent longitudes for each blob
+	if (strSparseFile != "") {
+		FILE * fpSparse = fopen(strSparseFile.c_str(), "w");
+		if (fpSparse == NULL) {
+			_EXCEPTION1("Unable to open sparse output file \"%s\"",
+				strSparseFile.c_str());
+		}
+
+		// Local blobs associated with each global id
+		std::map<int, std::vector< std::pair<int,int> > > mapGlobalBlobs;
+
+		for (int t = 0; t < nTime; t++) {
+			const std::vector<Tag> & vecBlobTags = vecAllBlobTags[t];
+
+			for (int p = 0; p < vecBlobTags.size(); p++) {
+				if (vecBlobTags[p].global_id == 0) {
+					continue;
+				}
+				mapGlobalBlobs[vecBlobTags[p].global_id].push_back(
+					std::pair<int,int>(t, p));
+			}
+		}
+
+		fprintf(fpSparse, "#global_id,time_id,lat_id,lon_id,lon_count\n");
+
+		std::map<int, std::vector< std::pair<int,int> > >::const_iterator
+			iterGlobalBlob = mapGlobalBlobs.begin();
+
+		for (; iterGlobalBlob != mapGlobalBlobs.end(); iterGlobalBlob++) {
+			for (int i = 0; i < iterGlobalBlob->second.size(); i++) {
+				int t = iterGlobalBlob->second[i].first;
+				int p = iterGlobalBlob->second[i].second;
+
+				// Points are ordered by latitude then longitude
+				const IndicatorSet & setBlob = vecAllBlobs[t][p];
+
+				IndicatorSetConstIterator iter = setBlob.begin();
+				while (iter != setBlob.end()) {
+					int iLat = iter->lat;
+					int iLonStart = iter->lon;
+					int nLonCount = 1;
+
+					for (iter++; iter != setBlob.end(); iter++) {
+						if ((iter->lat != iLat) ||
+						    (iter->lon != iLonStart + nLonCount)
+						) {
+							break;
+						}
+						nLonCount++;
+					}
+
+					fprintf(fpSparse, "%i,\t%i,\t%i,\t%i,\t%i\n",
+						iterGlobalBlob->first, t, iLat, iLonStart, nLonCount);
+				}
+			}
+		}
+
+		fclose(fpSparse);
+	}
+
 	AnnounceEndBlock("Done");
 
 	AnnounceBanner();
 
 } catch(Exception & e) {
 	Announce(e.ToString().c_str());
+
+#if defined(TEMPEST_MPIOMP)
+	// Other ranks may be waiting in a gather and would never return
+	int nMPISize = 1;
+	MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
+	if (nMPISize > 1) {
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+#endif
 }
+
+#if defined(TEMPEST_MPIOMP)
+	// Deinitialize MPI
+	MPI_Finalize();
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////////
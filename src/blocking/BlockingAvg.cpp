@@ -7,10 +7,14 @@
 /*This code fills an array with 31 days (31*nsteps) of PV
 data and adds the sum of this array to the index of a 365-day
 array that corresponds to the center date of the 31-day array.
+The 31-day array is a ring buffer with a running sum, so each
+new day only adds the newest steps and subtracts the oldest.
 The value for each day is then divided by the number of years *31*
 nsteps to get the daily average for the (n)-year period. 
 */
 #include "BlockingUtilities.h"
+#include "SlidingWindow.h"
+#include "ClimAccumulator.h"
 #include "CommandLine.h"
 #include "Exception.h"
 #include "Announce.h"
@@ -38,6 +42,7 @@ int main(int argc, char **argv){
     std::string varName;
     std::string avgName;
     std::string tname,latname,lonname;
+    std::string stateFile, mergeList;
     bool missingFiles;
 
     BeginCommandLine()
@@ -49,6 +54,8 @@ int main(int argc, char **argv){
       CommandLineString(tname,"tname","time");
       CommandLineString(latname,"latname","lat");
       CommandLineString(lonname,"lonname","lon");
+      CommandLineString(stateFile,"state","");
+      CommandLineString(mergeList,"mergestates","");
       ParseCommandLine(argc, argv);
 
 
@@ -109,6 +116,9 @@ int main(int argc, char **argv){
       strCalendar = "standard";
     }
 
+    //Time units and calendar of the first file, parsed once
+    TimeDecoder timeDecoder(strTimeUnits, strCalendar);
+
     //Resolution of the time axis
     double tRes;
     if ((strTimeUnits.length() >= 11) && \
@@ -130,18 +140,38 @@ int main(int argc, char **argv){
     int dateMonth=0;
     int dateDay=0;
     int dateHour=0;
-    ParseTimeDouble(strTimeUnits, strCalendar, timeVec[0], dateYear,\
-      dateMonth, dateDay, dateHour);
+    timeDecoder.Decode(timeVec[0], dateYear, dateMonth, dateDay, dateHour);
 
     int day = DayInYear(dateMonth,dateDay);
     int dateIndex = day + 15;
 
-    bool leap = checkFileLeap(strTimeUnits, strCalendar, dateYear, \
-      dateMonth, dateDay, dateHour, timeVec[nTime-1]);
+    bool leap = checkFileLeap(timeDecoder, dateMonth, timeVec[nTime-1]);
 
     //3D matrix to store averaged values
-    DataMatrix3D<double> avgStoreVals(yearLen,nLat,nLon);
-    DataMatrix3D<double> avgCounts(yearLen,nLat,nLon);
+    //The 31-day window spans file boundaries, so a run cannot skip
+    //files: the state file and partial states are added to the sums
+    //of this run, which must cover a new (continuous) set of files.
+    ClimatologyAccumulator accum;
+    accum.Initialize("BlockingAvg:" + varName, yearLen, nLat, nLon);
+    if (stateFile != ""){
+      if (accum.ReadIfExists(stateFile)){
+        std::cout<<"Adding to "<<stateFile<<" ("<<accum.GetFileCount()\
+          <<" files)"<<std::endl;
+      }
+    }
+    if (mergeList != ""){
+      std::vector<std::string> vecStateFiles;
+      GetInputFileList(mergeList,vecStateFiles);
+      accum.MergeFileList(vecStateFiles);
+    }
+    for (int f=0; f<nFiles; f++){
+      if (accum.HasFile(InputFiles[f])){
+        _EXCEPTION1("File %s has already been accumulated",\
+          InputFiles[f].c_str());
+      }
+    }
+    DataMatrix3D<double> & avgStoreVals = accum.GetSum();
+    DataMatrix3D<double> & avgCounts = accum.GetCounts();
 
     //Number of time steps per day
     int nSteps = 1/tRes;
@@ -149,8 +179,14 @@ int main(int argc, char **argv){
     double endTime = timeVec[nTime-1];
     int currArrIndex = 0;
 
-    //3D 31-day array
-    DataMatrix3D<double> currFillData(arrLen,nLat,nLon);
+    //Values in case of missing files
+    double contCheck = 0.;
+    double missingValue=-999999.9;
+    bool hasMissingValues = false;
+
+    //31-day array with running sum
+    SlidingWindowSum currFillData;
+    currFillData.Initialize(arrLen,nLat,nLon,missingValue);
 
     //File counter
     int x=0;
@@ -170,35 +206,23 @@ int main(int argc, char **argv){
     int leapHour=0;
 
 
-    //Values in case of missing files
-    double contCheck = 0.;
-    double missingValue=-999999.9;
-    bool hasMissingValues = false;
-    
-
     //First while loop: open files and fill until 31 days array full
     while (currArrIndex<arrLen){
       //First file
       for (int t=tStart; t<tEnd; t++){
         if (leap==true){
         //Check if time is a leap year date
-          ParseTimeDouble(strTimeUnits, strCalendar, timeVec[t], leapYear,\
-            leapMonth,leapDay,leapHour);
+          timeDecoder.Decode(timeVec[t], leapYear, leapMonth, leapDay, leapHour);
           if (leapMonth==2 && leapDay == 29){
             while (leapMonth ==2 && leapDay ==29){
             //  std::cout<<"Leap day! Skipping this step."<<std::endl;
               t++;
-              ParseTimeDouble(strTimeUnits, strCalendar, timeVec[t], leapYear,\
-                leapMonth, leapDay, leapHour);
+              timeDecoder.Decode(timeVec[t], leapYear, leapMonth, leapDay, leapHour);
             }
           }
         }
         //Fill the 31 day array with PV data
-        for (int a=0; a<nLat; a++){
-          for (int b=0; b<nLon; b++){
-            currFillData[currArrIndex][a][b] = IPVData[t][a][b];
-          }
-        }
+        currFillData.SetSlot(currArrIndex, IPVData.GetRow(t,0));
         currArrIndex++;
        // std::cout<<"current array index is "<<currArrIndex<<std::endl;
       }
@@ -244,15 +268,13 @@ int main(int argc, char **argv){
           //Fill in the days that are missing with the missingvalue 
           //contCheck units are in days, tRes is a fraction of a day
           //So the number of indices to be filled in is contCheck/tRes     
-            MissingFill(missingValue,tRes,contCheck,nLat,nLon,arrLen,\
-              currArrIndex,dateIndex,currFillData); 
+            MissingFill(tRes,contCheck,currArrIndex,dateIndex,currFillData);
           }
           
         }
 
         //reset leap year check
-        leap = checkFileLeap(strTimeUnits, strCalendar, dateYear, \
-          dateMonth, dateDay, dateHour,timeVec[nTime-1]);
+        leap = checkFileLeap(timeDecoder, dateMonth, timeVec[nTime-1]);
 
         //reset ending time of current file for next continuity check
         endTime = timeVec[nTime-1];
@@ -271,7 +293,7 @@ int main(int argc, char **argv){
     //Fill yearly array with sum of 31 days
     //Check if the array contains missing values
     if (missingFiles){
-      hasMissingValues = missingValCheck(currFillData,arrLen,missingValue);
+      hasMissingValues = (currFillData.GetMissingCount() > 0);
     }    
 
     if (hasMissingValues){
@@ -279,13 +301,7 @@ int main(int argc, char **argv){
     }
     else{
       //std::cout<<"No missing values found. Adding array to sum."<<std::endl;
-      for (int t=0; t<arrLen; t++){
-        for (int a=0; a<nLat; a++){
-          for (int b=0; b<nLon; b++){
-            avgStoreVals[dateIndex][a][b] += currFillData[t][a][b];
-          }
-        }
-      }
+      currFillData.AddSumTo(avgStoreVals.GetRow(dateIndex,0));
    //increase count by 1
       for (int a=0; a<nLat; a++){
         for (int b=0; b<nLon; b++){
@@ -323,8 +339,7 @@ int main(int argc, char **argv){
       timeVal->set_cur((long) 0);
       timeVal->get(&(timeVec[0]),nTime);
 
-      leap = checkFileLeap(strTimeUnits, strCalendar, dateYear, \
-        dateMonth, dateDay, dateHour, timeVec[nTime-1]);
+      leap = checkFileLeap(timeDecoder, dateMonth, timeVec[nTime-1]);
    
       tStart = 0;
       tEnd = tStart + nSteps;
@@ -347,8 +362,7 @@ int main(int argc, char **argv){
        //1: check if current day is a leap day
       if (leap==true){
       //  std::cout<<"Checking date for leap day."<<std::endl;
-        ParseTimeDouble(strTimeUnits, strCalendar, timeVec[tStart], leapYear,\
-          leapMonth, leapDay, leapHour);
+        timeDecoder.Decode(timeVec[tStart], leapYear, leapMonth, leapDay, leapHour);
         if (leapMonth==2 && leapDay ==29){
           tStart = tEnd;
           tEnd = tStart + nSteps;
@@ -395,8 +409,7 @@ int main(int argc, char **argv){
           timeVal->set_cur((long) 0);
           timeVal->get(&(timeVec[0]),nTime);
 
-          ParseTimeDouble(strTimeUnits, strCalendar, timeVec[0],dateYear,\
-            dateMonth,dateDay,dateHour);
+          timeDecoder.Decode(timeVec[0], dateYear, dateMonth, dateDay, dateHour);
 
          //Check file continuity
           contCheck = tBetweenFiles(strTimeUnits, timeVec[0],endTime);
@@ -406,13 +419,15 @@ int main(int argc, char **argv){
             //  std::cout<<"contCheck is "<<contCheck<<std::endl;
               _EXCEPTIONT("New file is not continuous with previous file");
             }else{
-              MissingFill(missingValue, tRes, contCheck, nLat, nLon, arrLen, \
-                currArrIndex,dateIndex, currFillData);
+              MissingFill(tRes, contCheck, currArrIndex, dateIndex, currFillData);
             }
           }           
 
-          leap = checkFileLeap(strTimeUnits, strCalendar, dateYear,\
-            dateMonth, dateDay, dateHour, timeVec[nTime-1]);
+          leap = checkFileLeap(timeDecoder, dateMonth, timeVec[nTime-1]);
+
+          //Re-sum the window at each file boundary so that rounding
+          //error in the running sum does not build up over many years
+          currFillData.Resum();
 
           tStart = 0;
           tEnd = tStart + nSteps;
@@ -427,18 +442,17 @@ int main(int argc, char **argv){
       //  }
  
         for (int t=tStart; t<tEnd; t++){
-          for (int a=0; a<nLat; a++){
-            for (int b=0; b<nLon; b++){
-              if (nTime-tStart < nSteps){
-                currFillData[currArrIndex][a][b] = missingValue;
-              }
-              else{
-                if (std::fabs(IPVData[t][a][b]) > 10e10){
-                  std::cout<<"WARNING: File "<<InputFiles[x]<<" has suspicious value! "<<IPVData[t][a][b]<<std::endl;
-                }
-                currFillData[currArrIndex][a][b] = IPVData[t][a][b];
+          if (nTime-tStart < nSteps){
+            currFillData.SetSlotMissing(currArrIndex);
+          }
+          else{
+            const double * IPVRow = IPVData.GetRow(t,0);
+            for (int i=0; i<nLat*nLon; i++){
+              if (std::fabs(IPVRow[i]) > 10e10){
+                std::cout<<"WARNING: File "<<InputFiles[x]<<" has suspicious value! "<<IPVRow[i]<<std::endl;
               }
             }
+            currFillData.SetSlot(currArrIndex, IPVRow);
           }
           currArrIndex+=1;
         //  std::cout<< "Array index is now "<<currArrIndex<<" (arrlen is "<<arrLen<<")"<<std::endl;
@@ -450,21 +464,15 @@ int main(int argc, char **argv){
         }
      //Check to see if array contains missing values
      if (missingFiles){
-       hasMissingValues = missingValCheck(currFillData,arrLen,missingValue);
+       hasMissingValues = (currFillData.GetMissingCount() > 0);
      }
      //Do not add sum of array to average if array contains missing values!
      if (hasMissingValues){
        //std::cout<<"This array has missing values, will not be added to sum."<<std::endl;
      }else{
        //std::cout<<"Filled in values at date index "<<dateIndex<<std::endl;
-       //Fill date with sum of new array values
-          for (int t=0; t<arrLen; t++){
-            for (int a=0; a<nLat; a++){
-              for (int b=0; b<nLon; b++){
-                avgStoreVals[dateIndex][a][b] += currFillData[t][a][b];
-              }
-            }
-          }
+       //Fill date with running sum of array values
+          currFillData.AddSumTo(avgStoreVals.GetRow(dateIndex,0));
         //increase count
           for (int a=0; a<nLat; a++){
             for (int b=0; b<nLon; b++){
@@ -491,8 +499,7 @@ int main(int argc, char **argv){
           //Check for leap year
           if (leap==true){
           //  std::cout<<"Checking date for leap day."<<std::endl;
-            ParseTimeDouble(strTimeUnits, strCalendar, timeVec[tStart], leapYear,\
-              leapMonth, leapDay, leapHour);
+            timeDecoder.Decode(timeVec[tStart], leapYear, leapMonth, leapDay, leapHour);
             if (leapMonth==2 && leapDay ==29){
               tStart = tEnd;
               tEnd = tStart + nSteps;
@@ -513,6 +520,14 @@ int main(int argc, char **argv){
       }
     }
     
+    //Save the accumulated sums before averaging
+    if (stateFile != ""){
+      for (int f=0; f<nFiles; f++){
+        accum.AddFile(InputFiles[f]);
+      }
+      accum.Write(stateFile);
+    }
+
     //average all values
     for (int t=0; t<yearLen; t++){
       for (int a=0; a<nLat; a++){
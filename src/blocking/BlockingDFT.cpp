@@ -16,17 +16,27 @@
 #include "BlockingUtilities.h"
 #include "NetCDFUtilities.h"
 #include "DFT.h"
+#include "ClimAccumulator.h"
 
 #include <cstdlib>
 #include <cmath>
 #include <complex>
 #include <cstring>
 
+#if defined(TEMPEST_MPIOMP)
+#include <mpi.h>
+#endif
+
 int main(int argc, char ** argv){
+#if defined(TEMPEST_MPIOMP)
+  //Initialize MPI
+  MPI_Init(&argc, &argv);
+#endif
   try{
     NcError error(NcError::silent_nonfatal);
     std::string fileList, outFile,avgName,varName,  tname, latname, lonname;
-    int nWaves,startday,endday;
+    std::string stateFile, mergeList;
+    int nWaves,startday,endday,nCheckpoint;
     BeginCommandLine()
       CommandLineString(fileList,"inlist","");
       CommandLineString(outFile,"out","");
@@ -38,6 +48,9 @@ int main(int argc, char ** argv){
       CommandLineString(tname,"tname","time");
       CommandLineString(latname,"latname","lat");
       CommandLineString(lonname,"lonname","lon");
+      CommandLineString(stateFile,"state","");
+      CommandLineString(mergeList,"mergestates","");
+      CommandLineInt(nCheckpoint,"checkpoint",1);
       ParseCommandLine(argc,argv);
     EndCommandLine(argv)
     AnnounceBanner();
@@ -64,86 +77,98 @@ int main(int argc, char ** argv){
       _EXCEPTION1("Unable to open file %s for reading",vecFiles[0].c_str());
     }
     //axis lengths
-    int tLen,latLen,lonLen;
-    tLen = readin.get_dim(tname.c_str())->size();
+    int latLen,lonLen;
     latLen = readin.get_dim(latname.c_str())->size();
     lonLen = readin.get_dim(lonname.c_str())->size();
 
-    //Initialize storage array: day, lat, lon
+    //Initialize storage and counts arrays: day, lat, lon
+    //Resume from the state file and merge any partial states
     int yearLen = (endday-startday)+1;
-    DataMatrix3D<double> storeMat(yearLen,latLen,lonLen);
-    //Initialize counts array: day, lat, lon
-    DataMatrix3D<double> countsMat(yearLen, latLen, lonLen);
-    //Initialize input datan array: lat, lon
-    DataMatrix<double> inputData(latLen,lonLen);
-    DataVector<double> timeVec(tLen);
-
+    ClimatologyAccumulator accum;
+    accum.Initialize("BlockingDFT:" + varName, yearLen, latLen, lonLen);
+    if (stateFile != ""){
+      if (accum.ReadIfExists(stateFile)){
+        std::cout<<"Resuming from "<<stateFile<<" ("<<accum.GetFileCount()\
+          <<" files)"<<std::endl;
+      }
+    }
+    if (mergeList != ""){
+      std::vector<std::string> vecStateFiles;
+      GetInputFileList(mergeList,vecStateFiles);
+      accum.MergeFileList(vecStateFiles);
+    }
     //Close file (then re-open in loop)
     readin.close();
 
-    //Loop through all available files and store values in appropriate day
+    int nMPIRank = 0;
+    int nMPISize = 1;
+#if defined(TEMPEST_MPIOMP)
+    MPI_Comm_rank(MPI_COMM_WORLD, &nMPIRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
+#endif
+
+    //Files that still need to be added
+    std::vector<std::string> vecPending;
     for (int x=0; x<nFiles; x++){
-      NcFile readin(vecFiles[x].c_str());
+      if (accum.HasFile(vecFiles[x])){
+        if (nMPIRank == 0){
+          std::cout<<"Already accumulated "<<vecFiles[x].c_str()<<std::endl;
+        }
+      }else{
+        vecPending.push_back(vecFiles[x]);
+      }
+    }
+
+    //Spread the files across ranks; only rank 0 keeps the resumed
+    //and merged sums so that they are counted once in the reduction
+    if (nMPIRank != 0){
+      accum.ClearSums();
+    }
+
+    //Loop through all available files and store values in appropriate day
+    int nAdded = 0;
+    for (int x=nMPIRank; x<vecPending.size(); x+=nMPISize){
+      NcFile readin(vecPending[x].c_str());
       if (!readin.is_valid()){
-        _EXCEPTION1("Unable to open file %s for reading",vecFiles[x].c_str());
+        _EXCEPTION1("Unable to open file %s for reading",vecPending[x].c_str());
       }
-      std::cout<<"Reading in "<<vecFiles[x].c_str()<<std::endl;
-      tLen = readin.get_dim(tname.c_str()) ->size();
-      //std::cout<<"Reading in file #"<<x<<", "<<vecFiles[x].c_str()<<std::endl;
+      std::cout<<"Reading in "<<vecPending[x].c_str()<<std::endl;
       NcVar *inputVar = readin.get_var(varName.c_str());
-      timeVec.Initialize(tLen);
       NcVar *timeVar = readin.get_var(tname.c_str());
-      timeVar->set_cur((long)0);
-      timeVar->get(&(timeVec[0]),tLen);
-
-      NcAtt *attTime = timeVar->get_att("units");
-      if (attTime==NULL){
-        _EXCEPTIONT("Time variable has no units attribute.");
-      }
-      std::string strTimeUnits = attTime->as_string(0);
-      std::string strCalendar;
-      NcAtt *attCal = timeVar->get_att("calendar");
-      if (attCal==NULL){
-        strCalendar = "standard";
-      }else{
-        strCalendar = attCal->as_string(0);
-      }
-      if (strncmp(strCalendar.c_str(),"gregorian",9)==0){
-        strCalendar = "standard";
-      }
-      //Time and calendar
-      int dateYear, dateMonth, dateDay, dateHour, dayIndex;
-      bool leap;
-      //std::cout<<"Storing values."<<std::endl;
       //Store the values and counts in the matrices at the appropriate day index
+      accum.AddVariable(inputVar, timeVar, NULL);
+      readin.close();
 
-      //Input data
-      for (int t=0; t<tLen; t++){
-        inputData.Initialize(latLen, lonLen);
-        inputVar->set_cur(t,0,0);
-        inputVar->get(&(inputData[0][0]),1,latLen,lonLen);
-        ParseTimeDouble(strTimeUnits, strCalendar, timeVec[t],\
-          dateYear, dateMonth, dateDay, dateHour);
-        leap = checkFileLeap(strTimeUnits, strCalendar, dateYear,\
-          dateMonth, dateDay, dateHour, timeVec[t]);
-        if (leap == false){
-          dayIndex = DayInYear(dateMonth, dateDay)-1;
-          //std::cout<<"Day index is "<<dayIndex<<std::endl;
-          for (int a=0; a<latLen; a++){
-            for (int b=0; b<lonLen; b++){
-              storeMat[dayIndex][a][b]+= inputData[a][b];
-              countsMat[dayIndex][a][b]+= 1.;
-             // if (a==50 && b==20){
-             //   std::cout<<"Store: "<<storeMat[dayIndex][a][b]<< " count: "<< countsMat[dayIndex][a][b]<<std::endl;
-            //  }
-            }
-          }
+      //Checkpoint the accumulated state (serial runs only; partial
+      //sums on one rank are not a valid state)
+      if (nMPISize == 1){
+        accum.AddFile(vecPending[x]);
+        nAdded++;
+        if (stateFile != "" && nCheckpoint > 0 && nAdded % nCheckpoint == 0){
+          accum.Write(stateFile);
         }
       }
-      std::cout<<"Closing file."<<std::endl;
-      readin.close();
+    }
 
+    //Combine the sums of all ranks
+    if (nMPISize > 1){
+      accum.Allreduce();
+      for (int x=0; x<vecPending.size(); x++){
+        accum.AddFile(vecPending[x]);
+      }
+    }
+    if (stateFile != "" && nMPIRank == 0){
+      accum.Write(stateFile);
     }
+#if defined(TEMPEST_MPIOMP)
+    //Smoothing and output are done on rank 0
+    if (nMPIRank != 0){
+      MPI_Finalize();
+      return 0;
+    }
+#endif
+    DataMatrix3D<double> & storeMat = accum.GetSum();
+    DataMatrix3D<double> & countsMat = accum.GetCounts();
     //Now average the values by the counts to get the daily average
     for (int d=0; d<yearLen; d++){
       for (int a=0; a<latLen; a++){
@@ -159,22 +184,14 @@ int main(int argc, char ** argv){
     //std::cout<<"Divided values to get average."<<std::endl;
 
     //Output the Fourier transform of the dataset
-    std::vector<double> inputDaily(yearLen);
-    std::vector<std::complex <double> > FourierCoefs(yearLen);
-    std::vector<double> outputDaily(yearLen);
+    //(low-order harmonics only, batched over each latitude row)
+    HarmonicFilter harmFilter(yearLen, nWaves);
     DataMatrix3D<double> outputMat(yearLen, latLen, lonLen);
+    int nPlane = latLen*lonLen;
+#pragma omp parallel for schedule(dynamic)
     for (int a=0; a<latLen; a++){
-      for (int b=0; b<lonLen; b++){
-        for (int d=0; d<yearLen; d++){
-          inputDaily[d] = storeMat[d][a][b];
-          //std::cout<<"daily input for d="<<d<<" is "<<inputDaily[d]<<std::endl;
-        }
-        FourierCoefs = DFT(inputDaily, nWaves);
-        outputDaily = IDFT(FourierCoefs);
-        for (int d=0; d<yearLen; d++){
-          outputMat[d][a][b] = outputDaily[d];
-        }
-      }
+      harmFilter.ApplyBatch(storeMat.GetRow(0,a), lonLen, 1, nPlane,\
+        outputMat.GetRow(0,a), 1, nPlane);
     }
 
 
@@ -246,5 +263,18 @@ int main(int argc, char ** argv){
   }
   catch (Exception &e){
     std::cout<<e.ToString()<<std::endl;
+#if defined(TEMPEST_MPIOMP)
+    //Other ranks may be waiting in the reduction of the sums and
+    //would never return
+    int nMPISize = 1;
+    MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
+    if (nMPISize > 1){
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+#endif
   }
+#if defined(TEMPEST_MPIOMP)
+  //Deinitialize MPI
+  MPI_Finalize();
+#endif
 }
@@ -192,6 +192,7 @@ int main(int argc, char **argv){
       }else{
         strCalendar = attCal->as_string(0);
       }
+      TimeDecoder timeDecoder(strTimeUnits, strCalendar);
   //    std::cout<<"Time units: "<< strTimeUnits<<" Calendar: "<<strCalendar<<std::endl;
 
 
@@ -204,8 +205,7 @@ int main(int argc, char **argv){
       int dateMonth;
       int dateDay;
       int dateHour;
-      ParseTimeDouble(strTimeUnits, strCalendar, timeVals[0], dateYear,\
-        dateMonth, dateDay, dateHour);
+      timeDecoder.Decode(timeVals[0], dateYear, dateMonth, dateDay, dateHour);
       int day = DayInYear(dateMonth,dateDay);
       std::cout<<"For month "<<dateMonth<<" and day "<<dateDay<<" day is "<<day<<std::endl;
       int startIndex = day-1;
@@ -242,8 +242,7 @@ int main(int argc, char **argv){
       //How many leap day times step are there?
       if (strCalendar!="noleap"){
         for (int t=0; t<nTime; t++){
-          ParseTimeDouble(strTimeUnits, strCalendar, timeVals[t], leapYear,\
-            leapMonth, leapDay, leapHour);
+          timeDecoder.Decode(timeVals[t], leapYear, leapMonth, leapDay, leapHour);
           if ((leapMonth==2 && leapDay == 29)){
     //        leap = true;
             nLeapSteps +=1;
@@ -257,14 +256,12 @@ int main(int argc, char **argv){
       
       //Number of time steps per day?
       int nSteps = 1;
-      ParseTimeDouble(strTimeUnits, strCalendar, timeVals[0], leapYear,\
-         leapMonth, leapDay, leapHour);
+      timeDecoder.Decode(timeVals[0], leapYear, leapMonth, leapDay, leapHour);
       int d1 = DayInYear(leapMonth,leapDay);
 
       int d2;
       for (int t=1; t<nTime; t++){
-        ParseTimeDouble(strTimeUnits, strCalendar, timeVals[t], leapYear,\
-            leapMonth, leapDay, leapHour);
+        timeDecoder.Decode(timeVals[t], leapYear, leapMonth, leapDay, leapHour);
         d2 = DayInYear(leapMonth,leapDay);
         if (d1 != d2){
           break;
@@ -265,51 +265,49 @@ int main(int argc, char **argv){
         _EXCEPTION1("Could not find variable %s",vName.c_str());
       }
 
-    //Add the PV variable to the file
+    //Add the PV and IPV variables to the file
       pv_var = file_out.add_var("PV", ncDouble, out_time, out_plev, out_lat, out_lon);
-    
-
+      NcVar *intpv_var = file_out.add_var("IPV", ncDouble, out_time, out_lat, out_lon);
 
-      DataMatrix3D<double> PTVar(lev_len,lat_len,lon_len);
       DataMatrix3D<double> TVar(lev_len,lat_len,lon_len);
-      DataMatrix3D<double>RVVar(lev_len,lat_len,lon_len);
       DataMatrix3D<double>UMat(lev_len,lat_len,lon_len);
       DataMatrix3D<double>VMat(lev_len,lat_len,lon_len);
-   //CALCULATE PV AND IPV PER TIME STEP
+   //CALCULATE PV AND IPV PER TIME STEP (PT and relative vorticity
+   //are formed on the fly, one lat band at a time)
       for (int t=0; t<time_len; t++){
-      //Calculate PT
         temp->set_cur(t,0,0,0);
         temp->get(&(TVar[0][0][0]),1,lev_len,lat_len,lon_len);
-        PT_calc(lev_len,lat_len,lon_len,TVar, lev_vals, PTVar);
-
-      //Calculate relative vorticity 
 
         uvar->set_cur(t,0,0,0);
         uvar->get(&(UMat[0][0][0]),1,lev_len,lat_len,lon_len);
 
         vvar->set_cur(t,0,0,0);
         vvar->get(&(VMat[0][0][0]),1,lev_len,lat_len,lon_len);
-        rVort_calc(lev_len,lat_len,lon_len,UMat,VMat, dphi, dlambda, cosphi, RVVar);
 
-        PV_calc(lev_len,lat_len,lon_len, UMat, VMat, PTVar, RVVar, pVec, coriolis,cosphi, dphi, dlambda,\
-          lat_res, lon_res, PVMat);
+        PV_IPV_calc(lev_len,lat_len,lon_len,TVar,UMat,VMat,pVec,coriolis,cosphi,\
+          dphi,dlambda,lat_res,PVMat,IPVMat);
 
         pv_var->set_cur(t,0,0,0);
         pv_var->put(&(PVMat[0][0][0]),1,lev_len,lat_len,lon_len);
+
+        intpv_var->set_cur(t,0,0);
+        intpv_var->put(&(IPVMat[0][0]),1,lat_len,lon_len);
       }
     }
     if (has_PV){
       pv_var = readin.get_var(PVname.c_str());
-    }
-    
-    NcVar *intpv_var = file_out.add_var("IPV", ncDouble, out_time, out_lat, out_lon);
-    for (int t=0; t<time_len; t++){
-      pv_var->set_cur(t,0,0,0);
-      pv_var->get(&(PVMat[0][0][0]),1,lev_len,lat_len,lon_len);
-      IPV_calc(lev_len,lat_len,lon_len,lat_res,pVec,PVMat,IPVMat);
-      intpv_var->set_cur(t,0,0);
-      intpv_var->put(&(IPVMat[0][0]),1,lat_len,lon_len);
+      if (pv_var == NULL){
+        _EXCEPTION1("Could not find variable %s",PVname.c_str());
+      }
 
+      NcVar *intpv_var = file_out.add_var("IPV", ncDouble, out_time, out_lat, out_lon);
+      for (int t=0; t<time_len; t++){
+        pv_var->set_cur(t,0,0,0);
+        pv_var->get(&(PVMat[0][0][0]),1,lev_len,lat_len,lon_len);
+        IPV_calc(lev_len,lat_len,lon_len,lat_res,pVec,PVMat,IPVMat);
+        intpv_var->set_cur(t,0,0);
+        intpv_var->put(&(IPVMat[0][0]),1,lat_len,lon_len);
+      }
     }
 /*
     NcVar *avgt_var = file_out.add_var("AVGT", ncDouble, out_time, out_lat, out_lon);
@@ -25,16 +25,27 @@ of the instantaneous deviation values.
 #include "BlockingUtilities.h"
 #include "NetCDFUtilities.h"
 #include "DFT.h"
+#include "ClimAccumulator.h"
 
 #include <cstdlib>
 #include <cmath>
 #include <cstring>
 #include <complex>
 
+#if defined(TEMPEST_MPIOMP)
+#include <mpi.h>
+#endif
+
 int main(int argc, char ** argv){
+#if defined(TEMPEST_MPIOMP)
+  //Initialize MPI
+  MPI_Init(&argc, &argv);
+#endif
   NcError error(NcError::silent_nonfatal);
   try{
     std::string outFile,fileList,avgName,avgFile,varName,tname,latname,lonname;
+    std::string stateFile,mergeList;
+    int nCheckpoint;
     BeginCommandLine()
       CommandLineString(outFile,"outfile","");
       CommandLineString(fileList,"inlist","");
@@ -44,6 +55,9 @@ int main(int argc, char ** argv){
       CommandLineString(tname,"tname","time");
       CommandLineString(latname,"latname","lat");
       CommandLineString(lonname,"lonname","lon");
+      CommandLineString(stateFile,"state","");
+      CommandLineString(mergeList,"mergestates","");
+      CommandLineInt(nCheckpoint,"checkpoint",1);
       ParseCommandLine(argc,argv);
     EndCommandLine(argv)
     AnnounceBanner();
@@ -95,92 +109,96 @@ int main(int argc, char ** argv){
     avgVar->get(&(avgMat[0][0][0]),dLen,latLen,lonLen);
     std::cout<<"Opening input files"<<std::endl;	
 
-    //Open up the first file
-    NcFile readin(vecFiles[0].c_str());
-    if (!readin.is_valid()){
-      _EXCEPTION1("Unable to open file %s for reading",vecFiles[0].c_str());
+    //Initialize storage (squared deviations) and counts arrays: day, lat, lon
+    //Resume from the state file and merge any partial states
+    ClimatologyAccumulator accum;
+    accum.Initialize("BlockingThresh:" + varName + ":" + avgFile,\
+      dLen, latLen, lonLen);
+    if (stateFile != ""){
+      if (accum.ReadIfExists(stateFile)){
+        std::cout<<"Resuming from "<<stateFile<<" ("<<accum.GetFileCount()\
+          <<" files)"<<std::endl;
+      }
+    }
+    if (mergeList != ""){
+      std::vector<std::string> vecStateFiles;
+      GetInputFileList(mergeList,vecStateFiles);
+      accum.MergeFileList(vecStateFiles);
+    }
+
+    int nMPIRank = 0;
+    int nMPISize = 1;
+#if defined(TEMPEST_MPIOMP)
+    MPI_Comm_rank(MPI_COMM_WORLD, &nMPIRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
+#endif
+
+    //Files that still need to be added
+    std::vector<std::string> vecPending;
+    for (int x=0; x<nFiles; x++){
+      if (accum.HasFile(vecFiles[x])){
+        if (nMPIRank == 0){
+          std::cout<<"Already accumulated "<<vecFiles[x].c_str()<<std::endl;
+        }
+      }else{
+        vecPending.push_back(vecFiles[x]);
+      }
+    }
+
+    //Spread the files across ranks; only rank 0 keeps the resumed
+    //and merged sums so that they are counted once in the reduction
+    if (nMPIRank != 0){
+      accum.ClearSums();
     }
-    int tLen;
-    tLen = readin.get_dim(tname.c_str())->size();
-    //Initialize storage array: day, lat, lon
-    DataMatrix3D<double> storeMat(dLen,latLen,lonLen);
-    //Initialize counts array: day, lat, lon
-    DataMatrix3D<double> countsMat(dLen, latLen, lonLen);
-    //Initialize input data: time, lat, lon
-    DataMatrix<double> inputData(latLen,lonLen);
-    DataVector<double> timeVec(tLen);
 
-    //Close file (then re-open in loop)
-    readin.close();
-		
     //Loop through all available files and store values in appropriate day
     //Part 1: Calculating the average
-    for (int x=0; x<nFiles; x++){
-      NcFile readin(vecFiles[x].c_str());
+    int nAdded = 0;
+    for (int x=nMPIRank; x<vecPending.size(); x+=nMPISize){
+      NcFile readin(vecPending[x].c_str());
       if (!readin.is_valid()){
-        _EXCEPTION1("Unable to open file %s for reading",vecFiles[x].c_str());
+        _EXCEPTION1("Unable to open file %s for reading",vecPending[x].c_str());
       }
-
-      tLen = readin.get_dim(tname.c_str()) ->size();
-      //std::cout<<"Reading in file #"<<x<<", "<<vecFiles[x].c_str()<<std::endl;
-      //Input data
-    //  inputData.Initialize(tLen, latLen, lonLen);
+      std::cout<<"Reading in "<<vecPending[x].c_str()<<std::endl;
       NcVar *inputVar = readin.get_var(varName.c_str());
-    //  inputVar->set_cur(0,0,0);
-    //  inputVar->get(&(inputData[0][0][0]),tLen,latLen,lonLen);
-
-      //Time and calendar
-      timeVec.Initialize(tLen);
       NcVar *timeVar = readin.get_var(tname.c_str());
-      timeVar->set_cur((long)0);
-      timeVar->get(&(timeVec[0]),tLen);
+      //Store the values and counts in the matrices at the appropriate day index
+      accum.AddVariable(inputVar, timeVar, &avgMat);
+      readin.close();
 
-      NcAtt *attTime = timeVar->get_att("units");
-      if (attTime==NULL){
-        _EXCEPTIONT("Time variable has no units attribute.");
-      }
-      std::string strTimeUnits = attTime->as_string(0);
-      std::string strCalendar;
-      NcAtt *attCal = timeVar->get_att("calendar");
-      if (attCal==NULL){
-        strCalendar = "standard";
-      }else{
-        strCalendar = attCal->as_string(0);
-      }
-      if (strncmp(strCalendar.c_str(),"gregorian",9)==0){
-        strCalendar = "standard";
+      //Checkpoint the accumulated state (serial runs only; partial
+      //sums on one rank are not a valid state)
+      if (nMPISize == 1){
+        accum.AddFile(vecPending[x]);
+        nAdded++;
+        if (stateFile != "" && nCheckpoint > 0 && nAdded % nCheckpoint == 0){
+          accum.Write(stateFile);
+        }
       }
+    }
 
-      int dateYear, dateMonth, dateDay, dateHour, dayIndex;
-      bool leap;
-			double avgValue,currDev;
-      //std::cout<<"Storing values."<<std::endl;
-      //Store the values and counts in the matrices at the appropriate day index
-      for (int t=0; t<tLen; t++){
-        inputData.Initialize(latLen,lonLen);
-        inputVar->set_cur(t,0,0);
-        inputVar->get(&(inputData[0][0]),1,latLen,lonLen);
-        ParseTimeDouble(strTimeUnits, strCalendar, timeVec[t],\
-          dateYear, dateMonth, dateDay, dateHour);
-        leap = checkFileLeap(strTimeUnits, strCalendar, dateYear,\
-          dateMonth, dateDay, dateHour, timeVec[t]);
-        if (leap == false){
-          dayIndex = DayInYear(dateMonth, dateDay)-1;
-          for (int a=0; a<latLen; a++){
-            for (int b=0; b<lonLen; b++){
-              avgValue = avgMat[dayIndex][a][b];
-              currDev = inputData[a][b]-avgValue;
-              storeMat[dayIndex][a][b]+= (currDev*currDev);
-              countsMat[dayIndex][a][b]+= 1.;
-            }
-          }
-        }
+    //Combine the sums of all ranks
+    if (nMPISize > 1){
+      accum.Allreduce();
+      for (int x=0; x<vecPending.size(); x++){
+        accum.AddFile(vecPending[x]);
       }
-      readin.close();
     }
+    if (stateFile != "" && nMPIRank == 0){
+      accum.Write(stateFile);
+    }
+#if defined(TEMPEST_MPIOMP)
+    //Smoothing and output are done on rank 0
+    if (nMPIRank != 0){
+      MPI_Finalize();
+      return 0;
+    }
+#endif
 
     
-    //Calculating 1.5*SD
+    //Calculating 1.5*SD from the sum of squared deviations
+    DataMatrix3D<double> & storeMat = accum.GetSumSq();
+    DataMatrix3D<double> & countsMat = accum.GetCounts();
     for (int d=0;d<dLen;d++){
       for (int a=0;a<latLen;a++){
         for (int b=0;b<lonLen;b++){
@@ -225,22 +243,14 @@ int main(int argc, char ** argv){
 
     std::cout<<"calculating DFT of threshold"<<std::endl;
     //First, try zonal average
-    std::vector<double>zonalDaily(lonLen);
-    std::vector<std::complex<double> >FC(lonLen);
-    std::vector<double> zonalOut(lonLen);
+    //(wavenumber 0 and half of wavenumber 1 along each lat row)
+    HarmonicFilter zonalFilter(lonLen,1);
     DataMatrix3D<double> zonalMat(dLen,latLen,lonLen);
 
+#pragma omp parallel for schedule(dynamic)
     for (int d=0; d<dLen; d++){
-      for (int a=0; a<latLen; a++){
-        for (int b=0; b<lonLen; b++){
-          zonalDaily[b] = storeMat[d][a][b];
-        }
-        FC = DFT(zonalDaily,1);
-        zonalOut = IDFT(FC);
-        for (int b=0; b<lonLen; b++){
-          zonalMat[d][a][b] = zonalOut[b];
-        }
-      }
+      zonalFilter.ApplyBatch(storeMat.GetRow(d,0), latLen, lonLen, 1,\
+        zonalMat.GetRow(d,0), lonLen, 1);
     }
     //Add on a lat average
     //Do separate averages for NH and SH
@@ -252,47 +262,20 @@ int main(int argc, char ** argv){
         break;
       }
     }
-    int lat1 = latVec[0];
-    //Case 1: lat vector goes from NH to SH
-    int NHLen,SHLen;
-    if (lat1>0){
-      NHLen = eqIndex;
-      SHLen = latLen - eqIndex;
-    }
-    else{
-      NHLen = latLen - eqIndex;
-      SHLen = eqIndex;
-    }
 
-    std::vector<double>NH(NHLen);
-    std::vector<double>SH(SHLen);
-    std::vector<std::complex<double> > FCNH(NHLen);
-    std::vector<std::complex<double> > FCSH(SHLen);
-    std::vector<double> NHout(NHLen);
-    std::vector<double> SHout(SHLen);
-    int a1;
+    //Smooth along latitude separately in each hemisphere
+    //(rows before the equator index and from it onward),
+    //batched over longitude
+    int nPlane = latLen*lonLen;
+    HarmonicFilter NHFilter(eqIndex,1);
+    HarmonicFilter SHFilter(latLen-eqIndex,1);
     DataMatrix3D<double>zmMat(dLen,latLen,lonLen);
+#pragma omp parallel for schedule(dynamic)
     for (int d=0; d<dLen; d++){
-      for (int b=0; b<lonLen; b++){
-        for (int a=0; a<eqIndex; a++){
-          NH[a] = zonalMat[d][a][b];
-        }
-        for (int a=eqIndex; a<latLen; a++){
-          a1 = a-eqIndex;
-          SH[a1] = zonalMat[d][a][b];
-        }
-        FCNH = DFT(NH,1);
-        NHout = IDFT(FCNH);
-        FCSH = DFT(SH,1);
-        SHout = IDFT(FCSH);
-        for (int a=0; a<eqIndex; a++){
-          zmMat[d][a][b] = NHout[a];
-        }
-        for (int a=eqIndex; a<latLen; a++){
-          a1 = a-eqIndex;
-          zmMat[d][a][b] = SHout[a1];
-        }
-      }
+      NHFilter.ApplyBatch(zonalMat.GetRow(d,0), lonLen, 1, lonLen,\
+        zmMat.GetRow(d,0), 1, lonLen);
+      SHFilter.ApplyBatch(zonalMat.GetRow(d,eqIndex), lonLen, 1, lonLen,\
+        zmMat.GetRow(d,eqIndex), 1, lonLen);
     }
 
     //Alternate attempt: moving average (if DFT not appropriate)
@@ -305,23 +288,13 @@ int main(int argc, char ** argv){
   */
 
   //Just for fun... the DFT of the SDs
-    std::vector<double> inputDaily(dLen);
-    std::vector<std::complex<double> >FourierCoefs(dLen);
-    std::vector<double>outputDaily(dLen);
+    HarmonicFilter dailyFilter(dLen,4);
     DataMatrix3D<double> outputMat(dLen,latLen,lonLen);
 
-
+#pragma omp parallel for schedule(dynamic)
     for (int a=0; a<latLen; a++){
-      for (int b=0; b<lonLen; b++){
-        for (int d=0; d<dLen; d++){
-          inputDaily[d] = zmMat[d][a][b];
-        }
-        FourierCoefs = DFT(inputDaily,4);
-        outputDaily = IDFT(FourierCoefs);
-        for (int d=0; d<dLen; d++){
-          outputMat[d][a][b] = outputDaily[d];
-        }
-      }
+      dailyFilter.ApplyBatch(zmMat.GetRow(0,a), lonLen, 1, nPlane,\
+        outputMat.GetRow(0,a), 1, nPlane);
     }
 
     
@@ -335,5 +308,18 @@ int main(int argc, char ** argv){
   }
   catch (Exception &e){
     std::cout<<e.ToString()<<std::endl;
+#if defined(TEMPEST_MPIOMP)
+    //Other ranks may be waiting in the reduction of the sums and
+    //would never return
+    int nMPISize = 1;
+    MPI_Comm_size(MPI_COMM_WORLD, &nMPISize);
+    if (nMPISize > 1){
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+#endif
   }
+#if defined(TEMPEST_MPIOMP)
+  //Deinitialize MPI
+  MPI_Finalize();
+#endif
 }
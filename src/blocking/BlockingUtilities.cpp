@@ -8,6 +8,7 @@
 ///
 
 #include "BlockingUtilities.h"
+#include "VerticalInterp.h"
 #include "NetCDFUtilities.h"
 #include "netcdfcpp.h"
 #include "DataVector.h"
@@ -21,6 +22,7 @@
 #include <cmath>
 #include <cstring>
 #include <vector>
+#include <algorithm>
 
 //////////////////////////////////////
 //    SECTION: FILE OPERATIONS      //
@@ -82,6 +84,16 @@ bool checkFileLeap(
   int dateHour,
   double timeVal
 ){
+  TimeDecoder timeDecoder(strTimeUnits, strCalendar);
+  return checkFileLeap(timeDecoder, dateMonth, timeVal);
+}
+
+//As above, with the time units and calendar already parsed
+bool checkFileLeap(
+  const TimeDecoder & timeDecoder,
+  int dateMonth,
+  double timeVal
+){
 
   bool leap = false;
 
@@ -90,11 +102,11 @@ bool checkFileLeap(
   int leapDay=0;
   int leapHour=0;
 
-  if (strCalendar!="noleap" && dateMonth<=2){
+  if (timeDecoder.GetCalendarType()==TimeDecoder::CalendarStandard \
+    && dateMonth<=2){
     //Check whether file contains a Feb 29
 
-    ParseTimeDouble(strTimeUnits, strCalendar, timeVal, leapYear,\
-      leapMonth, leapDay, leapHour);
+    timeDecoder.Decode(timeVal, leapYear, leapMonth, leapDay, leapHour);
 
     if ((leapMonth==2 && leapDay==29) || (dateMonth==2&&leapMonth==3)){
       //Check when parsing the indices
@@ -129,121 +141,17 @@ int DayInYear(int nMonth, int nDay){
 //takes a time value (in units of hours or 
 //days since reference date) and returns 4
 //integer values: year, month, day, and hour
+//The decoder is constructed once per file from the units
+//and calendar of its time variable
 void ParseTimeDouble(
-	const std::string & strTimeUnits,
-	const std::string & strTimeCalendar,
+	const TimeDecoder & timeDecoder,
 	double dTime,
 	int & nDateYear,
 	int & nDateMonth,
 	int & nDateDay,
 	int & nDateHour
 ) {
-	// Get calendar type
-	Time::CalendarType cal;
-	if ((strTimeCalendar.length() >= 6) &&
-		(strncmp(strTimeCalendar.c_str(), "noleap", 6) == 0)
-	) {
-		cal = Time::CalendarNoLeap;
-
-	} else if (
-		(strTimeCalendar.length() >= 8) &&
-		(strncmp(strTimeCalendar.c_str(), "standard", 8) == 0)
-	) {
-		cal = Time::CalendarStandard;
-
-	} else if (
-                (strTimeCalendar.length() >=9) &&
-                (strncmp(strTimeCalendar.c_str(), "gregorian",9)==0)
-        ) {
-                cal = Time::CalendarStandard;
-        } else {
-		_EXCEPTION1("Unknown calendar type \"%s\"", strTimeCalendar.c_str());
-	}
-/*
-	Time time(Time::CalendarStandard);
-	time.FromFormattedString("1800-01-01 00:00:00");
-	printf("%1.15e %i\n", 3600.0 * 1577832.0, (int)(3600.0 * 1577832.0));
-	time.AddHours(1577832);
-
-	Announce("Time (YMDS): %i %i %i %i",
-			time.GetYear(),
-			time.GetMonth(),
-			time.GetDay(),
-			time.GetSecond());
-
-	_EXCEPTION();
-*/
-	// Time format is "days since ..."
-	if ((strTimeUnits.length() >= 11) &&
-	    (strncmp(strTimeUnits.c_str(), "days since ", 11) == 0)
-	) {
-		std::string strSubStr = strTimeUnits.substr(11);
-		Time time(cal);
-		time.FromFormattedString(strSubStr);
-
-		int nDays = static_cast<int>(dTime);
-		time.AddDays(nDays);
-
-		int nSeconds = static_cast<int>(fmod(dTime, 1.0) * 86400.0);
-		time.AddSeconds(nSeconds);
-
-	/*	Announce("Time (YMDS): %i %i %i %i",
-				time.GetYear(),
-				time.GetMonth(),
-				time.GetDay(),
-				time.GetSecond());*/
-
-
-		nDateYear = time.GetYear();
-		nDateMonth = time.GetMonth();
-		nDateDay = time.GetDay();
-		nDateHour = time.GetSecond() / 3600;
-
-		//printf("%s\n", strSubStr.c_str());
-
-	// Time format is "hours since ..."
-	} else if (
-	    (strTimeUnits.length() >= 12) &&
-	    (strncmp(strTimeUnits.c_str(), "hours since ", 12) == 0)
-	) {
-		std::string strSubStr = strTimeUnits.substr(12);
-		Time time(cal);
-		time.FromFormattedString(strSubStr);
-//                printf("Debug: dTime is %10f \n",dTime);
-		time.AddHours(static_cast<int>(dTime));
-  //              printf("Debug: after AddHours dTime is %10f\n",dTime);
-	/*	Announce("Time (YMDS): %i %i %i %i",
-				time.GetYear(),
-				time.GetMonth(),
-				time.GetDay(),
-				time.GetSecond());*/
-
-		nDateYear = time.GetYear();
-		nDateMonth = time.GetMonth();
-		nDateDay = time.GetDay();
-		nDateHour = time.GetSecond() / 3600;
-		//printf("%s\n", strSubStr.c_str());
-
-	// Time format is "minutes since ..."
-	} else if (
-	    (strTimeUnits.length() >= 14) &&
-	    (strncmp(strTimeUnits.c_str(), "minutes since ", 14) == 0)
-	) {
-		std::string strSubStr = strTimeUnits.substr(14);
-		Time time(cal);
-		time.FromFormattedString(strSubStr);
-		time.AddMinutes(static_cast<int>(dTime));
-
-		nDateYear = time.GetYear();
-		nDateMonth = time.GetMonth();
-		nDateDay = time.GetDay();
-		nDateHour = time.GetSecond() / 3600;
-		//printf("%s\n", strSubStr.c_str());
-
-	} else {
-		_EXCEPTIONT("Unknown \"time::units\" format");
-	}
-	//_EXCEPTION();
+	timeDecoder.Decode(dTime, nDateYear, nDateMonth, nDateDay, nDateHour);
 }
 
 //Takes the last time value of the previous file
@@ -292,6 +200,7 @@ void copy_dim_var(
 //Function to interpolate variables from hybrid levels to pressure levels
 //Takes input variable and reference variables hyam,hybm and returns
 //variable with new pressure level axis (specified by pLev)
+//Time steps are streamed: step t+1 is read while step t is interpolated
 void interpolate_lev(NcVar *var, 
                      NcVar *hyam, 
                      NcVar *hybm, 
@@ -301,7 +210,6 @@ void interpolate_lev(NcVar *var,
 ){
 
   int nTime,nLev,nLat,nLon,npLev;
-  double A1,A2,B1,B2,p1,p2,weight;
 
   //Array dimensions
   nTime = var->get_dim(0)->size();
@@ -325,57 +233,104 @@ void interpolate_lev(NcVar *var,
   DataVector<double> vecpLev(npLev);
   pLev->set_cur((long) 0);
   pLev->get(&(vecpLev[0]), npLev);
- 
-  //Matrix to store PS
-  DataMatrix <double> matPS(nLat, nLon);
 
-  //Matrix to store input variable data
-  DataMatrix3D<double> matVar(nLev, nLat, nLon);
+  //Levels below the surface take the lowest model level value
+  VerticalInterpolator interp;
+  interp.InitializeHybrid(vecHyam, vecHybm, 100000.0, vecpLev);
+ 
+  //Matrices to store PS and the input variable data
+  //(two of each so that the next time step can be read in
+  //while the current one is interpolated)
+  DataMatrix <double> matPS[2];
+  DataMatrix3D<double> matVar[2];
+  for (int i=0; i<2; i++){
+    matPS[i].Initialize(nLat, nLon);
+    matVar[i].Initialize(nLev, nLat, nLon);
+  }
   
   //Matrix to store output variable data
   DataMatrix3D<double> matVarOut(npLev, nLat, nLon);
   //std::cout<<"within interpolate_lev: about to interpolate"<<std::endl; 
   //Loop over input data and interpolate to output var
+  if (nTime > 0){
+    ps->set_cur(0, 0, 0);
+    ps->get(matPS[0].GetData(), 1, nLat, nLon);
+    var->set_cur(0, 0, 0, 0);
+    var->get(matVar[0].GetData(), 1, nLev, nLat, nLon);
+  }
+  //Both buffers have the same shape, so one check covers all steps
+  interp.CheckInput(matPS[0], matVar[0]);
   for (int t=0; t<nTime; t++){
-    ps->set_cur(t, 0, 0);
-    ps->get(&(matPS[0][0]), 1, nLat, nLon);
-    var->set_cur(t, 0, 0, 0);
-    var->get(&(matVar[0][0][0]), 1, nLev, nLat, nLon);
-    for (int l=0; l<(nLev-1); l++){
-      A1 = vecHyam[l];
-      B1 = vecHybm[l];
-      A2 = vecHyam[l+1];
-      B2 = vecHybm[l+1];
-      for (int a=0; a<nLat; a++){
-        for (int b=0; b<nLon; b++){
-	  int interp_check = 0;
-          p1 = 100000.0 * A1 + matPS[a][b] * B1;
-          p2 = 100000.0 * A2 + matPS[a][b] * B2;
-          for (int p=0; p<npLev; p++){
-            if (p1<vecpLev[p] && p2>=vecpLev[p]){
-	      interp_check = 1;
-              weight = ((vecpLev[p]-p1)/(p2-p1));
-              matVarOut[p][a][b] = weight*matVar[l+1][a][b]
-                               + (1.0-weight)*matVar[l][a][b];
-            }
-          }
+    DataMatrixView<double> currPS(matPS[t%2]);
+    DataMatrix3DView<double> currVar(matVar[t%2]);
+    //One thread reads the next step, then joins the
+    //other threads interpolating the current one
+#pragma omp parallel
+    {
+#pragma omp single nowait
+      {
+        if (t+1 < nTime){
+          ps->set_cur(t+1, 0, 0);
+          ps->get(matPS[(t+1)%2].GetData(), 1, nLat, nLon);
+          var->set_cur(t+1, 0, 0, 0);
+          var->get(matVar[(t+1)%2].GetData(), 1, nLev, nLat, nLon);
         }
       }
+#pragma omp for schedule(dynamic)
+      for (int a=0; a<nLat; a++){
+        interp.InterpolateRows(currPS, currVar, a, a+1, matVarOut);
+      }
     }
     NewVar->set_cur(t, 0, 0, 0);
-    NewVar->put(&(matVarOut[0][0][0]),1, npLev, nLat, nLon);
+    NewVar->put(matVarOut.GetData(),1, npLev, nLat, nLon);
 
   }
   CopyNcVarAttributes(var, NewVar);
 }
 
+//Averages a (lev, lat, lon) block over the levels pos_top..pos_bot
+//with the trapezoidal rule. Each level holds nPlane contiguous values
+//and levels are nStride elements apart, so a band of lat rows can be
+//averaged in place. Levels are streamed one plane at a time so the
+//inner loop runs over contiguous memory; mid is scratch space of
+//length nPlane
+static void LevelAvgPlane(
+  const double * __restrict data,
+  int nPlane,
+  size_t nStride,
+  int pos_top,
+  int pos_bot,
+  double invLevLen,
+  double * __restrict mid,
+  double * __restrict out
+){
+  const double * __restrict top = data + (size_t)pos_top*nStride;
+  const double * __restrict bot = data + (size_t)pos_bot*nStride;
+  for (int i=0; i<nPlane; i++){
+    mid[i] = 0.0;
+  }
+  for (int p=(pos_top+1); p<pos_bot; p++){
+    const double * __restrict lev = data + (size_t)p*nStride;
+    for (int i=0; i<nPlane; i++){
+      mid[i]+=2.0*lev[i];
+    }
+  }
+  for (int i=0; i<nPlane; i++){
+    out[i] = (top[i]+bot[i]+mid[i])*invLevLen;
+  }
+}
+
 //Function that takes an input variable (with pressure axis as vertical)
 //and averages variable along the pressure dimension from 150-500 hPa. 
 //Returns variable with dimensions [time, lat, lon]
+//The input is streamed in slabs of at most nTimeBlock time steps;
+//slab k+1 is read while slab k is integrated, so memory use does
+//not depend on the length of the file
 void VarPressureAvg(
 	NcVar * invar,
 	NcVar * pVals,
-	NcVar * outvar
+	NcVar * outvar,
+	int nTimeBlock
 ){
 	int nTime,nLat,nLon,nPlev;
 	nTime = invar->get_dim(0)->size();
@@ -383,11 +338,14 @@ void VarPressureAvg(
 	nLat = invar->get_dim(2)->size();
 	nLon = invar->get_dim(3)->size();
 
-	//Input into Matrix
-	DataMatrix4D<double> inMat(nTime,nPlev,nLat,nLon);
-	invar->set_cur(0,0,0,0);
-	invar->get(&(inMat[0][0][0][0]),nTime,nPlev,nLat,nLon);
-	
+	if (nTimeBlock < 1){
+		_EXCEPTIONT("Time block size must be at least 1.");
+	}
+	if (nTime == 0){
+		return;
+	}
+	int nBlock = std::min(nTimeBlock, nTime);
+
     //Pressure axis values
     DataVector<double> pVec(nPlev);
     pVals->set_cur((long) 0);
@@ -413,28 +371,48 @@ void VarPressureAvg(
       pos_top = temp;
     }
 
-    DataMatrix3D<double> outMat(nTime, nLat, nLon);  
-    double bot,mid,top;
     double modLevLen = pos_bot-pos_top;
     double invLevLen = 1.0/(2.0*modLevLen);
 
+    //Input slabs (double buffered) and output slab
+    DataMatrix4D<double> inSlab[2];
+    inSlab[0].Initialize(nBlock,nPlev,nLat,nLon);
+    inSlab[1].Initialize(nBlock,nPlev,nLat,nLon);
+    DataMatrix3D<double> outSlab(nBlock, nLat, nLon);
+
+    int nPlane = nLat*nLon;
+    DataVector<double> midVec(nPlane);
+
+    invar->set_cur(0,0,0,0);
+    invar->get(inSlab[0].GetData(),nBlock,nPlev,nLat,nLon);
+
     //Calculate integration parts
-    for (int t=0; t<nTime; t++){
-      for (int a=0; a<nLat; a++){
-        for (int b=0; b<nLon; b++){
-          top = inMat[t][pos_top][a][b];
-          bot = inMat[t][pos_bot][a][b];
-          mid = 0.0;
-          for (int p=(pos_top+1); p<pos_bot; p++){
-            mid+=2.0*inMat[t][p][a][b];
+    for (int t0=0, k=0; t0<nTime; t0+=nBlock, k++){
+      int nt = std::min(nBlock, nTime-t0);
+      int tNext = t0+nt;
+      int ntNext = std::min(nBlock, nTime-tNext);
+      const DataMatrix4D<double> & currSlab = inSlab[k%2];
+      DataMatrix4D<double> & nextSlab = inSlab[(k+1)%2];
+#pragma omp parallel sections num_threads(2)
+      {
+#pragma omp section
+        {
+          if (ntNext > 0){
+            invar->set_cur(tNext,0,0,0);
+            invar->get(nextSlab.GetData(),ntNext,nPlev,nLat,nLon);
+          }
+        }
+#pragma omp section
+        {
+          for (int t=0; t<nt; t++){
+            LevelAvgPlane(currSlab.GetRow(t,0,0), nPlane, nPlane, pos_top, pos_bot,\
+              invLevLen, &(midVec[0]), outSlab.GetRow(t,0));
           }
-          outMat[t][a][b] = (top+bot+mid)*invLevLen;
         }
       }
+      outvar->set_cur(t0,0,0);
+      outvar->put(outSlab.GetData(),nt,nLat,nLon);
     }
- 
-    outvar->set_cur(0,0,0);
-    outvar->put(&(outMat[0][0][0]),nTime,nLat,nLon);
     std::cout<<"Finished integrating variable."<<std::endl;
 }
 
@@ -449,7 +427,7 @@ void PT_calc(
         int nPlev,
         int nLat,
         int nLon,
-	DataMatrix3D<double>TMat, 
+	DataMatrix3DView<double> TMat,
 	NcVar *pLev, 
 	DataMatrix3D<double> &PTMat
 ){
@@ -463,14 +441,20 @@ void PT_calc(
   pLev->set_cur((long) 0);
   pLev->get(&(pVec[0]), nPlev);
 
+  if (!TMat.IsContiguous()){
+    _EXCEPTIONT("PT_calc requires contiguous input.");
+  }
+
   //OUTPUT: PT
-//  DataMatrix4D<double> PTMat(nTime, nPlev, nLat, nLon);
+  int nPlane = nLat*nLon;
+  const double * __restrict tData = TMat.GetData();
+  double * __restrict ptData = PTMat.GetData();
     for (int p=0; p<nPlev; p++){
-      pFrac = 100000.0/pVec[p];
-      for (int a=0; a<nLat; a++){
-        for (int b=0; b<nLon; b++){
-          PTMat[p][a][b] = TMat[p][a][b]*std::pow(pFrac, exp);
-        }
+      pFrac = std::pow(100000.0/pVec[p], exp);
+      const double * __restrict tLev = tData + (size_t)p*nPlane;
+      double * __restrict ptLev = ptData + (size_t)p*nPlane;
+      for (int i=0; i<nPlane; i++){
+        ptLev[i] = tLev[i]*pFrac;
       }
     }
 //  std::cout<<"Finished calculating PT."<<std::endl;
@@ -533,11 +517,11 @@ void rVort_calc(
         int nPlev,
         int nLat,
         int nLon,
-	DataMatrix3D<double>UMat,
-	DataMatrix3D<double>VMat,
+	DataMatrix3DView<double> UMat,
+	DataMatrix3DView<double> VMat,
 	double dphi,
 	double dlambda,
-	DataVector<double> cosphi,
+	DataVectorView<double> cosphi,
 	DataMatrix3D<double> & RVMat
 ){
 
@@ -546,50 +530,46 @@ void rVort_calc(
   double invDphi = 1.0/(2.0*dphi);
   double coef;
 
-//OUTPUT: Partial derivatives
-//U WRT PHI
-  DataMatrix3D<double> dUdphi(nPlev, nLat, nLon);
-    for (int p=0; p<nPlev; p++){
-      for (int b=0; b<nLon; b++){
-        dUdphi[p][0][b]=(-UMat[p][2][b]*cosphi[2]\
-          +4.0*UMat[p][1][b]*cosphi[1]\
-          -3.0*UMat[p][0][b]*cosphi[0])*invDphi;
-        dUdphi[p][nLat-1][b]=(3.0*UMat[p][nLat-1][b]*cosphi[nLat-1]\
-          -4.0*UMat[p][nLat-2][b]*cosphi[nLat-2]\
-          +UMat[p][nLat-3][b]*cosphi[nLat-3])*invDphi;
-        for (int a=1; a<(nLat-1); a++){
-          dUdphi[p][a][b]=(UMat[p][a+1][b]*cosphi[a+1]\
-           -UMat[p][a-1][b]*cosphi[a-1])*invDphi;
-        }
-      }
-    }
+  if (!UMat.IsContiguous() || !VMat.IsContiguous()){
+    _EXCEPTIONT("rVort_calc requires contiguous input.");
+  }
 
-  //V WRT LAMBDA
-  DataMatrix3D<double> dVdl(nPlev, nLat, nLon);
-    for (int p=0; p<nPlev; p++){
-      for (int a=0; a<nLat; a++){
-        dVdl[p][a][0]=(VMat[p][a][1]-VMat[p][a][nLon-1])*invDlambda;
-        dVdl[p][a][nLon-1]=(VMat[p][a][0]-VMat[p][a][nLon-2])*invDlambda;
-        for (int b=1; b<(nLon-1); b++){
-          dVdl[p][a][b]=(VMat[p][a][b+1]-VMat[p][a][b-1])*invDlambda;
-        }
-      }
-    }
+  //Partial derivatives of U WRT PHI and V WRT LAMBDA are
+  //computed row by row and combined directly into RV
+  int nPlane = nLat*nLon;
+  const double * __restrict uData = UMat.GetData();
+  const double * __restrict vData = VMat.GetData();
+  double * __restrict rvData = RVMat.GetData();
 
     for (int p=0; p<nPlev; p++){
-      for (int a=0; a<nLat; a++){
+      for (int a=1; a<(nLat-1); a++){
+        size_t offset = (size_t)p*nPlane + (size_t)a*nLon;
+        const double * __restrict uN = uData + offset + nLon;
+        const double * __restrict uS = uData + offset - nLon;
+        const double * __restrict v = vData + offset;
+        double * __restrict rv = rvData + offset;
+        double cosN = cosphi[a+1];
+        double cosS = cosphi[a-1];
         coef = 1.0/(radius*cosphi[a]);
-        for (int b=0; b<nLon; b++){
-          RVMat[p][a][b] = coef*(dVdl[p][a][b]-dUdphi[p][a][b]);
+
+        rv[0] = coef*((v[1]-v[nLon-1])*invDlambda\
+          -(uN[0]*cosN-uS[0]*cosS)*invDphi);
+        rv[nLon-1] = coef*((v[0]-v[nLon-2])*invDlambda\
+          -(uN[nLon-1]*cosN-uS[nLon-1]*cosS)*invDphi);
+        for (int b=1; b<(nLon-1); b++){
+          rv[b] = coef*((v[b+1]-v[b-1])*invDlambda\
+            -(uN[b]*cosN-uS[b]*cosS)*invDphi);
         }
       }
     }
 
   //Lat end cases: set to 0 because of pole singularities causing error
     for (int p=0; p<nPlev; p++){
+      double * __restrict rvS = rvData + (size_t)p*nPlane;
+      double * __restrict rvN = rvS + (size_t)(nLat-1)*nLon;
       for (int b=0; b<nLon; b++){
-        RVMat[p][0][b] = 0.0;
-        RVMat[p][nLat-1][b] = 0.0;
+        rvS[b] = 0.0;
+        rvN[b] = 0.0;
       }
     }
 
@@ -638,13 +618,13 @@ double GHcheck(double z_0,
 
 
 bool missingValCheck(
-  DataMatrix3D<double> fillData,
+  DataMatrix3DView<double> fillData,
   int nTime,
   double missingNum
 ){
     bool isMissing = false;
     for (int t=0; t<nTime; t++){
-      if (fillData[t][2][2] == missingNum){
+      if (fillData(t,2,2) == missingNum){
         isMissing = true;
         break;
       }
@@ -654,27 +634,17 @@ bool missingValCheck(
 }
 
 void MissingFill(
-  double missingValue,
   double tRes,
   double contCheck,
-  int nLat,
-  int nLon,
-  int arrLen,
   int & currArrIndex,
   int & dateIndex,
-  DataMatrix3D<double> & currFillData
+  SlidingWindowSum & window
 ){
-
   int nFill = contCheck/tRes-1;
   int nDaysSkip = int(contCheck-tRes);
-  //std::cout<<"ContCheck is " << contCheck << " and tRes is "<<\
-   tRes <<" and nFill is "<<nFill << std::endl;
+  int arrLen = window.GetSlotCount();
   for (int n=0; n<nFill; n++){
-    for (int a=0; a<nLat; a++){
-      for (int b=0; b<nLon; b++){
-        currFillData[currArrIndex][a][b] = missingValue;
-      } 
-    }
+    window.SetSlotMissing(currArrIndex);
     currArrIndex +=1;
     if (currArrIndex >= arrLen){
       currArrIndex -= arrLen;
@@ -684,7 +654,6 @@ void MissingFill(
   if (dateIndex >= 365){
     dateIndex-=365;
   }
-  //std::cout<<"The new date index is "<<dateIndex<<" at the end of the missing fill."<<std::endl;
 }
 
 
@@ -692,6 +661,41 @@ void MissingFill(
 //    SECTION: FINAL VARIABLE CALCULATIONS      //
 //////////////////////////////////////////////////
 
+//Vertical centered difference of one lat row of a contiguous
+//(lev, lat, lon) field, with one-sided differences at the end levels.
+//x points at the row on level p; levels are nPlane elements apart
+static void dpRow(
+  const double * __restrict x,
+  int p,
+  int nPlev,
+  int nPlane,
+  int nLon,
+  double invdp1,
+  double invdp2,
+  double invdp,
+  double * __restrict out
+){
+  if (p == 0){
+    const double * __restrict x1 = x + nPlane;
+    const double * __restrict x2 = x1 + nPlane;
+    for (int b=0; b<nLon; b++){
+      out[b] = (-x2[b]+4.0*x1[b]-3.0*x[b])*invdp1;
+    }
+  }else if (p == nPlev-1){
+    const double * __restrict x1 = x - nPlane;
+    const double * __restrict x2 = x1 - nPlane;
+    for (int b=0; b<nLon; b++){
+      out[b] = (3.0*x[b]-4.0*x1[b]+x2[b])*invdp2;
+    }
+  }else{
+    const double * __restrict xU = x + nPlane;
+    const double * __restrict xD = x - nPlane;
+    for (int b=0; b<nLon; b++){
+      out[b] = (xU[b]-xD[b])*invdp;
+    }
+  }
+}
+
 //Takes 4D variables for wind, potential temperature,
 //relative vorticity, etc and outputs both 4D (time,
 //lev, lat, lon) and 3D (time, lat, lon) vertically 
@@ -700,13 +704,13 @@ void PV_calc(
         int nPlev,
         int nLat,
         int nLon,
-	DataMatrix3D<double>UMat,
-	DataMatrix3D<double>VMat,
-	DataMatrix3D<double> PTMat,
-	DataMatrix3D<double> RVMat,
-        DataVector<double>pVec,	
-	DataVector<double> coriolis,
-        DataVector<double>cosphi,
+	DataMatrix3DView<double> UMat,
+	DataMatrix3DView<double> VMat,
+	DataMatrix3DView<double> PTMat,
+	DataMatrix3DView<double> RVMat,
+        DataVectorView<double> pVec,	
+	DataVectorView<double> coriolis,
+        DataVectorView<double> cosphi,
 	double dphi,
 	double dlambda,
         double lat_res,
@@ -719,73 +723,76 @@ void PV_calc(
   double radius = 6371000.0;
   double coef1,coef2,corvar;
 
-  //Matrices for the partials
-  //PT, U, V WRT P
-  DataMatrix3D<double> dpt_dp(nPlev, nLat, nLon);
-  DataMatrix3D<double> du_dp(nPlev, nLat, nLon);
-  DataMatrix3D<double> dv_dp(nPlev, nLat, nLon);
+  if (!UMat.IsContiguous() || !VMat.IsContiguous()\
+    || !PTMat.IsContiguous() || !RVMat.IsContiguous()){
+    _EXCEPTIONT("PV_calc requires contiguous input.");
+  }
+
+  int nPlane = nLat*nLon;
+  const double * __restrict uData = UMat.GetData();
+  const double * __restrict vData = VMat.GetData();
+  const double * __restrict ptData = PTMat.GetData();
+  const double * __restrict rvData = RVMat.GetData();
+  double * __restrict pvData = PVMat.GetData();
+
+  //Partials for the current lat row
+  //PT, U, V WRT P; PT WRT PHI and LAMBDA
+  DataVector<double> dpt_dp(nLon);
+  DataVector<double> du_dp(nLon);
+  DataVector<double> dv_dp(nLon);
+  DataVector<double> dpt_dphi(nLon);
+  DataVector<double> dpt_dl(nLon);
 
   invdp1 = 1.0/(2.0*std::fabs(pVec[1]-pVec[0]));
   invdp2 = 1.0/(2.0*std::fabs(pVec[nPlev-1]-pVec[nPlev-2]));
 
-    for (int a=0; a<nLat; a++){
-      for (int b=0; b<nLon; b++){
-      //0 case
-        dpt_dp[0][a][b] = (-PTMat[2][a][b]+4.0*PTMat[1][a][b]-3.0*PTMat[0][a][b])*invdp1;
-        du_dp[0][a][b] = (-UMat[2][a][b]+4.0*UMat[1][a][b]-3.0*UMat[0][a][b])*invdp1;
-        dv_dp[0][a][b] = (-VMat[2][a][b]+4.0*VMat[1][a][b]-3.0*VMat[0][a][b])*invdp1;           //end case
-        dpt_dp[nPlev-1][a][b] = (3.0*PTMat[nPlev-1][a][b]-4.0*PTMat[nPlev-2][a][b]\
-          +PTMat[nPlev-3][a][b])*invdp2;
-        du_dp[nPlev-1][a][b] = (3.0*UMat[nPlev-1][a][b]-4.0*UMat[nPlev-2][a][b]\
-          +UMat[nPlev-3][a][b])*invdp2;
-        dv_dp[nPlev-1][a][b] = (3.0*VMat[nPlev-1][a][b]-4.0*VMat[nPlev-2][a][b]\
-          +VMat[nPlev-3][a][b])*invdp2;
-        for (int p=1; p<(nPlev-1); p++){
-          invdp = 1.0/(2.0*std::fabs(pVec[p+1]-pVec[p]));
-          dpt_dp[p][a][b] = (PTMat[p+1][a][b]-PTMat[p-1][a][b])*invdp;
-          du_dp[p][a][b] = (UMat[p+1][a][b]-UMat[p-1][a][b])*invdp;
-          dv_dp[p][a][b] = (VMat[p+1][a][b]-VMat[p-1][a][b])*invdp;
-        }
-      }
-    }
-  
-  //PT WRT PHI
-  DataMatrix3D<double> dpt_dphi(nPlev, nLat, nLon);
-  //end cases
+  coef2 = 1.0/radius;
+  //PV Calculation!
     for (int p=0; p<nPlev; p++){
-      for (int b=0; b<nLon; b++){
-        dpt_dphi[p][0][b]=(-PTMat[p][2][b]+4.0*PTMat[p][1][b]\
-          -3.0*PTMat[p][0][b])*invdphi;
-        dpt_dphi[p][nLat-1][b]=(3.0*PTMat[p][nLat-1][b]-4.0*PTMat[p][nLat-2][b]\
-          +PTMat[p][nLat-2][b])*invdphi;
-        for (int a=1; a<(nLat-1); a++){
-          dpt_dphi[p][a][b]=(PTMat[p][a+1][b]-PTMat[p][a-1][b])*invdphi;
-        }
+      invdp = 0.0;
+      if (p>0 && p<(nPlev-1)){
+        invdp = 1.0/(2.0*std::fabs(pVec[p+1]-pVec[p]));
       }
-    }
-
-  //PT WRT LAMBDA
-  DataMatrix3D<double> dpt_dl(nPlev, nLat, nLon);
-  //end cases
-    for (int p=0; p<nPlev; p++){
       for (int a=0; a<nLat; a++){
-        dpt_dl[p][a][0]=(PTMat[p][a][1]-PTMat[p][a][nLon-1])*invdlambda;
-        dpt_dl[p][a][nLon-1]=(PTMat[p][a][nLon-2]-PTMat[p][a][0])*invdlambda;
+        size_t offset = (size_t)p*nPlane + (size_t)a*nLon;
+        const double * __restrict pt = ptData + offset;
+
+        dpRow(pt, p, nPlev, nPlane, nLon, invdp1, invdp2, invdp, &(dpt_dp[0]));
+        dpRow(uData + offset, p, nPlev, nPlane, nLon, invdp1, invdp2, invdp, &(du_dp[0]));
+        dpRow(vData + offset, p, nPlev, nPlane, nLon, invdp1, invdp2, invdp, &(dv_dp[0]));
+
+      //PT WRT PHI (end cases are one-sided)
+        if (a == 0){
+          for (int b=0; b<nLon; b++){
+            dpt_dphi[b]=(-pt[2*nLon+b]+4.0*pt[nLon+b]\
+              -3.0*pt[b])*invdphi;
+          }
+        }else if (a == nLat-1){
+          for (int b=0; b<nLon; b++){
+            dpt_dphi[b]=(3.0*pt[b]-4.0*pt[b-nLon]\
+              +pt[b-nLon])*invdphi;
+          }
+        }else{
+          for (int b=0; b<nLon; b++){
+            dpt_dphi[b]=(pt[nLon+b]-pt[b-nLon])*invdphi;
+          }
+        }
+
+      //PT WRT LAMBDA (periodic end cases)
+        dpt_dl[0]=(pt[1]-pt[nLon-1])*invdlambda;
+        dpt_dl[nLon-1]=(pt[nLon-2]-pt[0])*invdlambda;
         for (int b=1; b<(nLon-1); b++){
-          dpt_dl[p][a][b]=(PTMat[p][a][b+1]-PTMat[p][a][b-1])*invdlambda;
+          dpt_dl[b]=(pt[b+1]-pt[b-1])*invdlambda;
         }
-      }
-    }
-  coef2 = 1.0/radius;
-  //PV Calculation!
-    for (int p=0; p<nPlev; p++){
-      for (int a=0; a<nLat; a++){
+
         coef1 = 1.0/(radius*cosphi[a]);
         corvar=coriolis[a];
+        const double * __restrict rv = rvData + offset;
+        double * __restrict pv = pvData + offset;
         for (int b=0; b<nLon; b++){
-          PVMat[p][a][b] = 9.80616*(coef1*dv_dp[p][a][b]*dpt_dl[p][a][b]\
-           -coef2*du_dp[p][a][b]*dpt_dphi[p][a][b]\
-           -(corvar+RVMat[p][a][b])*dpt_dp[p][a][b]);
+          pv[b] = 9.80616*(coef1*dv_dp[b]*dpt_dl[b]\
+           -coef2*du_dp[b]*dpt_dphi[b]\
+           -(corvar+rv[b])*dpt_dp[b]);
         }
       }
     }
@@ -796,8 +803,8 @@ void IPV_calc(
        int nLat,
        int nLon,
        double lat_res,
-       DataVector<double> pVec,
-       DataMatrix3D<double> PVMat,
+       DataVectorView<double> pVec,
+       DataMatrix3DView<double> PVMat,
        DataMatrix<double> & IPVMat       
 ){
   //Integrate PV over upper troposphere
@@ -819,39 +826,226 @@ void IPV_calc(
     pos_top = temp;
   }
 
-  double PVbot;
-  double PVmid;
-  double PVtop;
+  if (!PVMat.IsContiguous()){
+    _EXCEPTIONT("IPV_calc requires contiguous input.");
+  }
 
 //Eliminate polar regions from calculations
   int i10 = std::fabs(10/lat_res);
   int i171 = std::fabs(171/lat_res);
   double modLevLen = pos_bot-pos_top;
   double invLevLen = 1.0/(2.0*modLevLen);
-//Set top/bottom 10 degrees latitude to 0 for PV
-    for (int p=0; p<nPlev; p++){
-      for (int b=0; b<nLon; b++){
-        for (int a=0; a<i10; a++){
-          PVMat[p][a][b] = 0.0;
-        }
-        for (int a=i171; a<nLat; a++){
-          PVMat[p][a][b] = 0.0;
+
+  //Calculate integration parts
+  int nPlane = nLat*nLon;
+  DataVector<double> midVec(nPlane);
+  LevelAvgPlane(PVMat.GetData(), nPlane, nPlane, pos_top, pos_bot,\
+    invLevLen, &(midVec[0]), IPVMat.GetData());
+
+  //Top/bottom 10 degrees latitude are treated as PV=0, so the
+  //integral vanishes there (input view is left untouched)
+    for (int a=0; a<nLat; a++){
+      if (a<i10 || a>=i171){
+        for (int b=0; b<nLon; b++){
+          IPVMat(a,b) = 0.0;
         }
       }
     }
+}
 
-  //Calculate integration parts
-    for (int a=0; a<nLat; a++){
-      for (int b=0; b<nLon; b++){
-        PVtop = PVMat[pos_top][a][b];
-        PVbot = PVMat[pos_bot][a][b];
-        PVmid = 0.0;
-        for (int p=(pos_top+1); p<pos_bot; p++){
-          PVmid+=2.0*PVMat[p][a][b];
+//Single pass version of PT_calc, rVort_calc, PV_calc and IPV_calc.
+//The grid is split into bands of nBandRows lat rows that are
+//processed in parallel; for each band the potential temperature of
+//the band and its two-row halo is computed into a tile buffer, and
+//the relative vorticity and the partial derivatives of each row are
+//formed in row buffers, so no full size intermediate fields are
+//allocated. The results are identical to the separate functions.
+void PV_IPV_calc(
+        int nPlev,
+        int nLat,
+        int nLon,
+        DataMatrix3DView<double> TMat,
+        DataMatrix3DView<double> UMat,
+        DataMatrix3DView<double> VMat,
+        DataVectorView<double> pVec,
+        DataVectorView<double> coriolis,
+        DataVectorView<double> cosphi,
+        double dphi,
+        double dlambda,
+        double lat_res,
+        DataMatrix3D<double> & PVMat,
+        DataMatrix<double> & IPVMat,
+        int nBandRows
+){
+  if (!TMat.IsContiguous() || !UMat.IsContiguous() || !VMat.IsContiguous()){
+    _EXCEPTIONT("PV_IPV_calc requires contiguous input.");
+  }
+  if (nLat < 3 || nPlev < 3){
+    _EXCEPTIONT("PV_IPV_calc requires at least 3 levels and 3 lat rows.");
+  }
+  if (nBandRows < 1){
+    _EXCEPTIONT("Band size must be at least 1 row.");
+  }
+
+  double radius = 6371000.0;
+  double exp = 287.0/1004.5;
+  double invdphi = 1.0/(2.0*dphi);
+  double invdlambda = 1.0/(2.0*dlambda);
+  double coef2 = 1.0/radius;
+
+  //Level factors for PT and for the vertical differences
+  DataVector<double> pFrac(nPlev);
+  DataVector<double> invdpVec(nPlev);
+  for (int p=0; p<nPlev; p++){
+    pFrac[p] = std::pow(100000.0/pVec[p], exp);
+    invdpVec[p] = 0.0;
+    if (p>0 && p<(nPlev-1)){
+      invdpVec[p] = 1.0/(2.0*std::fabs(pVec[p+1]-pVec[p]));
+    }
+  }
+  double invdp1 = 1.0/(2.0*std::fabs(pVec[1]-pVec[0]));
+  double invdp2 = 1.0/(2.0*std::fabs(pVec[nPlev-1]-pVec[nPlev-2]));
+
+  //Levels of the IPV integral (150 to 500 hPa)
+  int pos_top = -1;
+  int pos_bot = -1;
+  for (int x=0; x<nPlev; x++){
+    if (std::fabs(pVec[x]-15000.0)<0.0001){
+      pos_top = x;
+    }
+    if (std::fabs(pVec[x]-50000.0)<0.0001){
+      pos_bot = x;
+    }
+  }
+  if (pos_top < 0 || pos_bot < 0){
+    _EXCEPTIONT("Pressure axis must contain the 150 and 500 hPa levels.");
+  }
+  if (pos_top>pos_bot){
+    int temp = pos_bot;
+    pos_bot = pos_top;
+    pos_top = temp;
+  }
+  double modLevLen = pos_bot-pos_top;
+  double invLevLen = 1.0/(2.0*modLevLen);
+
+  //Top/bottom 10 degrees latitude have IPV=0
+  int i10 = std::fabs(10/lat_res);
+  int i171 = std::fabs(171/lat_res);
+
+  int nPlane = nLat*nLon;
+  const double * __restrict tData = TMat.GetData();
+  const double * __restrict uData = UMat.GetData();
+  const double * __restrict vData = VMat.GetData();
+  double * __restrict pvData = PVMat.GetData();
+  int nBands = (nLat + nBandRows - 1)/nBandRows;
+
+#pragma omp parallel
+  {
+    //Tile buffer: PT on the band rows plus a two-row halo
+    DataVector<double> ptTile(nPlev*(nBandRows+4)*nLon);
+    DataVector<double> dpt_dp(nLon);
+    DataVector<double> du_dp(nLon);
+    DataVector<double> dv_dp(nLon);
+    DataVector<double> dpt_dphi(nLon);
+    DataVector<double> dpt_dl(nLon);
+    DataVector<double> rv(nLon);
+    DataVector<double> midVec(nBandRows*nLon);
+
+#pragma omp for schedule(dynamic)
+    for (int n=0; n<nBands; n++){
+      int a0 = n*nBandRows;
+      int a1 = std::min(nLat, a0+nBandRows);
+      int h0 = std::max(0, a0-2);
+      int h1 = std::min(nLat, a1+2);
+      int nTilePlane = (h1-h0)*nLon;
+
+      //PT on the tile
+      for (int p=0; p<nPlev; p++){
+        const double * __restrict tLev = tData + (size_t)p*nPlane + (size_t)h0*nLon;
+        double * __restrict ptLev = &(ptTile[0]) + (size_t)p*nTilePlane;
+        double frac = pFrac[p];
+        for (int i=0; i<nTilePlane; i++){
+          ptLev[i] = tLev[i]*frac;
+        }
+      }
+
+      for (int p=0; p<nPlev; p++){
+        double invdp = invdpVec[p];
+        for (int a=a0; a<a1; a++){
+          size_t offset = (size_t)p*nPlane + (size_t)a*nLon;
+          const double * __restrict pt = &(ptTile[0])\
+            + (size_t)p*nTilePlane + (size_t)(a-h0)*nLon;
+          const double * __restrict u = uData + offset;
+          const double * __restrict v = vData + offset;
+
+          dpRow(pt, p, nPlev, nTilePlane, nLon, invdp1, invdp2, invdp, &(dpt_dp[0]));
+          dpRow(u, p, nPlev, nPlane, nLon, invdp1, invdp2, invdp, &(du_dp[0]));
+          dpRow(v, p, nPlev, nPlane, nLon, invdp1, invdp2, invdp, &(dv_dp[0]));
+
+        //PT WRT PHI (end cases are one-sided) and relative vorticity
+        //(set to 0 at the end rows because of the pole singularities)
+          if (a == 0){
+            for (int b=0; b<nLon; b++){
+              dpt_dphi[b]=(-pt[2*nLon+b]+4.0*pt[nLon+b]\
+                -3.0*pt[b])*invdphi;
+              rv[b] = 0.0;
+            }
+          }else if (a == nLat-1){
+            for (int b=0; b<nLon; b++){
+              dpt_dphi[b]=(3.0*pt[b]-4.0*pt[b-nLon]\
+                +pt[b-nLon])*invdphi;
+              rv[b] = 0.0;
+            }
+          }else{
+            for (int b=0; b<nLon; b++){
+              dpt_dphi[b]=(pt[nLon+b]-pt[b-nLon])*invdphi;
+            }
+            const double * __restrict uN = u + nLon;
+            const double * __restrict uS = u - nLon;
+            double cosN = cosphi[a+1];
+            double cosS = cosphi[a-1];
+            double coef = 1.0/(radius*cosphi[a]);
+            rv[0] = coef*((v[1]-v[nLon-1])*invdlambda\
+              -(uN[0]*cosN-uS[0]*cosS)*invdphi);
+            rv[nLon-1] = coef*((v[0]-v[nLon-2])*invdlambda\
+              -(uN[nLon-1]*cosN-uS[nLon-1]*cosS)*invdphi);
+            for (int b=1; b<(nLon-1); b++){
+              rv[b] = coef*((v[b+1]-v[b-1])*invdlambda\
+                -(uN[b]*cosN-uS[b]*cosS)*invdphi);
+            }
+          }
+
+        //PT WRT LAMBDA (periodic end cases)
+          dpt_dl[0]=(pt[1]-pt[nLon-1])*invdlambda;
+          dpt_dl[nLon-1]=(pt[nLon-2]-pt[0])*invdlambda;
+          for (int b=1; b<(nLon-1); b++){
+            dpt_dl[b]=(pt[b+1]-pt[b-1])*invdlambda;
+          }
+
+          double coef1 = 1.0/(radius*cosphi[a]);
+          double corvar = coriolis[a];
+          double * __restrict pv = pvData + offset;
+          for (int b=0; b<nLon; b++){
+            pv[b] = 9.80616*(coef1*dv_dp[b]*dpt_dl[b]\
+             -coef2*du_dp[b]*dpt_dphi[b]\
+             -(corvar+rv[b])*dpt_dp[b]);
+          }
+        }
+      }
+
+      //IPV of the band
+      int nBandPlane = (a1-a0)*nLon;
+      LevelAvgPlane(pvData + (size_t)a0*nLon, nBandPlane, nPlane,\
+        pos_top, pos_bot, invLevLen, &(midVec[0]), IPVMat[a0]);
+      for (int a=a0; a<a1; a++){
+        if (a<i10 || a>=i171){
+          for (int b=0; b<nLon; b++){
+            IPVMat[a][b] = 0.0;
+          }
         }
-        IPVMat[a][b] = (PVtop+PVbot+PVmid)*invLevLen;
       }
     }
+  }
 }
 
 
@@ -940,12 +1134,12 @@ void calcDevs( bool isPV,
   DataMatrix<double> devMat(nLat,nLon);
   double num = std::sin(45*pi/180);
   double denom, sineRatio;
+  TimeDecoder timeDecoder(strTimeUnits, strCalendar);
   for (int t=0; t<nTime; t++){
     inIPV->set_cur(t,0,0);
     inIPV->get(&(IPVMat[0][0]),1,nLat,nLon);
     //check if this time step is a leap day
-    ParseTimeDouble(strTimeUnits, strCalendar, timeVec[t], leapYear,\
-      leapMonth, leapDay, leapHour);
+    timeDecoder.Decode(timeVec[t], leapYear, leapMonth, leapDay, leapHour);
     if (leapMonth==2 && leapDay == 29){
       std::cout<<"Leap day! Skipping time step."<<std::endl;
     }
@@ -965,10 +1159,17 @@ void calcDevs( bool isPV,
           denom = std::fabs(std::sin(latVec[a]*pi/180.));
         }
         sineRatio = num/denom;
-        for (int b=0; b<nLon; b++){
-          devMat[a][b] = IPVMat[a][b]-avgMat[a][b];
-          if (!isPV){
-            devMat[a][b]*=sineRatio;
+        const double * __restrict ipvRow = IPVMat[a];
+        const double * __restrict avgRow = avgMat[a];
+        double * __restrict devRow = devMat[a];
+        if (isPV){
+          for (int b=0; b<nLon; b++){
+            devRow[b] = ipvRow[b]-avgRow[b];
+          }
+        }
+        else{
+          for (int b=0; b<nLon; b++){
+            devRow[b] = (ipvRow[b]-avgRow[b])*sineRatio;
           }
         }
       }
@@ -991,19 +1192,18 @@ void calcDevs( bool isPV,
     outADev->put(&(devMat[0][0]),1,nLat,nLon);
   }
  
+  int nPlane = nLat*nLon;
+  const double * __restrict devData = devMat.GetData();
+  double * __restrict aDevData = aDevMat.GetData();
   for (int t=2*nSteps; t<nOutTime; t++){  
-    for (int a=0; a<nLat; a++){
-      for (int b=0; b<nLon; b++){
-        aDevMat[a][b] = 0.0;
-      }
+    for (int i=0; i<nPlane; i++){
+      aDevData[i] = 0.0;
     }
     for (int n=0; n<2*nSteps; n++){
       outDev->set_cur(t-n,0,0);
       outDev->get(&(devMat[0][0]),1,nLat,nLon);
-      for (int a=0; a<nLat; a++){
-        for (int b=0; b<nLon; b++){
-          aDevMat[a][b]+=devMat[a][b]*invDiv;
-        }
+      for (int i=0; i<nPlane; i++){
+        aDevData[i]+=devData[i]*invDiv;
       }
     }
     outADev->set_cur(t,0,0);
@@ -1022,7 +1222,7 @@ void calcNormalizedDevs(bool isPV,
                        NcVar * inTime,
                        std::string strTimeUnits,
                        std::string strCalendar,
-                       DataMatrix3D<double>threshMat,
+                       DataMatrix3DView<double> threshMat,
                        double minThresh){
 
   int nLat,nLon,nOutTime;
@@ -1049,10 +1249,10 @@ void calcNormalizedDevs(bool isPV,
 //  int nPastStart = 0;
 //  int dPastStart = 0;
   double threshVal;
+  TimeDecoder timeDecoder(strTimeUnits, strCalendar);
   if (isPV){
     for (int t=0; t<nOutTime; t++){
-      ParseTimeDouble(strTimeUnits,strCalendar,timeVals[t],dateYear,\
-         dateMonth,dateDay,dateHour);
+      timeDecoder.Decode(timeVals[t],dateYear,dateMonth,dateDay,dateHour);
 
       threshIndex = DayInYear(dateMonth,dateDay)-1;
       inDev->set_cur(t,0,0);
@@ -1063,11 +1263,11 @@ void calcNormalizedDevs(bool isPV,
             posIntDevs[a][b] = 0;
           }
           else{
-            if (threshMat[threshIndex][a][b] < minThresh){
+            if (threshMat(threshIndex,a,b) < minThresh){
               threshVal = minThresh;
             }
             else{
-              threshVal = threshMat[threshIndex][a][b];
+              threshVal = threshMat(threshIndex,a,b);
             }
             invAnom = 1./threshVal;
             divDev = aDevMat[a][b]*invAnom;
@@ -1090,8 +1290,7 @@ void calcNormalizedDevs(bool isPV,
   }
   else{
     for (int t=0; t<nOutTime; t++){
-      ParseTimeDouble(strTimeUnits,strCalendar,timeVals[t],dateYear,\
-         dateMonth,dateDay,dateHour);
+      timeDecoder.Decode(timeVals[t],dateYear,dateMonth,dateDay,dateHour);
 
       threshIndex = DayInYear(dateMonth,dateDay)-1; 
       inDev->set_cur(t,0,0);
@@ -1102,11 +1301,11 @@ void calcNormalizedDevs(bool isPV,
              posIntDevs[a][b] = 0;
            }
            else{
-             if (threshMat[threshIndex][a][b] < minThresh){
+             if (threshMat(threshIndex,a,b) < minThresh){
                threshVal = minThresh;
              }
              else{
-               threshVal = threshMat[threshIndex][a][b];
+               threshVal = threshMat(threshIndex,a,b);
              }
              invAnom = 1./threshVal;
              pos = aDevMat[a][b]*invAnom;
@@ -1123,7 +1322,7 @@ void calcNormalizedDevs(bool isPV,
 }
 
 /*
-void stdDev(DataMatrix3D<double>inDevs,
+void stdDev(DataMatrix3DView<double> inDevs,
               int nTime,
               int nLat,
               int nLon,
@@ -1182,6 +1381,7 @@ void calcDevsGH(bool leap,
 
   std::string strTimeUnits = inTime->get_att("units")->as_string(0);
   std::string strCalendar = inTime->get_att("calendar")->as_string(0);
+  TimeDecoder timeDecoder(strTimeUnits, strCalendar);
 
   if ((strTimeUnits.length() >= 11) && \
     (strncmp(strTimeUnits.c_str(), "days since ", 11) == 0)){
@@ -1237,7 +1437,7 @@ void calcDevsGH(bool leap,
 
   for (int t=0; t<nTime; t++){
     if (leap){
-      ParseTimeDouble(strTimeUnits, strCalendar, timeVec[t], leapYear,\
+      ParseTimeDouble(timeDecoder, timeVec[t], leapYear,\
         leapMonth, leapDay, leapHour);
       if (leapMonth==2 && leapDay == 29){
         //std::cout<<"Leap day! Skipping day."<<std::endl;
@@ -16,7 +16,10 @@
 #include "DataMatrix.h"
 #include "DataMatrix3D.h"
 #include "DataMatrix4D.h"
+#include "DataView.h"
+#include "SlidingWindow.h"
 #include "TimeObj.h"
+#include "TimeDecoder.h"
 #include "Announce.h"
 
 #include <cstdlib>
@@ -54,6 +57,13 @@ bool checkFileLeap(
   double timeVal
 );
 
+//As above, with the time units and calendar already parsed
+bool checkFileLeap(
+  const TimeDecoder & timeDecoder,
+  int dateMonth,
+  double timeVal
+);
+
 //Function to get number of day in year
 //Returns an integer value in the range 1-365
 int DayInYear(int nMonth,
@@ -63,9 +73,10 @@ int DayInYear(int nMonth,
 //takes a time value (in units of hours or 
 //days since reference date) and returns 4
 //integer values: year, month, day, and hour
+//The decoder is constructed once per file from the units
+//and calendar of its time variable
 void ParseTimeDouble(
-        const std::string & strTimeUnits,
-        const std::string & strTimeCalendar,
+        const TimeDecoder & timeDecoder,
         double dTime,
         int & nDateYear,
         int & nDateMonth,
@@ -98,6 +109,7 @@ void copy_dim_var(
 //Function to interpolate variables from hybrid levels to pressure levels
 //Takes input variable and reference variables hyam,hybm and returns
 //variable with new pressure level axis (specified by pLev)
+//Levels below the surface take the lowest model level value
 void interpolate_lev(NcVar *var,
                      NcVar *hyam,
                      NcVar *hybm,
@@ -109,10 +121,12 @@ void interpolate_lev(NcVar *var,
 //Function that takes an input variable (with pressure axis as vertical)
 //and averages variable along the pressure dimension from 150-500 hPa. 
 //Returns variable with dimensions [time, lat, lon]
+//Input is read in slabs of nTimeBlock time steps
 void VarPressureAvg(
     NcVar *invar,
     NcVar * pVals,
-    NcVar * outvar
+    NcVar * outvar,
+    int nTimeBlock = 4
 );
 
 /////////////////////////////////////////////////////////
@@ -126,7 +140,7 @@ void PT_calc(
         int nPlev,
         int nLat,
         int nLon,
-        DataMatrix3D<double> TMat, 
+        DataMatrix3DView<double> TMat,
         NcVar *pLev, 
         DataMatrix3D<double> &PTMat
 );
@@ -155,11 +169,11 @@ void rVort_calc(
         int nPlev,
         int nLat,
         int nLon,
-        DataMatrix3D<double>UMat,
-        DataMatrix3D<double>VMat,
+        DataMatrix3DView<double> UMat,
+        DataMatrix3DView<double> VMat,
         double dphi,
         double dlambda,
-        DataVector<double> cosphi,
+        DataVectorView<double> cosphi,
         DataMatrix3D<double> & RVMat
 );
 
@@ -180,22 +194,20 @@ double GHcheck(double z_0,
 
 
 bool missingValCheck(
-  DataMatrix3D<double> fillData,
+  DataMatrix3DView<double> fillData,
   int nTime,
   double missingNum
 );
 
 
+//Skips the gap between two files that are not continuous in time:
+//the missing time steps are flagged as missing slots in the window
 void MissingFill(
-  double missingValue,
   double tRes,
   double contCheck,
-  int nLat,
-  int nLon,
-  int ArrLen,
   int & currArrIndex,
   int & dateIndex,
-  DataMatrix3D<double> & currFillData
+  SlidingWindowSum & window
 );
 
 //////////////////////////////////////////////////
@@ -211,13 +223,13 @@ void PV_calc(
         int nPlev,
         int nLat,
         int nLon,
-        DataMatrix3D<double>UMat,
-        DataMatrix3D<double>VMat,
-        DataMatrix3D<double> PTMat,
-        DataMatrix3D<double> RVMat,
-        DataVector<double>pVec,
-        DataVector<double> coriolis,
-        DataVector<double>cosphi,
+        DataMatrix3DView<double> UMat,
+        DataMatrix3DView<double> VMat,
+        DataMatrix3DView<double> PTMat,
+        DataMatrix3DView<double> RVMat,
+        DataVectorView<double> pVec,
+        DataVectorView<double> coriolis,
+        DataVectorView<double> cosphi,
         double dphi,
         double dlambda,
         double lat_res,
@@ -231,11 +243,32 @@ void IPV_calc(
        int nLat,
        int nLon,
        double lat_res,
-       DataVector<double> pVec,
-       DataMatrix3D<double> PVMat,
+       DataVectorView<double> pVec,
+       DataMatrix3DView<double> PVMat,
        DataMatrix<double> & IPVMat
 );
 
+//PT_calc, rVort_calc, PV_calc and IPV_calc in a single pass over
+//bands of nBandRows lat rows, threaded over the bands. Only tile
+//and row buffers are allocated; the results are identical.
+void PV_IPV_calc(
+        int nPlev,
+        int nLat,
+        int nLon,
+        DataMatrix3DView<double> TMat,
+        DataMatrix3DView<double> UMat,
+        DataMatrix3DView<double> VMat,
+        DataVectorView<double> pVec,
+        DataVectorView<double> coriolis,
+        DataVectorView<double> cosphi,
+        double dphi,
+        double dlambda,
+        double lat_res,
+        DataMatrix3D<double> & PVMat,
+        DataMatrix<double> & IPVMat,
+        int nBandRows = 8
+);
+
 ////////////////////////////////////////////////////
 //    SECTION: VARIABLE ANOMALY CALCULATIONS      //
 ////////////////////////////////////////////////////
@@ -264,9 +297,9 @@ void calcNormalizedDevs(bool isPV,
                        NcVar * inTime,
                        std::string strTimeUnits,
                        std::string strCalendar,
-                       DataMatrix3D<double>threshMat,
+                       DataMatrix3DView<double> threshMat,
                        double minThresh);
-/*void stdDev(DataMatrix3D<double>inDevs,
+/*void stdDev(DataMatrix3DView<double> inDevs,
               int nTime,
               int nLat,
               int nLon,
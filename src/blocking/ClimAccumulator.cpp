@@ -0,0 +1,368 @@
+//////////////////////////////////
+///
+///    \file ClimAccumulator.cpp
+
+#include "ClimAccumulator.h"
+#include "BlockingUtilities.h"
+#include "Exception.h"
+#include "netcdfcpp.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+
+#if defined(TEMPEST_MPIOMP)
+#include <mpi.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////
+
+ClimatologyAccumulator::ClimatologyAccumulator()
+{ }
+
+void ClimatologyAccumulator::Initialize(
+  const std::string & strTag,
+  int nDays,
+  int nLat,
+  int nLon
+){
+  m_strTag = strTag;
+  m_sum.Initialize(nDays, nLat, nLon);
+  m_sumsq.Initialize(nDays, nLat, nLon);
+  m_counts.Initialize(nDays, nLat, nLon);
+  m_vecFiles.clear();
+  m_setFiles.clear();
+}
+
+void ClimatologyAccumulator::Read(
+  const std::string & strFile
+){
+  NcFile statein(strFile.c_str());
+  if (!statein.is_valid()){
+    _EXCEPTION1("Unable to open state file %s for reading", strFile.c_str());
+  }
+  NcDim *dayDim = statein.get_dim("day");
+  NcDim *latDim = statein.get_dim("lat");
+  NcDim *lonDim = statein.get_dim("lon");
+  if ((dayDim == NULL) || (latDim == NULL) || (lonDim == NULL)){
+    _EXCEPTION1("State file %s is missing day/lat/lon dimensions",
+      strFile.c_str());
+  }
+  int nDays = dayDim->size();
+  int nLat = latDim->size();
+  int nLon = lonDim->size();
+
+  NcAtt *attTag = statein.get_att("tag");
+  if (attTag == NULL){
+    _EXCEPTION1("State file %s has no tag attribute", strFile.c_str());
+  }
+  std::string strTag = attTag->as_string(0);
+
+  if (IsInitialized()){
+    if (strTag != m_strTag){
+      _EXCEPTION3("State file %s was written for \"%s\", expected \"%s\"",
+        strFile.c_str(), strTag.c_str(), m_strTag.c_str());
+    }
+    if (((int)m_sum.GetSize(0) != nDays)
+     || ((int)m_sum.GetSize(1) != nLat)
+     || ((int)m_sum.GetSize(2) != nLon)){
+      _EXCEPTION1("State file %s does not match the input grid",
+        strFile.c_str());
+    }
+  }
+  Initialize(strTag, nDays, nLat, nLon);
+
+  const char *szVarNames[3] = {"sum", "sumsq", "counts"};
+  DataMatrix3D<double> *pMats[3] = {&m_sum, &m_sumsq, &m_counts};
+  for (int v=0; v<3; v++){
+    NcVar *stateVar = statein.get_var(szVarNames[v]);
+    if (stateVar == NULL){
+      _EXCEPTION2("State file %s has no variable %s",
+        strFile.c_str(), szVarNames[v]);
+    }
+    stateVar->set_cur(0,0,0);
+    stateVar->get(pMats[v]->GetData(), nDays, nLat, nLon);
+  }
+
+  NcAtt *attFiles = statein.get_att("files");
+  if (attFiles != NULL){
+    std::istringstream issFiles(attFiles->as_string(0));
+    std::string strLine;
+    while (std::getline(issFiles, strLine)){
+      if (strLine != ""){
+        AddFile(strLine);
+      }
+    }
+  }
+  statein.close();
+}
+
+bool ClimatologyAccumulator::ReadIfExists(
+  const std::string & strFile
+){
+  std::ifstream ifState(strFile.c_str());
+  if (!ifState.good()){
+    return false;
+  }
+  ifState.close();
+  Read(strFile);
+  return true;
+}
+
+void ClimatologyAccumulator::Write(
+  const std::string & strFile
+) const {
+  if (!IsInitialized()){
+    _EXCEPTIONT("Attempted to write an uninitialized accumulator.");
+  }
+  int nDays = m_sum.GetSize(0);
+  int nLat = m_sum.GetSize(1);
+  int nLon = m_sum.GetSize(2);
+
+  std::string strTempFile = strFile + ".tmp";
+  NcFile stateout(strTempFile.c_str(), NcFile::Replace, NULL, 0,
+    NcFile::Offset64Bits);
+  if (!stateout.is_valid()){
+    _EXCEPTION1("Unable to open state file %s for writing",
+      strTempFile.c_str());
+  }
+  NcDim *dayDim = stateout.add_dim("day", nDays);
+  NcDim *latDim = stateout.add_dim("lat", nLat);
+  NcDim *lonDim = stateout.add_dim("lon", nLon);
+
+  stateout.add_att("tag", m_strTag.c_str());
+  if (m_vecFiles.size() > 0){
+    std::string strFiles;
+    for (int f=0; f<m_vecFiles.size(); f++){
+      strFiles += m_vecFiles[f];
+      strFiles += "\n";
+    }
+    stateout.add_att("files", strFiles.c_str());
+  }
+
+  const char *szVarNames[3] = {"sum", "sumsq", "counts"};
+  const DataMatrix3D<double> *pMats[3] = {&m_sum, &m_sumsq, &m_counts};
+  for (int v=0; v<3; v++){
+    NcVar *stateVar = stateout.add_var(szVarNames[v], ncDouble,
+      dayDim, latDim, lonDim);
+    stateVar->set_cur(0,0,0);
+    stateVar->put(pMats[v]->GetData(), nDays, nLat, nLon);
+  }
+  stateout.close();
+
+  if (std::rename(strTempFile.c_str(), strFile.c_str()) != 0){
+    _EXCEPTION2("Unable to rename %s to %s",
+      strTempFile.c_str(), strFile.c_str());
+  }
+}
+
+void ClimatologyAccumulator::Merge(
+  const ClimatologyAccumulator & other
+){
+  if (!other.IsInitialized()){
+    return;
+  }
+  if (!IsInitialized()){
+    Initialize(other.m_strTag, other.m_sum.GetSize(0),
+      other.m_sum.GetSize(1), other.m_sum.GetSize(2));
+  }
+  if (other.m_strTag != m_strTag){
+    _EXCEPTION2("Cannot merge accumulators for \"%s\" and \"%s\"",
+      m_strTag.c_str(), other.m_strTag.c_str());
+  }
+  if ((m_sum.GetSize(0) != other.m_sum.GetSize(0))
+   || (m_sum.GetSize(1) != other.m_sum.GetSize(1))
+   || (m_sum.GetSize(2) != other.m_sum.GetSize(2))){
+    _EXCEPTIONT("Cannot merge accumulators on different grids.");
+  }
+  for (int f=0; f<other.m_vecFiles.size(); f++){
+    if (HasFile(other.m_vecFiles[f])){
+      _EXCEPTION1("File %s was added to both accumulators",
+        other.m_vecFiles[f].c_str());
+    }
+  }
+
+  int nTotal = m_sum.GetTotalElements();
+  double *sum = m_sum.GetData();
+  double *sumsq = m_sumsq.GetData();
+  double *counts = m_counts.GetData();
+  const double *otherSum = other.m_sum.GetData();
+  const double *otherSumSq = other.m_sumsq.GetData();
+  const double *otherCounts = other.m_counts.GetData();
+  for (int i=0; i<nTotal; i++){
+    sum[i] += otherSum[i];
+    sumsq[i] += otherSumSq[i];
+    counts[i] += otherCounts[i];
+  }
+  for (int f=0; f<other.m_vecFiles.size(); f++){
+    AddFile(other.m_vecFiles[f]);
+  }
+}
+
+void ClimatologyAccumulator::MergeFileList(
+  const std::vector<std::string> & vecStateFiles
+){
+  for (int s=0; s<vecStateFiles.size(); s++){
+    ClimatologyAccumulator partial;
+    if (IsInitialized()){
+      partial.Initialize(m_strTag, m_sum.GetSize(0),
+        m_sum.GetSize(1), m_sum.GetSize(2));
+    }
+    partial.Read(vecStateFiles[s]);
+    Merge(partial);
+  }
+}
+
+void ClimatologyAccumulator::AddSlice(
+  int iDay,
+  const double * data
+){
+  int nPlane = m_sum.GetSize(1) * m_sum.GetSize(2);
+  double *sum = m_sum.GetRow(iDay,0);
+  double *sumsq = m_sumsq.GetRow(iDay,0);
+  double *counts = m_counts.GetRow(iDay,0);
+  for (int i=0; i<nPlane; i++){
+    sum[i] += data[i];
+    sumsq[i] += data[i]*data[i];
+    counts[i] += 1.;
+  }
+}
+
+void ClimatologyAccumulator::AddSlices(
+  const int * piDays,
+  int nSlices,
+  const double * data
+){
+  int nLat = m_sum.GetSize(1);
+  int nLon = m_sum.GetSize(2);
+  int nPlane = nLat * nLon;
+
+  //Each thread owns whole latitude rows of every day, so slices
+  //that fall on the same day never conflict
+#pragma omp parallel for schedule(static)
+  for (int a=0; a<nLat; a++){
+    for (int t=0; t<nSlices; t++){
+      int iDay = piDays[t];
+      if (iDay < 0){
+        continue;
+      }
+      const double *in = data + t*nPlane + a*nLon;
+      double *sum = m_sum.GetRow(iDay,a);
+      double *sumsq = m_sumsq.GetRow(iDay,a);
+      double *counts = m_counts.GetRow(iDay,a);
+      for (int b=0; b<nLon; b++){
+        sum[b] += in[b];
+        sumsq[b] += in[b]*in[b];
+        counts[b] += 1.;
+      }
+    }
+  }
+}
+
+void ClimatologyAccumulator::AddVariable(
+  NcVar * inputVar,
+  NcVar * timeVar,
+  const DataMatrix3D<double> * dataMean,
+  int nTimeBlock
+){
+  int nLat = m_sum.GetSize(1);
+  int nLon = m_sum.GetSize(2);
+  int nPlane = nLat * nLon;
+  if ((inputVar->num_dims() != 3)
+   || (inputVar->get_dim(1)->size() != nLat)
+   || (inputVar->get_dim(2)->size() != nLon)){
+    _EXCEPTION1("Variable %s does not match the accumulator grid",
+      inputVar->name());
+  }
+  int tLen = inputVar->get_dim(0)->size();
+
+  //Time and calendar
+  DataVector<double> timeVec(tLen);
+  timeVar->set_cur((long)0);
+  timeVar->get(&(timeVec[0]),tLen);
+
+  NcAtt *attTime = timeVar->get_att("units");
+  if (attTime==NULL){
+    _EXCEPTIONT("Time variable has no units attribute.");
+  }
+  std::string strTimeUnits = attTime->as_string(0);
+  std::string strCalendar;
+  NcAtt *attCal = timeVar->get_att("calendar");
+  if (attCal==NULL){
+    strCalendar = "standard";
+  }else{
+    strCalendar = attCal->as_string(0);
+  }
+  if (strncmp(strCalendar.c_str(),"gregorian",9)==0){
+    strCalendar = "standard";
+  }
+
+  //Day index of each time step (-1 for leap days)
+  TimeDecoder timeDecoder(strTimeUnits, strCalendar);
+  std::vector<TimeDecoder::Date> vecDates;
+  timeDecoder.DecodeVector(&(timeVec[0]), tLen, vecDates);
+
+  std::vector<int> vecDays(tLen);
+  for (int t=0; t<tLen; t++){
+    bool leap = checkFileLeap(timeDecoder, vecDates[t].nMonth, timeVec[t]);
+    vecDays[t] = leap ? -1 : (DayInYear(vecDates[t].nMonth, vecDates[t].nDay)-1);
+  }
+
+  //Read and add the data in blocks of time steps
+  DataMatrix3D<double> inputBlock;
+  for (int t0=0; t0<tLen; t0+=nTimeBlock){
+    int nBlock = std::min(nTimeBlock, tLen-t0);
+    inputBlock.Initialize(nBlock, nLat, nLon, false);
+    inputVar->set_cur(t0,0,0);
+    inputVar->get(inputBlock.GetData(),nBlock,nLat,nLon);
+
+    if (dataMean != NULL){
+#pragma omp parallel for schedule(static)
+      for (int t=0; t<nBlock; t++){
+        if (vecDays[t0+t] < 0){
+          continue;
+        }
+        double *in = inputBlock.GetRow(t,0);
+        const double *mean = dataMean->GetRow(vecDays[t0+t],0);
+        for (int i=0; i<nPlane; i++){
+          in[i] -= mean[i];
+        }
+      }
+    }
+    AddSlices(&(vecDays[t0]), nBlock, inputBlock.GetData());
+  }
+}
+
+void ClimatologyAccumulator::ClearSums(){
+  m_sum.Zero();
+  m_sumsq.Zero();
+  m_counts.Zero();
+}
+
+void ClimatologyAccumulator::Allreduce(){
+#if defined(TEMPEST_MPIOMP)
+  //Pack all three arrays so that a single reduction is needed
+  int nTotal = m_sum.GetTotalElements();
+  std::vector<double> vecPacked(3*nTotal);
+  memcpy(&(vecPacked[0]), m_sum.GetData(), nTotal*sizeof(double));
+  memcpy(&(vecPacked[nTotal]), m_sumsq.GetData(), nTotal*sizeof(double));
+  memcpy(&(vecPacked[2*nTotal]), m_counts.GetData(), nTotal*sizeof(double));
+
+  MPI_Allreduce(MPI_IN_PLACE, &(vecPacked[0]), 3*nTotal,
+    MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+  memcpy(m_sum.GetData(), &(vecPacked[0]), nTotal*sizeof(double));
+  memcpy(m_sumsq.GetData(), &(vecPacked[nTotal]), nTotal*sizeof(double));
+  memcpy(m_counts.GetData(), &(vecPacked[2*nTotal]), nTotal*sizeof(double));
+#endif
+}
+
+void ClimatologyAccumulator::AddFile(
+  const std::string & strFile
+){
+  if (m_setFiles.insert(strFile).second){
+    m_vecFiles.push_back(strFile);
+  }
+}
@@ -0,0 +1,160 @@
+//////////////////////////////////
+///
+///    \file ClimAccumulator.h
+
+#ifndef _CLIMACCUMULATOR_H_
+#define _CLIMACCUMULATOR_H_
+
+/////////////////////////////////
+#include "DataMatrix3D.h"
+#include "netcdfcpp.h"
+
+#include <string>
+#include <vector>
+#include <set>
+
+//Day-of-year (day, lat, lon) accumulator of sums, sums of squares
+//and counts, together with the list of input files that have been
+//added to it. The state can be written to and read back from a
+//NetCDF file, so that a long run over a file list can be resumed,
+//new files can be added to an existing climatology, and partial
+//accumulators computed in parallel can be merged.
+//
+//The tag identifies the tool and options that produced the state
+//(e.g. "BlockingDFT:Z500"); states with different tags or grids
+//cannot be combined.
+class ClimatologyAccumulator {
+
+public:
+  ClimatologyAccumulator();
+
+  //Allocate an empty accumulator
+  void Initialize(
+    const std::string & strTag,
+    int nDays,
+    int nLat,
+    int nLon
+  );
+
+  //Read a state file. If the accumulator is already initialized,
+  //the grid and tag of the file must match.
+  void Read(
+    const std::string & strFile
+  );
+
+  //Read a state file if it exists; returns true if it was read
+  bool ReadIfExists(
+    const std::string & strFile
+  );
+
+  //Write the state file. The state is written to a temporary
+  //file first and then renamed, so an interrupted write never
+  //leaves a truncated state behind.
+  void Write(
+    const std::string & strFile
+  ) const;
+
+  //Add the sums, counts and files of another accumulator
+  void Merge(
+    const ClimatologyAccumulator & other
+  );
+
+  //Read each state file in the list and merge it into this one
+  void MergeFileList(
+    const std::vector<std::string> & vecStateFiles
+  );
+
+  //Add a contiguous (lat, lon) slice on day iDay: the sum, the sum
+  //of squares and the count of each cell are incremented
+  void AddSlice(
+    int iDay,
+    const double * data
+  );
+
+  //Add nSlices contiguous (lat, lon) slices; slice t is added on
+  //day piDays[t], or skipped if piDays[t] is negative.
+  //Runs in parallel over latitude rows.
+  void AddSlices(
+    const int * piDays,
+    int nSlices,
+    const double * data
+  );
+
+  //Add all time slices of a (time, lat, lon) variable, each on its
+  //day of the year (leap days are skipped). Slices are read
+  //nTimeBlock at a time. If dataMean is given, the (day, lat, lon)
+  //mean of the day is subtracted before adding, so the sums of
+  //squares hold the squared deviations from the mean.
+  void AddVariable(
+    NcVar * inputVar,
+    NcVar * timeVar,
+    const DataMatrix3D<double> * dataMean = NULL,
+    int nTimeBlock = 32
+  );
+
+  //Zero the sums, sums of squares and counts (the file list is kept)
+  void ClearSums();
+
+  //Sum the sums, sums of squares and counts over all MPI ranks,
+  //so that each rank holds the total. Each rank must have added a
+  //disjoint set of files. No-op without MPI.
+  void Allreduce();
+
+  //True if the input file has already been added
+  bool HasFile(
+    const std::string & strFile
+  ) const {
+    return (m_setFiles.find(strFile) != m_setFiles.end());
+  }
+
+  //Record that an input file has been added
+  void AddFile(
+    const std::string & strFile
+  );
+
+  //Number of input files added so far
+  int GetFileCount() const {
+    return (int)(m_vecFiles.size());
+  }
+
+  bool IsInitialized() const {
+    return m_sum.IsInitialized();
+  }
+
+  const std::string & GetTag() const {
+    return m_strTag;
+  }
+
+  //Sums, sums of squares and counts (day, lat, lon)
+  DataMatrix3D<double> & GetSum() {
+    return m_sum;
+  }
+  const DataMatrix3D<double> & GetSum() const {
+    return m_sum;
+  }
+  DataMatrix3D<double> & GetSumSq() {
+    return m_sumsq;
+  }
+  const DataMatrix3D<double> & GetSumSq() const {
+    return m_sumsq;
+  }
+  DataMatrix3D<double> & GetCounts() {
+    return m_counts;
+  }
+  const DataMatrix3D<double> & GetCounts() const {
+    return m_counts;
+  }
+
+protected:
+  std::string m_strTag;
+
+  DataMatrix3D<double> m_sum;
+  DataMatrix3D<double> m_sumsq;
+  DataMatrix3D<double> m_counts;
+
+  //Input files in the order they were added
+  std::vector<std::string> m_vecFiles;
+  std::set<std::string> m_setFiles;
+};
+
+#endif
@@ -14,18 +14,33 @@ This is a discrete Fourier transform function that will perform
 #include <cmath>
 #include <complex>
 #include <vector>
+#include <cstddef>
 //#include "/Users/mariellep/tempestextremes/src/base/DataVector.h"
 //#include "/Users/mariellep/tempestextremes/src/base/Exception.h"
 #include "DFT.h"
 //#include "DataVector.h"
 #include "Exception.h"
 
-std::vector<std::complex<double> > DFT(std::vector<double> inputVals,
-         int numCoefs
-         ){
+//Twiddle factors cos(2*pi*m/N) and sin(2*pi*m/N), m=0..N-1.
+//Products k*n are reduced modulo N to index the tables.
+static void TwiddleTables(
+  int N,
+  std::vector<double> & vecCos,
+  std::vector<double> & vecSin
+){
   double pi = std::atan(1.0)*4.0;
-  std::complex <double> compi(0.,1.);
+  vecCos.resize(N);
+  vecSin.resize(N);
+  for (int m=0; m<N; m++){
+    double theta = 2.*pi*double(m)/double(N);
+    vecCos[m] = std::cos(theta);
+    vecSin[m] = std::sin(theta);
+  }
+}
 
+std::vector<std::complex<double> > DFT(const std::vector<double> & inputVals,
+         int numCoefs
+         ){
   int N = inputVals.size();
 
   if (numCoefs > N){
@@ -35,81 +50,203 @@ std::vector<std::complex<double> > DFT(std::vector<double> inputVals,
   //Declare the output array for the Fourier coefficients
   std::vector <std::complex<double> > FourierCoefs(N);
 
-  //Couple of values for calculations
-  double Ndiv = 1./N;
-  std::complex <double> expCoef(0.,0.);
-  std::complex <double> sumVals;
+  std::vector<double> vecCos, vecSin;
+  TwiddleTables(N, vecCos, vecSin);
+
+  //Only the lowest positive and negative wavenumbers are
+  //calculated; the higher wavenumbers are left at 0
   int firstHalfNum = numCoefs/2;
   int secHalfNum = numCoefs-firstHalfNum;
- 
-  //Begin calculating the coefficients
+  std::vector<int> vecK;
   if (numCoefs<N){
     for (int k=0; k<=secHalfNum; k++){
-      double fk = float(k);
-      expCoef = -2.*compi*pi*fk*Ndiv;
-      sumVals = std::complex<double>(0.,0.);
-      for (int n=0; n<N; n++){
-        double fn = float(n);
-        sumVals += inputVals[n]*std::exp(fn*expCoef);
-      }
-      FourierCoefs[k] = sumVals;
+      vecK.push_back(k);
     }
     for (int k=(N-firstHalfNum); k<N; k++){
-      double fk = float(k);
-      expCoef = -2.*compi*pi*fk*Ndiv;
-      sumVals = std::complex<double>(0.,0.);
-      for (int n=0; n<N; n++){
-        double fn = float(n);
-        sumVals += inputVals[n]*std::exp(fn*expCoef);
-      }
-      FourierCoefs[k] = sumVals;
+      vecK.push_back(k);
     }
   }
   else{
     for (int k=0; k<N; k++){
-      double fk = float(k);
-      expCoef = -2.*compi*pi*fk*Ndiv;
-      sumVals = std::complex<double>(0.,0.);
-      for (int n=0; n<N; n++){
-        double fn = float(n);
-        sumVals += inputVals[n]*std::exp(fn*expCoef);
-      }
-      FourierCoefs[k] = sumVals;
+      vecK.push_back(k);
     }
   }
-/*  if (numCoefs<N){
-    //Zero out the higher wavenumbers
-    for (int i=numCoefs; i<(N-numCoefs); i++){
-      FourierCoefs[i] = std::complex<double>(0.,0.);
+
+  //Begin calculating the coefficients
+  for (size_t i=0; i<vecK.size(); i++){
+    int k = vecK[i];
+    double sumRe = 0.;
+    double sumIm = 0.;
+    int m = 0;
+    for (int n=0; n<N; n++){
+      sumRe += inputVals[n]*vecCos[m];
+      sumIm -= inputVals[n]*vecSin[m];
+      m += k;
+      if (m >= N){
+        m -= N;
+      }
     }
-  }*/
+    FourierCoefs[k] = std::complex<double>(sumRe, sumIm);
+  }
   return(FourierCoefs);
 }
 
-std::vector <double> IDFT(std::vector<std::complex<double> > FFTvals){
-  double pi = std::atan(1.)*4.;
-  std::complex <double> compi(0.,1.);
-
+std::vector <double> IDFT(const std::vector<std::complex<double> > & FFTvals){
   int N = FFTvals.size();
-  //Create an output data vector (only the real part will be returned)
-  std::vector <std::complex<double> > outputs(N);
   double Ndiv = 1./N;
-  std::complex <double> expCoef(0.,0.);
-  std::complex <double> sumVals;
 
+  std::vector<double> vecCos, vecSin;
+  TwiddleTables(N, vecCos, vecSin);
+
+  //Only the real part of the inverse transform is returned;
+  //zero coefficients are skipped
+  std::vector<double> realOutputs(N, 0.);
+  for (int n=0; n<N; n++){
+    double re = FFTvals[n].real();
+    double im = FFTvals[n].imag();
+    if (re == 0. && im == 0.){
+      continue;
+    }
+    int m = 0;
+    for (int k=0; k<N; k++){
+      realOutputs[k] += re*vecCos[m] - im*vecSin[m];
+      m += n;
+      if (m >= N){
+        m -= N;
+      }
+    }
+  }
   for (int k=0; k<N; k++){
-    double fk = float(k);
-    expCoef = 2.*compi*pi*fk*Ndiv;
-    sumVals = std::complex<double>(0.,0.);
+    realOutputs[k] *= Ndiv;
+  }
+  return(realOutputs);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+HarmonicFilter::HarmonicFilter(int N, int numCoefs) :
+  m_nLength(N),
+  m_nHarmonics(0),
+  m_fIdentity(false)
+{
+  if (N < 1){
+    _EXCEPTIONT("Series length must be positive.");
+  }
+  if (numCoefs > N){
+    _EXCEPTIONT("Number of specified coefficients exceeds length of input vector.");
+  }
+  if (numCoefs < 0){
+    _EXCEPTIONT("Number of coefficients must be non-negative.");
+  }
+
+  //Retaining all coefficients reproduces the input
+  if (numCoefs == N){
+    m_fIdentity = true;
+    return;
+  }
+
+  TwiddleTables(N, m_vecCos, m_vecSin);
+
+  //Same coefficient selection as DFT(): wavenumbers 0..secHalfNum
+  //and -firstHalfNum..-1. For real input the negative wavenumber
+  //is the conjugate of the positive one, so it doubles the weight.
+  int firstHalfNum = numCoefs/2;
+  int secHalfNum = numCoefs-firstHalfNum;
+  m_nHarmonics = secHalfNum+1;
+  m_vecWeight.resize(m_nHarmonics);
+  m_vecWeight[0] = 1.;
+  for (int j=1; j<m_nHarmonics; j++){
+    m_vecWeight[j] = 1.;
+    if (j<=firstHalfNum && 2*j != N){
+      m_vecWeight[j] = 2.;
+    }
+  }
+}
+
+void HarmonicFilter::Apply(
+  const double * inputVals,
+  std::ptrdiff_t inStride,
+  double * outputVals,
+  std::ptrdiff_t outStride
+) const {
+  ApplyBatch(inputVals, 1, 0, inStride, outputVals, 0, outStride);
+}
+
+void HarmonicFilter::ApplyBatch(
+  const double * inputVals,
+  int nSeries,
+  std::ptrdiff_t inSeriesStride,
+  std::ptrdiff_t inStride,
+  double * outputVals,
+  std::ptrdiff_t outSeriesStride,
+  std::ptrdiff_t outStride
+) const {
+  int N = m_nLength;
+
+  if (m_fIdentity){
     for (int n=0; n<N; n++){
-      double fn = float(n);
-      sumVals += FFTvals[n]*std::exp(fn*expCoef);
+      for (int s=0; s<nSeries; s++){
+        outputVals[s*outSeriesStride + n*outStride] =
+          inputVals[s*inSeriesStride + n*inStride];
+      }
     }
-    outputs[k] = sumVals*Ndiv;
+    return;
   }
-  std::vector<double> realOutputs(N);
-  for (int i=0; i<N; i++){
-    realOutputs[i] = outputs[i].real();
+
+  //Cosine and sine projections of each series onto each harmonic
+  std::vector<double> vecA(m_nHarmonics*nSeries, 0.);
+  std::vector<double> vecB(m_nHarmonics*nSeries, 0.);
+
+  for (int n=0; n<N; n++){
+    const double * x = inputVals + n*inStride;
+    int m = 0;
+    for (int j=0; j<m_nHarmonics; j++){
+      double c = m_vecCos[m];
+      double sn = m_vecSin[m];
+      double * __restrict a = &(vecA[j*nSeries]);
+      double * __restrict b = &(vecB[j*nSeries]);
+      for (int s=0; s<nSeries; s++){
+        double val = x[s*inSeriesStride];
+        a[s] += val*c;
+        b[s] += val*sn;
+      }
+      m += n;
+      if (m >= N){
+        m -= N;
+      }
+    }
+  }
+
+  //Reconstruct from the retained harmonics
+  double Ndiv = 1./N;
+  for (int j=0; j<m_nHarmonics; j++){
+    double w = m_vecWeight[j]*Ndiv;
+    double * __restrict a = &(vecA[j*nSeries]);
+    double * __restrict b = &(vecB[j*nSeries]);
+    for (int s=0; s<nSeries; s++){
+      a[s] *= w;
+      b[s] *= w;
+    }
+  }
+  for (int n=0; n<N; n++){
+    double * y = outputVals + n*outStride;
+    const double * __restrict a0 = &(vecA[0]);
+    for (int s=0; s<nSeries; s++){
+      y[s*outSeriesStride] = a0[s];
+    }
+    int m = n;
+    for (int j=1; j<m_nHarmonics; j++){
+      double c = m_vecCos[m];
+      double sn = m_vecSin[m];
+      const double * __restrict a = &(vecA[j*nSeries]);
+      const double * __restrict b = &(vecB[j*nSeries]);
+      for (int s=0; s<nSeries; s++){
+        y[s*outSeriesStride] += a[s]*c + b[s]*sn;
+      }
+      m += n;
+      if (m >= N){
+        m -= N;
+      }
+    }
   }
-  return(realOutputs);
 }
@@ -11,6 +11,7 @@
 
 #include <cstdlib>
 #include <cmath>
+#include <cstddef>
 #include <complex>
 #include <vector>
 //#include "/Users/mariellep/tempestextremes/src/base/DataVector.h"
@@ -18,10 +19,65 @@
 //#include "DataVector.h"
 #include "Exception.h"
 
-std::vector<std::complex<double> > DFT(std::vector<double> inputVals,
+std::vector<std::complex<double> > DFT(const std::vector<double> & inputVals,
          int numCoefs
 );
 
-std::vector <double> IDFT(std::vector<std::complex<double> > FFTvals);
+std::vector <double> IDFT(const std::vector<std::complex<double> > & FFTvals);
+
+//Low-order harmonic smoothing of real series of length N.
+//Equivalent to IDFT(DFT(x,numCoefs)), but only the retained
+//harmonics are projected and summed, using precomputed
+//twiddle tables: O(N*numCoefs) per series instead of O(N^2).
+class HarmonicFilter {
+
+public:
+  HarmonicFilter(int N, int numCoefs);
+
+  //Length of the series
+  int GetLength() const {
+    return m_nLength;
+  }
+
+  //Smooth a single series (strides are in elements)
+  void Apply(
+    const double * inputVals,
+    std::ptrdiff_t inStride,
+    double * outputVals,
+    std::ptrdiff_t outStride
+  ) const;
+
+  //Smooth nSeries series at once. Element n of series s is
+  //inputVals[s*inSeriesStride + n*inStride] (same for the output).
+  //The innermost loops run over the series, so batches of
+  //contiguous series vectorize.
+  void ApplyBatch(
+    const double * inputVals,
+    int nSeries,
+    std::ptrdiff_t inSeriesStride,
+    std::ptrdiff_t inStride,
+    double * outputVals,
+    std::ptrdiff_t outSeriesStride,
+    std::ptrdiff_t outStride
+  ) const;
+
+protected:
+  //Series length
+  int m_nLength;
+
+  //Number of retained harmonics (including the mean)
+  int m_nHarmonics;
+
+  //True if all N coefficients are retained (identity)
+  bool m_fIdentity;
+
+  //cos(2*pi*m/N) and sin(2*pi*m/N), m=0..N-1
+  std::vector<double> m_vecCos;
+  std::vector<double> m_vecSin;
+
+  //Weight of each retained harmonic in the reconstruction
+  //(2 if both the positive and negative frequency are kept)
+  std::vector<double> m_vecWeight;
+};
 
 #endif
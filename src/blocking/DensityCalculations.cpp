@@ -15,6 +15,7 @@
 #include "CommandLine.h"
 #include "Exception.h"
 #include "BlockingUtilities.h"
+#include "ClimAccumulator.h"
 
 #include <cstdlib>
 #include <cmath>
@@ -63,7 +64,7 @@ void densCalc(NcVar * inVar,
   //outVar->put((&outMat[0][0]),latLen,lonLen);
 }
 
-void yearlyStdDev(DataMatrix3D<double> inMat,
+void yearlyStdDev(const DataMatrix3D<double> & inMat,
                  int nTime,
                  int nLat,
                  int nLon,
@@ -101,6 +102,9 @@ int main(int argc, char ** argv){
     std::string outFile;
     std::string varName;
     std::string inList;
+    std::string stateFile;
+    std::string mergeList;
+    int nCheckpoint;
 //    bool calcStdDev;
 
     BeginCommandLine()
@@ -108,6 +112,9 @@ int main(int argc, char ** argv){
       CommandLineString(inList, "inlist","");
       CommandLineString(varName, "var", "");
       CommandLineString(outFile, "out", "");
+      CommandLineString(stateFile, "state", "");
+      CommandLineString(mergeList, "mergestates", "");
+      CommandLineInt(nCheckpoint, "checkpoint", 1);
   //    CommandLineBool(calcStdDev, "std");
       ParseCommandLine(argc, argv);
     EndCommandLine(argv)
@@ -147,11 +154,24 @@ int main(int argc, char ** argv){
     lonLen = lon->size();
     NcVar * lonVar = readin.get_var("lon");
 
-    //read input variable
-    NcVar * inVar = readin.get_var(varName.c_str());
+    //Per-file densities are summed in a single-day accumulator,
+    //resumed from the state file and merged with any partial states
+    ClimatologyAccumulator accum;
+    accum.Initialize("DensityCalculations:" + varName, 1, latLen, lonLen);
+    if (stateFile != ""){
+      if (accum.ReadIfExists(stateFile)){
+        std::cout<<"Resuming from "<<stateFile<<" ("<<accum.GetFileCount()\
+          <<" files)"<<std::endl;
+      }
+    }
+    if (mergeList != ""){
+      std::vector<std::string> vecStateFiles;
+      GetInputFileList(mergeList,vecStateFiles);
+      accum.MergeFileList(vecStateFiles);
+    }
+
     //Create output matrix
     DataMatrix<double> outMat(latLen,lonLen);
-    densCalc(inVar,outMat);
     //Option for calculating the yearly standard deviation 
  /*   if (calcStdDev){
       for (int a=0; a<latLen; a++){
@@ -161,19 +181,23 @@ int main(int argc, char ** argv){
       }
     }
 */
-    //If multiple files, add these values to the output
-    if (vecFiles.size()>1){
-      DataMatrix<double> addMat(latLen,lonLen);
-      std::cout<<"There are "<<vecFiles.size()<<" files."<<std::endl;
-      for (int v=1; v<vecFiles.size(); v++){
-        NcFile addread(vecFiles[v].c_str());
-        NcVar * inVar = addread.get_var(varName.c_str());
-        densCalc(inVar,addMat);
-        for (int a=0; a<latLen; a++){
-          for (int b=0; b<lonLen; b++){
-            outMat[a][b]+=addMat[a][b];
-          }
-        }
+    //Add the density of each file to the accumulator
+    DataMatrix<double> addMat(latLen,lonLen);
+    std::cout<<"There are "<<vecFiles.size()<<" files."<<std::endl;
+    int nAdded = 0;
+    for (int v=0; v<vecFiles.size(); v++){
+      if (accum.HasFile(vecFiles[v])){
+        std::cout<<"Already accumulated "<<vecFiles[v]<<std::endl;
+        continue;
+      }
+      NcFile addread(vecFiles[v].c_str());
+      if (!addread.is_valid()){
+        _EXCEPTION1("Unable to open file %s for reading",\
+          vecFiles[v].c_str());
+      }
+      NcVar * inVar = addread.get_var(varName.c_str());
+      densCalc(inVar,addMat);
+      accum.AddSlice(0, addMat.GetData());
 /*        if (calcStdDev){
           for (int a=0; a<latLen; a++){
             for (int b=0; b<lonLen; b++){
@@ -181,13 +205,27 @@ int main(int argc, char ** argv){
             }
           }
         }*/
-        addread.close(); 
+      addread.close(); 
+
+      //Checkpoint the accumulated state
+      accum.AddFile(vecFiles[v]);
+      nAdded++;
+      if (stateFile != "" && nCheckpoint > 0 && nAdded % nCheckpoint == 0){
+        accum.Write(stateFile);
       }
-      //Divide output by number of files
-      double div = 1./((double) vecFiles.size());
-      for (int a=0; a<latLen; a++){
-        for (int b=0; b<lonLen; b++){
-          outMat[a][b]*=div;
+    }
+    if (stateFile != ""){
+      accum.Write(stateFile);
+    }
+
+    //Divide output by number of files
+    const DataMatrix3D<double> & sumMat = accum.GetSum();
+    const DataMatrix3D<double> & countsMat = accum.GetCounts();
+    for (int a=0; a<latLen; a++){
+      for (int b=0; b<lonLen; b++){
+        if (countsMat[0][a][b] > 0.){
+          double div = 1./countsMat[0][a][b];
+          outMat[a][b] = sumMat[0][a][b]*div;
         }
       }
     }
@@ -6,6 +6,7 @@
 
 #include "Interp_z500.h"
 #include "BlockingUtilities.h"
+#include "VerticalInterp.h"
 #include "NetCDFUtilities.h"
 #include "netcdfcpp.h"
 #include "DataVector.h"
@@ -26,7 +27,6 @@ void interp_1lev(NcVar *var,
 ){
 
   int nTime,nLev,nLat,nLon;
-  double A1,A2,B1,B2,p1,p2,weight;
 
   //Array dimensions
   nTime = var->get_dim(0)->size();
@@ -34,19 +34,6 @@ void interp_1lev(NcVar *var,
   nLat = var->get_dim(2)->size();
   nLon = var->get_dim(3)->size();
 
- //Matrix to store PS
-  DataMatrix3D <double> matPS(nTime, nLat, nLon);
-  ps->set_cur(0, 0, 0);
-  ps->get(&(matPS[0][0][0]), nTime, nLat, nLon);
-
-  //Matrix to store input variable data
-  DataMatrix4D<double> matVar(nTime, nLev, nLat, nLon);
-  var->set_cur(0, 0, 0, 0);
-  var->get(&(matVar[0][0][0][0]), nTime, nLev, nLat, nLon);
-
-  //Matrix to store output variable data
-  DataMatrix3D<double> matVarOut(nTime, nLat, nLon);
-
   //hybrid coefficient A
   DataVector<double> vecHyam(nLev);
   hyam->set_cur((long) 0);
@@ -57,30 +44,32 @@ void interp_1lev(NcVar *var,
   hybm->set_cur((long) 0);
   hybm->get(&(vecHybm[0]), nLev);
 
+  DataVector<double> vecPlev(1);
+  vecPlev[0] = plev;
+
+  VerticalInterpolator interp;
+  interp.InitializeHybrid(vecHyam, vecHybm, 100000.0, vecPlev);
+
+  //Matrices to store PS and input/output variable data
+  //for one time step
+  DataMatrix<double> matPS(nLat, nLon);
+  DataMatrix3D<double> matVar(nLev, nLat, nLon);
+  DataMatrix3D<double> matVarOut(1, nLat, nLon);
+
   //Loop over input data and interpolate to output var
   for (int t=0; t<nTime; t++){
-    for (int l=0; l<(nLev-1); l++){
-      A1 = vecHyam[l];
-      B1 = vecHybm[l];
-      A2 = vecHyam[l+1];
-      B2 = vecHybm[l+1];
-      for (int a=0; a<nLat; a++){
-        for (int b=0; b<nLon; b++){
-          p1 = 100000.0 * A1 + matPS[t][a][b] * B1;
-          p2 = 100000.0 * A2 + matPS[t][a][b] * B2;
-          if (p1<plev && p2>=plev){
-              weight = ((plev-p1)/(p2-p1));
-              matVarOut[t][a][b] = weight*matVar[t][l+1][a][b]
-                               + (1.0-weight)*matVar[t][l][a][b];
-          }
-        }
-      }
-    }
+    ps->set_cur(t, 0, 0);
+    ps->get(matPS.GetData(), 1, nLat, nLon);
+    var->set_cur(t, 0, 0, 0);
+    var->get(matVar.GetData(), 1, nLev, nLat, nLon);
+
+    interp.Interpolate(matPS, matVar, matVarOut);
+
+    NewVar->set_cur(t, 0, 0);
+    NewVar->put(matVarOut.GetData(), 1, nLat, nLon);
   }
   std::cout<<"Finished interpolating variable.\n";
 
-  NewVar->set_cur(0, 0, 0);
-  NewVar->put(&(matVarOut[0][0][0]), nTime, nLat, nLon);
   CopyNcVarAttributes(var, NewVar);
 }
 
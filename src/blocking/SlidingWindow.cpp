@@ -0,0 +1,104 @@
+//////////////////////////////////
+///
+///    \file SlidingWindow.cpp
+
+#include "SlidingWindow.h"
+#include "Exception.h"
+
+#include <cstring>
+
+////////////////////////////////////////////////////////////////////////
+
+SlidingWindowSum::SlidingWindowSum() :
+  m_nSlots(0),
+  m_nPlane(0),
+  m_dMissingValue(0.0),
+  m_nMissing(0)
+{ }
+
+void SlidingWindowSum::Initialize(
+  int nSlots,
+  int nLat,
+  int nLon,
+  double dMissingValue
+){
+  if (nSlots < 1){
+    _EXCEPTIONT("Sliding window needs at least one slot.");
+  }
+  m_nSlots = nSlots;
+  m_nPlane = nLat*nLon;
+  m_dMissingValue = dMissingValue;
+  m_data.Initialize(nSlots, nLat, nLon);
+  m_sum.Initialize(nLat, nLon);
+  m_fMissing.assign(nSlots, false);
+  m_nMissing = 0;
+}
+
+void SlidingWindowSum::SetSlot(
+  int i,
+  const double * data
+){
+  if ((i < 0) || (i >= m_nSlots)){
+    _EXCEPTION2("Slot %i out of range (window has %i slots)", i, m_nSlots);
+  }
+  double * slot = m_data.GetRow(i,0);
+  double * sum = m_sum.GetData();
+  if (m_fMissing[i]){
+    for (int k=0; k<m_nPlane; k++){
+      sum[k] += data[k];
+    }
+    m_fMissing[i] = false;
+    m_nMissing--;
+  }else{
+    for (int k=0; k<m_nPlane; k++){
+      sum[k] += (data[k] - slot[k]);
+    }
+  }
+  memcpy(slot, data, m_nPlane*sizeof(double));
+}
+
+void SlidingWindowSum::SetSlotMissing(
+  int i
+){
+  if ((i < 0) || (i >= m_nSlots)){
+    _EXCEPTION2("Slot %i out of range (window has %i slots)", i, m_nSlots);
+  }
+  double * slot = m_data.GetRow(i,0);
+  if (!m_fMissing[i]){
+    double * sum = m_sum.GetData();
+    for (int k=0; k<m_nPlane; k++){
+      sum[k] -= slot[k];
+    }
+    m_fMissing[i] = true;
+    m_nMissing++;
+  }
+  for (int k=0; k<m_nPlane; k++){
+    slot[k] = m_dMissingValue;
+  }
+}
+
+void SlidingWindowSum::Resum(){
+  double * sum = m_sum.GetData();
+  for (int k=0; k<m_nPlane; k++){
+    sum[k] = 0.0;
+  }
+  for (int t=0; t<m_nSlots; t++){
+    if (m_fMissing[t]){
+      continue;
+    }
+    const double * slot = m_data.GetRow(t,0);
+    for (int k=0; k<m_nPlane; k++){
+      sum[k] += slot[k];
+    }
+  }
+}
+
+void SlidingWindowSum::AddSumTo(
+  double * out
+) const {
+  const double * sum = m_sum.GetData();
+  double dMissingSum = m_nMissing * m_dMissingValue;
+  for (int k=0; k<m_nPlane; k++){
+    out[k] += (sum[k] + dMissingSum);
+  }
+}
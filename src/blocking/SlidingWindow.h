@@ -0,0 +1,89 @@
+//////////////////////////////////
+///
+///    \file SlidingWindow.h
+
+#ifndef _SLIDINGWINDOW_H_
+#define _SLIDINGWINDOW_H_
+
+/////////////////////////////////
+#include "DataMatrix.h"
+#include "DataMatrix3D.h"
+
+#include <vector>
+
+//Ring buffer of (lat, lon) slices with a running sum over all slots.
+//Replacing a slot adds the new slice and subtracts the old one, so
+//the sum over the window costs O(nLat*nLon) per slice instead of
+//O(nSlots*nLat*nLon).
+//Slots can be flagged as missing (gap in the file list or an
+//incomplete day); missing slots hold the missing value but are
+//excluded from the running sum and counted separately.
+class SlidingWindowSum {
+
+public:
+  SlidingWindowSum();
+
+  //Allocate nSlots slices of size (nLat, nLon), all zero
+  void Initialize(
+    int nSlots,
+    int nLat,
+    int nLon,
+    double dMissingValue
+  );
+
+  //Number of slots in the window
+  int GetSlotCount() const {
+    return m_nSlots;
+  }
+
+  //Number of slots currently flagged as missing
+  int GetMissingCount() const {
+    return m_nMissing;
+  }
+
+  //Replace slot i with a contiguous (lat, lon) slice
+  void SetSlot(
+    int i,
+    const double * data
+  );
+
+  //Replace slot i with the missing value
+  void SetSlotMissing(
+    int i
+  );
+
+  //Recompute the running sum from the stored slices, in slot
+  //order, to drop accumulated rounding error
+  void Resum();
+
+  //Add the sum over all slots to a contiguous (lat, lon) slice.
+  //Missing slots contribute the missing value, as if all slots
+  //had been summed directly.
+  void AddSumTo(
+    double * out
+  ) const;
+
+  //Stored slices (slot, lat, lon)
+  const DataMatrix3D<double> & GetData() const {
+    return m_data;
+  }
+
+protected:
+  int m_nSlots;
+  int m_nPlane;
+
+  //Value stored in missing slots
+  double m_dMissingValue;
+
+  //Stored slices
+  DataMatrix3D<double> m_data;
+
+  //Sum over the non-missing slots
+  DataMatrix<double> m_sum;
+
+  //Missing flag of each slot and number of missing slots
+  std::vector<bool> m_fMissing;
+  int m_nMissing;
+};
+
+#endif
@@ -16,6 +16,7 @@ only along the lev axis)*/
 #include "DataMatrix4D.h"
 #include "BlockingUtilities.h"
 #include "Interpolate.h"
+#include "VerticalInterp.h"
 
 #include <cstdlib>
 #include <cmath>
@@ -109,7 +110,7 @@ int main(int argc, char** argv){
     if (is_hPa){
       pval = 500.0;
     }
-    int pIndex;
+    int pIndex = -1;
     for (int x=0; x<nLev; x++){
       if (std::fabs(pVec[x]-pval)<0.0001){
         pIndex = x;
@@ -118,6 +119,16 @@ int main(int argc, char** argv){
     }
     std::cout<<"pIndex: "<<pIndex<<std::endl;
 
+    //If 500 mb is not on the level axis, interpolate linearly
+    //in pressure between the neighboring levels
+    VerticalInterpolator interp;
+    if (pIndex < 0){
+      std::cout<<"500 mb level not found; interpolating."<<std::endl;
+      DataVector<double> vecTarget(1);
+      vecTarget[0] = pval;
+      interp.InitializePressure(pVec, vecTarget);
+    }
+
     //Open output file
     NcFile file_out(fileOut.c_str(),NcFile::Replace,NULL,0,NcFile::Offset64Bits);
 
@@ -156,10 +167,23 @@ int main(int argc, char** argv){
       NcVar *vvar = readin.get_var(varVec[v].c_str());
       NcVar *outvar = file_out.add_var(varVec[v].c_str(),ncDouble,out_time,out_lat,out_lon);
       DataMatrix<double> VData(nLat, nLon);
+      DataMatrix3D<double> VColumns;
+      DataMatrix3D<double> VInterp;
+      if (pIndex < 0){
+        VColumns.Initialize(nLev, nLat, nLon);
+      }
 
       for (int t=0; t<nTime; t++){
-        vvar->set_cur(t,pIndex,0,0);
-        vvar->get(&(VData[0][0]),1,1,nLat,nLon);
+        if (pIndex >= 0){
+          vvar->set_cur(t,pIndex,0,0);
+          vvar->get(&(VData[0][0]),1,1,nLat,nLon);
+        }
+        else{
+          vvar->set_cur(t,0,0,0);
+          vvar->get(VColumns.GetData(),1,nLev,nLat,nLon);
+          interp.Interpolate(DataMatrixView<double>(), VColumns, VInterp);
+          memcpy(VData.GetData(), VInterp.GetData(), nLat*nLon*sizeof(double));
+        }
         if (varVec[v]=="Z" && ZtoGH){
           for (int a=0; a<nLat; a++){
             for (int b=0; b<nLon; b++){
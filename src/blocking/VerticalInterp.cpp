@@ -0,0 +1,188 @@
+//////////////////////////////////
+///
+///    \file VerticalInterp.cpp
+
+#include "VerticalInterp.h"
+#include "Exception.h"
+
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////
+
+//Orders target level indices by increasing pressure
+struct TargetLevelLess {
+  const std::vector<double> & vecLev;
+  TargetLevelLess(const std::vector<double> & lev) : vecLev(lev) { }
+  bool operator()(int i, int j) const {
+    return (vecLev[i] < vecLev[j]);
+  }
+};
+
+VerticalInterpolator::VerticalInterpolator() :
+  m_eFillMode(FillNearest),
+  m_dFillValue(0.0)
+{ }
+
+void VerticalInterpolator::InitializeHybrid(
+  DataVectorView<double> vecHyam,
+  DataVectorView<double> vecHybm,
+  double dRefPressure,
+  DataVectorView<double> vecTargetLev
+){
+  int nLev = vecHyam.GetRows();
+  if (nLev < 2){
+    _EXCEPTIONT("At least two model levels are needed to interpolate.");
+  }
+  if ((int)vecHybm.GetRows() != nLev){
+    _EXCEPTIONT("hyam and hybm must have the same length.");
+  }
+  m_vecLevA.resize(nLev);
+  m_vecLevB.resize(nLev);
+  for (int l=0; l<nLev; l++){
+    m_vecLevA[l] = dRefPressure * vecHyam[l];
+    m_vecLevB[l] = vecHybm[l];
+  }
+  InitializeTargets(vecTargetLev);
+}
+
+void VerticalInterpolator::InitializePressure(
+  DataVectorView<double> vecLev,
+  DataVectorView<double> vecTargetLev
+){
+  int nLev = vecLev.GetRows();
+  if (nLev < 2){
+    _EXCEPTIONT("At least two model levels are needed to interpolate.");
+  }
+  m_vecLevA.resize(nLev);
+  m_vecLevB.clear();
+  for (int l=0; l<nLev; l++){
+    m_vecLevA[l] = vecLev[l];
+  }
+  InitializeTargets(vecTargetLev);
+}
+
+void VerticalInterpolator::InitializeTargets(
+  DataVectorView<double> vecTargetLev
+){
+  int nTarget = vecTargetLev.GetRows();
+  m_vecTargetLev.resize(nTarget);
+  m_vecTargetOrder.resize(nTarget);
+  for (int p=0; p<nTarget; p++){
+    m_vecTargetLev[p] = vecTargetLev[p];
+    m_vecTargetOrder[p] = p;
+  }
+  std::stable_sort(m_vecTargetOrder.begin(), m_vecTargetOrder.end(),
+    TargetLevelLess(m_vecTargetLev));
+}
+
+void VerticalInterpolator::SetFill(
+  FillMode eFillMode,
+  double dFillValue
+){
+  m_eFillMode = eFillMode;
+  m_dFillValue = dFillValue;
+}
+
+void VerticalInterpolator::CheckInput(
+  DataMatrixView<double> dataPS,
+  DataMatrix3DView<double> dataVar
+) const {
+  int nLev = m_vecLevA.size();
+  bool fHybrid = !m_vecLevB.empty();
+
+  if ((int)dataVar.GetRows() != nLev){
+    _EXCEPTION2("Variable has %i levels, expected %i",
+      dataVar.GetRows(), nLev);
+  }
+  if (fHybrid && (dataPS.GetRows() != dataVar.GetColumns()
+    || dataPS.GetColumns() != dataVar.GetSubColumns())){
+    _EXCEPTIONT("Surface pressure and variable grids do not match.");
+  }
+}
+
+void VerticalInterpolator::Interpolate(
+  DataMatrixView<double> dataPS,
+  DataMatrix3DView<double> dataVar,
+  DataMatrix3D<double> & dataOut
+) const {
+  //Validate before the parallel loop, since exceptions cannot
+  //leave an OpenMP region
+  CheckInput(dataPS, dataVar);
+
+  int nLat = dataVar.GetColumns();
+  int nLon = dataVar.GetSubColumns();
+  dataOut.Initialize(m_vecTargetLev.size(), nLat, nLon, false);
+
+#pragma omp parallel for schedule(dynamic)
+  for (int a=0; a<nLat; a++){
+    InterpolateRows(dataPS, dataVar, a, a+1, dataOut);
+  }
+}
+
+void VerticalInterpolator::InterpolateRows(
+  DataMatrixView<double> dataPS,
+  DataMatrix3DView<double> dataVar,
+  int iBegin,
+  int iEnd,
+  DataMatrix3D<double> & dataOut
+) const {
+  int nLev = m_vecLevA.size();
+  int nTarget = m_vecTargetLev.size();
+  int nLon = dataVar.GetSubColumns();
+  bool fHybrid = !m_vecLevB.empty();
+
+  //Column pressures and level indices in increasing pressure order
+  std::vector<double> vecColP(nLev);
+  std::vector<int> vecColLev(nLev);
+
+  for (int a=iBegin; a<iEnd; a++){
+    for (int b=0; b<nLon; b++){
+      if (fHybrid){
+        double dPS = dataPS(a,b);
+        for (int l=0; l<nLev; l++){
+          vecColP[l] = m_vecLevA[l] + dPS * m_vecLevB[l];
+        }
+      }else{
+        for (int l=0; l<nLev; l++){
+          vecColP[l] = m_vecLevA[l];
+        }
+      }
+      bool fAscending = (vecColP[nLev-1] >= vecColP[0]);
+      for (int k=0; k<nLev; k++){
+        vecColLev[k] = fAscending ? k : (nLev-1-k);
+      }
+      double dTopP = vecColP[vecColLev[0]];
+      double dBotP = vecColP[vecColLev[nLev-1]];
+
+      //Targets are visited in increasing pressure, so the bracket
+      //index k only moves down the column
+      int k = 0;
+      for (int i=0; i<nTarget; i++){
+        int p = m_vecTargetOrder[i];
+        double dP = m_vecTargetLev[p];
+        if (dP <= dTopP || dP > dBotP){
+          if (m_eFillMode == FillConstant){
+            dataOut(p,a,b) = m_dFillValue;
+          }else if (dP <= dTopP){
+            dataOut(p,a,b) = dataVar(vecColLev[0],a,b);
+          }else{
+            dataOut(p,a,b) = dataVar(vecColLev[nLev-1],a,b);
+          }
+          continue;
+        }
+        while (vecColP[vecColLev[k+1]] < dP){
+          k++;
+        }
+        int l1 = vecColLev[k];
+        int l2 = vecColLev[k+1];
+        double p1 = vecColP[l1];
+        double p2 = vecColP[l2];
+        double weight = ((dP-p1)/(p2-p1));
+        dataOut(p,a,b) = weight*dataVar(l2,a,b)
+                         + (1.0-weight)*dataVar(l1,a,b);
+      }
+    }
+  }
+}
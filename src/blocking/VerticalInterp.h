@@ -0,0 +1,114 @@
+//////////////////////////////////
+///
+///    \file VerticalInterp.h
+
+#ifndef _VERTICALINTERP_H_
+#define _VERTICALINTERP_H_
+
+/////////////////////////////////
+#include "DataVector.h"
+#include "DataMatrix.h"
+#include "DataMatrix3D.h"
+#include "DataView.h"
+
+#include <vector>
+
+//Linear interpolation of (lev, lat, lon) fields from model levels
+//(hybrid or pressure) onto a set of target pressure levels.
+//Per column, the level pressures are computed once and the brackets
+//of all target levels are found in a single monotone sweep.
+//Target levels outside of the column (above the model top or below
+//the surface) are filled according to the fill mode.
+class VerticalInterpolator {
+
+public:
+  //Fill for target levels outside the model column
+  enum FillMode {
+    //Use the value at the nearest model level (surface or top)
+    FillNearest,
+    //Use a constant fill value
+    FillConstant
+  };
+
+public:
+  VerticalInterpolator();
+
+  //Hybrid levels: p(l) = refPressure*hyam(l) + PS*hybm(l)
+  void InitializeHybrid(
+    DataVectorView<double> vecHyam,
+    DataVectorView<double> vecHybm,
+    double dRefPressure,
+    DataVectorView<double> vecTargetLev
+  );
+
+  //Fixed pressure levels (ascending or descending); PS is not used
+  void InitializePressure(
+    DataVectorView<double> vecLev,
+    DataVectorView<double> vecTargetLev
+  );
+
+  //Set the fill for target levels outside the model column
+  void SetFill(
+    FillMode eFillMode,
+    double dFillValue = 0.0
+  );
+
+  //Number of target levels
+  int GetTargetLevelCount() const {
+    return (int)(m_vecTargetLev.size());
+  }
+
+  //Check that dataVar has the model levels of this interpolator and
+  //that dataPS (for hybrid levels) has the same grid; throws if not
+  void CheckInput(
+    DataMatrixView<double> dataPS,
+    DataMatrix3DView<double> dataVar
+  ) const;
+
+  //Interpolate one time slice. dataPS is (lat, lon) and may be
+  //empty for pressure levels; dataVar is (lev, lat, lon) and
+  //dataOut is resized to (target lev, lat, lon).
+  //Runs in parallel over latitude rows.
+  void Interpolate(
+    DataMatrixView<double> dataPS,
+    DataMatrix3DView<double> dataVar,
+    DataMatrix3D<double> & dataOut
+  ) const;
+
+  //Interpolate latitude rows [iBegin, iEnd) of one time slice
+  //(dataOut must already have the right size). The input must have
+  //been validated with CheckInput, since this does not throw and is
+  //safe to call concurrently on disjoint row ranges.
+  void InterpolateRows(
+    DataMatrixView<double> dataPS,
+    DataMatrix3DView<double> dataVar,
+    int iBegin,
+    int iEnd,
+    DataMatrix3D<double> & dataOut
+  ) const;
+
+protected:
+  //Sort the target levels by pressure
+  void InitializeTargets(
+    DataVectorView<double> vecTargetLev
+  );
+
+protected:
+  //Pressure contribution independent of PS (refPressure*hyam)
+  std::vector<double> m_vecLevA;
+
+  //Coefficient of PS (hybm); empty for pressure levels
+  std::vector<double> m_vecLevB;
+
+  //Target pressure levels
+  std::vector<double> m_vecTargetLev;
+
+  //Indices of the target levels in increasing pressure order
+  std::vector<int> m_vecTargetOrder;
+
+  //Fill mode and value outside the model column
+  FillMode m_eFillMode;
+  double m_dFillValue;
+};
+
+#endif
@@ -157,6 +157,7 @@ int main(int argc, char ** argv ){
   std::string strTimeUnits = attTime->as_string(0);
   NcAtt *attCal = timeVar->get_att("calendar");
   std::string strCalendar = attCal ->as_string(0);
+  TimeDecoder timeDecoder(strTimeUnits, strCalendar);
 
   int dateYear = 0;
   int dateMonth = 0;
@@ -166,8 +167,7 @@ int main(int argc, char ** argv ){
   int monthStartIndex = 0;
 
   for (int t=0; t<nTime; t++){
-    ParseTimeDouble(strTimeUnits,strCalendar,timeVec[t],\
-      dateYear,dateMonth,dateDay,dateHour);
+    timeDecoder.Decode(timeVec[t], dateYear, dateMonth, dateDay, dateHour);
     if (dateDay == 1 && dateHour == 0){
       monthStartIndex = t;
       std::cout<< "found month start index at t="<<t<<std::endl;
@@ -189,8 +189,7 @@ int main(int argc, char ** argv ){
   int day2=1;
   int hour2=0;
 
-  ParseTimeDouble(strTimeUnits,strCalendar,timeVec[0],\
-    year1,month1,day1,hour1);
+  timeDecoder.Decode(timeVec[0], year1, month1, day1, hour1);
 
   if (month1==12){
     year2=year1+1;
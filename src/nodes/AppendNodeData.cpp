@@ -20,60 +20,66 @@
 
 #include "DataVector.h"
 #include "DataMatrix.h"
+#include "SimpleGrid.h"
+#include "Variable.h"
 
 #include "netcdfcpp.h"
 #include "NetCDFUtilities.h"
 
+#include "NodeFileUtilities.h"
+
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
 #include <cmath>
 #include <vector>
-#include <queue>
 #include <set>
+#include <string>
+#include <algorithm>
 
 ///////////////////////////////////////////////////////////////////////////////
 
 ///	<summary>
-///		Load in the contents of a text file containing one filename per
-///		line and store in a vector of strings.
+///		A node read from the input file, together with the values that
+///		will be appended to it.
 ///	</summary>
-void GetFileList(
-	const std::string & strFileList,
-	std::vector<std::string> & vecFiles
-) {
-	FILE * fp = fopen(strFileList.c_str(), "r");
+struct NodeDataPoint {
+
+	///	<summary>
+	///		Input line (without end-of-line character).
+	///	</summary>
+	std::string strLine;
+
+	///	<summary>
+	///		Time, latitude and longitude index.
+	///	</summary>
+	int iTime;
+	int iLat;
+	int iLon;
+
+	///	<summary>
+	///		Sampled values.
+	///	</summary>
+	std::vector<float> vecValues;
+};
 
-	char szBuffer[1024];
-	for (;;) {
-		fgets(szBuffer, 1024, fp);
-
-		if (feof(fp)) {
-			break;
-		}
+///	<summary>
+///		Comparator for sorting node indices by time.
+///	</summary>
+struct NodeDataPointTimeLess {
 
-		// Remove end-of-line characters
-		for (;;) {
-			int nLen = strlen(szBuffer);
-			if ((szBuffer[nLen-1] == '\n') ||
-				(szBuffer[nLen-1] == '\r') ||
-				(szBuffer[nLen-1] == ' ')
-			) {
-				szBuffer[nLen-1] = '\0';
-				continue;
-			}
-			break;
-		}
+	const std::vector<NodeDataPoint> & m_vecNodes;
 
-		vecFiles.push_back(szBuffer);
-	}
+	NodeDataPointTimeLess(
+		const std::vector<NodeDataPoint> & vecNodes
+	) :
+		m_vecNodes(vecNodes)
+	{ }
 
-	if (vecFiles.size() == 0) {
-		_EXCEPTION1("No files found in file \"%s\"", strFileList.c_str());
+	bool operator()(int a, int b) const {
+		return (m_vecNodes[a].iTime < m_vecNodes[b].iTime);
 	}
-
-	fclose(fp);
-}
+};
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -111,123 +117,475 @@ void GetTimeIndices(
 ///////////////////////////////////////////////////////////////////////////////
 
 ///	<summary>
-///		Find the maximum value of a field near the given point.
+///		A class storing a sampling operator.
+///	</summary>
+class SampleOp {
+
+public:
+	///	<summary>
+	///		Possible operations.
+	///	</summary>
+	enum Operation {
+		Max,
+		Min,
+		Mean,
+		Profile,
+		Percentile
+	};
+
+public:
+	///	<summary>
+	///		Parse a sampling operator string.
+	///	</summary>
+	void Parse(
+		VariableRegistry & varreg,
+		const std::string & strOp
+	) {
+		// Read mode
+		enum {
+			ReadMode_Op,
+			ReadMode_Distance,
+			ReadMode_Argument,
+			ReadMode_Invalid
+		} eReadMode = ReadMode_Op;
+
+		// Get variable information
+		Variable var;
+		int iLast = var.ParseFromString(varreg, strOp) + 1;
+		m_varix = varreg.FindOrRegister(var);
+
+		m_nBins = 1;
+		m_dPercentile = 0.0;
+
+		// Loop through string
+		for (int i = iLast; i <= strOp.length(); i++) {
+
+			// Comma-delineated
+			if ((i == strOp.length()) || (strOp[i] == ',')) {
+
+				std::string strSubStr =
+					strOp.substr(iLast, i - iLast);
+
+				// Read in operation
+				if (eReadMode == ReadMode_Op) {
+					if (strSubStr == "max") {
+						m_eOp = Max;
+					} else if (strSubStr == "min") {
+						m_eOp = Min;
+					} else if ((strSubStr == "mean") || (strSubStr == "avg")) {
+						m_eOp = Mean;
+					} else if (strSubStr == "profile") {
+						m_eOp = Profile;
+					} else if (strSubStr == "pctl") {
+						m_eOp = Percentile;
+					} else {
+						_EXCEPTION1("Sample invalid operation \"%s\"",
+							strSubStr.c_str());
+					}
+
+					iLast = i + 1;
+					eReadMode = ReadMode_Distance;
+
+				// Read in distance
+				} else if (eReadMode == ReadMode_Distance) {
+					m_dDistance = atof(strSubStr.c_str());
+
+					iLast = i + 1;
+					if ((m_eOp == Profile) || (m_eOp == Percentile)) {
+						eReadMode = ReadMode_Argument;
+					} else {
+						eReadMode = ReadMode_Invalid;
+					}
+
+				// Read in number of bins or percentile
+				} else if (eReadMode == ReadMode_Argument) {
+					if (m_eOp == Profile) {
+						m_nBins = atoi(strSubStr.c_str());
+					} else {
+						m_dPercentile = atof(strSubStr.c_str());
+					}
+
+					iLast = i + 1;
+					eReadMode = ReadMode_Invalid;
+
+				// Invalid
+				} else if (eReadMode == ReadMode_Invalid) {
+					_EXCEPTION1("\nToo many entries in sample op \"%s\""
+							"\nRequired: \"<name>,<operation>,<distance>"
+							"[,<bins|percentile>]\"",
+							strOp.c_str());
+				}
+			}
+		}
+
+		if (eReadMode != ReadMode_Invalid) {
+			_EXCEPTION1("\nInsufficient entries in sample op \"%s\""
+					"\nRequired: \"<name>,<operation>,<distance>"
+					"[,<bins|percentile>]\"",
+					strOp.c_str());
+		}
+
+		if ((m_dDistance < 0.0) || (m_dDistance > 180.0)) {
+			_EXCEPTIONT("For sample op, distance must be in the range [0,180]");
+		}
+		if (m_nBins < 1) {
+			_EXCEPTIONT("For profile sample op, number of bins must be positive");
+		}
+		if ((m_dPercentile < 0.0) || (m_dPercentile > 100.0)) {
+			_EXCEPTIONT("For pctl sample op, percentile must be in the range [0,100]");
+		}
+
+		// Output announcement
+		std::string strDescription;
+
+		char szBuffer[128];
+
+		if (m_eOp == Max) {
+			strDescription += "Maximum of ";
+		} else if (m_eOp == Min) {
+			strDescription += "Minimum of ";
+		} else if (m_eOp == Mean) {
+			strDescription += "Area-weighted mean of ";
+		} else if (m_eOp == Profile) {
+			snprintf(szBuffer, sizeof(szBuffer),
+				"Radial profile (%i bins) of ", m_nBins);
+			strDescription += szBuffer;
+		} else if (m_eOp == Percentile) {
+			snprintf(szBuffer, sizeof(szBuffer),
+				"%g percentile of ", m_dPercentile);
+			strDescription += szBuffer;
+		}
+
+		strDescription += var.ToString(varreg);
+
+		snprintf(szBuffer, sizeof(szBuffer),
+			" within %f degrees", m_dDistance);
+		strDescription += szBuffer;
+
+		Announce("%s", strDescription.c_str());
+	}
+
+	///	<summary>
+	///		Number of values written by this operator.
+	///	</summary>
+	int GetOutputCount() const {
+		if (m_eOp == Profile) {
+			return m_nBins;
+		}
+		return 1;
+	}
+
+public:
+	///	<summary>
+	///		Variable to sample.
+	///	</summary>
+	VariableIndex m_varix;
+
+	///	<summary>
+	///		Operation.
+	///	</summary>
+	Operation m_eOp;
+
+	///	<summary>
+	///		Distance to use when applying operation (in degrees).
+	///	</summary>
+	double m_dDistance;
+
+	///	<summary>
+	///		Number of bins in the radial profile.
+	///	</summary>
+	int m_nBins;
+
+	///	<summary>
+	///		Percentile (in the range [0,100]).
+	///	</summary>
+	double m_dPercentile;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Tolerance (in degrees) on the sampling distance, so that points at
+///		exactly the sampling distance are included at every longitude.
+///	</summary>
+static const double SampleDistanceTolerance = 1.0e-9;
+
+///	<summary>
+///		A grid point within the sampling radius of a node.
+///	</summary>
+struct StencilPoint {
+
+	///	<summary>
+	///		Latitude index of the point.
+	///	</summary>
+	int iLat;
+
+	///	<summary>
+	///		Longitude offset of the point from the node, in [0,nLon).
+	///	</summary>
+	int iLonOffset;
+
+	///	<summary>
+	///		Great circle distance from the node (in degrees).
+	///	</summary>
+	double dDist;
+
+	///	<summary>
+	///		Area weight of the point.
+	///	</summary>
+	double dWeight;
+};
+
+///	<summary>
+///		All grid points within the sampling radius of a node.
+///	</summary>
+typedef std::vector<StencilPoint> SamplingStencil;
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Great circle distance (in degrees) between two points.
+///	</summary>
+inline double GreatCircleDistanceDeg(
+	double dLat0,
+	double dLon0,
+	double dLat1,
+	double dLon1
+) {
+	double dR =
+		sin(dLat0) * sin(dLat1)
+		+ cos(dLat0) * cos(dLat1) * cos(dLon1 - dLon0);
+
+	if (dR >= 1.0) {
+		dR = 0.0;
+	} else if (dR <= -1.0) {
+		dR = 180.0;
+	} else {
+		dR = 180.0 / M_PI * acos(dR);
+	}
+	if (dR != dR) {
+		_EXCEPTIONT("NaN value detected");
+	}
+	return dR;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Build the stencil of all grid points within dMaxDist of a node on
+///		latitude row iLat.  Longitudes must be equally spaced, so that the
+///		stencil of a row is the same for every longitude.
 ///	</summary>
 ///	<param name="dMaxDist">
-///		Maximum distance from the initial point in degrees.
+///		Maximum distance from the node in degrees.
 ///	</param>
-void FindLocalAverage(
-	const DataMatrix<float> & data,
+void BuildSamplingStencil(
 	const DataVector<double> & dataLat,
 	const DataVector<double> & dataLon,
 	int iLat,
-	int iLon,
 	double dMaxDist,
-	float & dAverage,
-	float & dMaxValue
+	SamplingStencil & stencil
 ) {
-	// Verify that dMaxDist is less than 180.0
-	if (dMaxDist > 180.0) {
-		_EXCEPTIONT("MaxDist must be less than 180.0");
-	}
-
-	// Number of latitudes and longitudes
 	const int nLat = dataLat.GetRows();
 	const int nLon = dataLon.GetRows();
 
-	// Queue of nodes that remain to be visited
-	std::queue< std::pair<int, int> > queueNodes;
-	queueNodes.push( std::pair<int, int>(iLat, iLon) );
+	stencil.clear();
 
-	// Set of nodes that have already been visited
-	std::set< std::pair<int, int> > setNodesVisited;
-
-	// Latitude and longitude at the origin
 	double dLat0 = dataLat[iLat];
-	double dLon0 = dataLon[iLon];
-
-	// Sum
-	float dSum = 0.0f;
-	float dArea = 0.0f;
+	double dLon0 = dataLon[0];
 
-	// Reset average
-	dAverage = 0.0f;
+	for (int j = 0; j < nLat; j++) {
 
-	// Reset maximum value
-	dMaxValue = data[iLat][iLon];
+		// The great circle distance is at least the latitude difference
+		if (180.0 / M_PI * fabs(dataLat[j] - dLat0)
+		    > dMaxDist + SampleDistanceTolerance
+		) {
+			continue;
+		}
 
-	// Loop through all latlon elements
-	while (queueNodes.size() != 0) {
-		std::pair<int, int> pr = queueNodes.front();
-		queueNodes.pop();
+		StencilPoint pt;
+		pt.iLat = j;
+		pt.dWeight = cos(dataLat[j]);
+
+		// Distance increases away from the node in each direction, so
+		// extend eastward and then westward until out of range
+		int iEast = (-1);
+		for (int i = 0; i < nLon; i++) {
+			pt.dDist =
+				GreatCircleDistanceDeg(dLat0, dLon0, dataLat[j], dataLon[i]);
+			if (pt.dDist > dMaxDist + SampleDistanceTolerance) {
+				break;
+			}
+			pt.iLonOffset = i;
+			stencil.push_back(pt);
+			iEast = i;
+		}
 
-		if (setNodesVisited.find(pr) != setNodesVisited.end()) {
-			continue;
+		for (int i = nLon-1; i > iEast; i--) {
+			pt.dDist =
+				GreatCircleDistanceDeg(dLat0, dLon0, dataLat[j], dataLon[i]);
+			if (pt.dDist > dMaxDist + SampleDistanceTolerance) {
+				break;
+			}
+			pt.iLonOffset = i;
+			stencil.push_back(pt);
 		}
+	}
+}
 
-		setNodesVisited.insert(pr);
+///////////////////////////////////////////////////////////////////////////////
 
-		double dLatThis = dataLat[pr.first];
-		double dLonThis = dataLon[pr.second];
+///	<summary>
+///		Per-thread scratch space for SampleNode.
+///	</summary>
+struct SampleWorkspace {
 
-		// Great circle distance to this element
-		double dR =
-			sin(dLat0) * sin(dLatThis)
-			+ cos(dLat0) * cos(dLatThis) * cos(dLonThis - dLon0);
+	///	<summary>
+	///		Running sums and weights of each operator (and profile bin).
+	///	</summary>
+	std::vector<double> vecSum;
+	std::vector<double> vecWeight;
 
-		if (dR >= 1.0) {
-			dR = 0.0;
-		} else if (dR <= -1.0) {
-			dR = 180.0;
-		} else {
-			dR = 180.0 / M_PI * acos(dR);
-		}
-		if (dR != dR) {
-			_EXCEPTIONT("NaN value detected");
-		}
+	///	<summary>
+	///		Values within range of each percentile operator.
+	///	</summary>
+	std::vector< std::vector<float> > vecValues;
+};
 
-		if (dR > dMaxDist) {
-			continue;
-		}
+///////////////////////////////////////////////////////////////////////////////
 
-		// Add value to sum
-		float dLocalArea = cos(dLatThis);
+///	<summary>
+///		Evaluate all sampling operators at a node in one pass over the
+///		shared stencil.  Results are written consecutively to pOut.
+///	</summary>
+void SampleNode(
+	const SamplingStencil & stencil,
+	int iLat,
+	int iLon,
+	int nLon,
+	const std::vector<SampleOp> & vecSampleOps,
+	const std::vector<const float *> & vecSampleData,
+	SampleWorkspace & ws,
+	float * pOut
+) {
+	const int nOps = vecSampleOps.size();
 
-		dArea += dLocalArea;
-		dSum += data[pr.first][pr.second] * dLocalArea;
+	// Initialize accumulators (one slot per output value)
+	int nOutputs = 0;
+	for (int k = 0; k < nOps; k++) {
+		nOutputs += vecSampleOps[k].GetOutputCount();
+	}
 
-		if (data[pr.first][pr.second] > dMaxValue) {
-			dMaxValue = data[pr.first][pr.second];
-		}
+	ws.vecSum.assign(nOutputs, 0.0);
+	ws.vecWeight.assign(nOutputs, 0.0);
+	ws.vecValues.resize(nOps);
 
-		// Add all neighbors of this point
-		std::pair<int,int> prWest(pr.first, (pr.second + nLon - 1) % nLon);
-		if (setNodesVisited.find(prWest) == setNodesVisited.end()) {
-			queueNodes.push(prWest);
+	for (int k = 0, ix = 0; k < nOps; k++) {
+		const SampleOp & op = vecSampleOps[k];
+		if ((op.m_eOp == SampleOp::Max) || (op.m_eOp == SampleOp::Min)) {
+			ws.vecSum[ix] = vecSampleData[k][iLat * nLon + iLon];
 		}
+		ws.vecValues[k].clear();
+		ix += op.GetOutputCount();
+	}
 
-		std::pair<int,int> prEast(pr.first, (pr.second + 1) % nLon);
-		if (setNodesVisited.find(prEast) == setNodesVisited.end()) {
-			queueNodes.push(prEast);
-		}
+	// Single pass over all points within range
+	for (int s = 0; s < stencil.size(); s++) {
+		const StencilPoint & pt = stencil[s];
 
-		std::pair<int,int> prNorth(pr.first + 1, pr.second);
-		if ((prNorth.first < nLat) &&
-			(setNodesVisited.find(prNorth) == setNodesVisited.end())
-		) {
-			queueNodes.push(prNorth);
+		int iData = pt.iLat * nLon + (iLon + pt.iLonOffset) % nLon;
+
+		for (int k = 0, ix = 0; k < nOps; k++) {
+			const SampleOp & op = vecSampleOps[k];
+			int nOpOutputs = op.GetOutputCount();
+
+			if (pt.dDist > op.m_dDistance + SampleDistanceTolerance) {
+				ix += nOpOutputs;
+				continue;
+			}
+
+			float dValue = vecSampleData[k][iData];
+
+			if (op.m_eOp == SampleOp::Max) {
+				if (dValue > ws.vecSum[ix]) {
+					ws.vecSum[ix] = dValue;
+				}
+
+			} else if (op.m_eOp == SampleOp::Min) {
+				if (dValue < ws.vecSum[ix]) {
+					ws.vecSum[ix] = dValue;
+				}
+
+			} else if (op.m_eOp == SampleOp::Mean) {
+				ws.vecSum[ix] += pt.dWeight * dValue;
+				ws.vecWeight[ix] += pt.dWeight;
+
+			} else if (op.m_eOp == SampleOp::Profile) {
+				int iBin = 0;
+				if (op.m_dDistance > 0.0) {
+					iBin = static_cast<int>(
+						pt.dDist / op.m_dDistance * static_cast<double>(op.m_nBins));
+				}
+				if (iBin >= op.m_nBins) {
+					iBin = op.m_nBins - 1;
+				}
+				ws.vecSum[ix + iBin] += pt.dWeight * dValue;
+				ws.vecWeight[ix + iBin] += pt.dWeight;
+
+			} else if (op.m_eOp == SampleOp::Percentile) {
+				ws.vecValues[k].push_back(dValue);
+			}
+
+			ix += nOpOutputs;
 		}
+	}
+
+	// Finalize
+	for (int k = 0, ix = 0; k < nOps; k++) {
+		const SampleOp & op = vecSampleOps[k];
 
-		std::pair<int,int> prSouth(pr.first - 1, pr.second);
-		if ((prSouth.first >= 0) &&
-			(setNodesVisited.find(prSouth) == setNodesVisited.end())
+		if ((op.m_eOp == SampleOp::Max) || (op.m_eOp == SampleOp::Min)) {
+			pOut[ix] = static_cast<float>(ws.vecSum[ix]);
+
+		// Area-weighted mean (empty profile bins are written as zero)
+		} else if (
+		    (op.m_eOp == SampleOp::Mean) || (op.m_eOp == SampleOp::Profile)
 		) {
-			queueNodes.push(prSouth);
+			for (int b = 0; b < op.GetOutputCount(); b++) {
+				if (ws.vecWeight[ix + b] != 0.0) {
+					pOut[ix + b] = static_cast<float>(
+						ws.vecSum[ix + b] / ws.vecWeight[ix + b]);
+				} else {
+					pOut[ix + b] = 0.0f;
+				}
+			}
+
+		// Percentile, linearly interpolated between sorted values
+		} else if (op.m_eOp == SampleOp::Percentile) {
+			std::vector<float> & vecValues = ws.vecValues[k];
+			if (vecValues.size() == 0) {
+				_EXCEPTIONT("Logic error");
+			}
+
+			std::sort(vecValues.begin(), vecValues.end());
+
+			double dRank =
+				op.m_dPercentile / 100.0
+				* static_cast<double>(vecValues.size() - 1);
+
+			int iRank = static_cast<int>(dRank);
+			if (iRank >= vecValues.size() - 1) {
+				pOut[ix] = vecValues[vecValues.size() - 1];
+			} else {
+				double dFrac = dRank - static_cast<double>(iRank);
+				pOut[ix] = static_cast<float>(
+					(1.0 - dFrac) * vecValues[iRank]
+					+ dFrac * vecValues[iRank + 1]);
+			}
 		}
-	}
 
-	// Set average
-	dAverage = dSum / dArea;
+		ix += op.GetOutputCount();
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -253,6 +611,9 @@ try {
 	// Maximum distance from PSL min to perform computation (in degrees) 
 	double dMaxDist;
 
+	// Sampling operators
+	std::string strSampleCmd;
+
 	// Input file format
 	std::string strInputFormat;
 
@@ -274,6 +635,7 @@ try {
 		CommandLineString(strDataFile, "data", "");
 		CommandLineString(strDataFileList, "datalist", "");
 		CommandLineDoubleD(dMaxDist, "maxdist", 5.0, "(degrees)");
+		CommandLineStringD(strSampleCmd, "sample", "", "[var,op,dist[,arg];...] op=max|min|mean|profile|pctl");
 		CommandLineStringD(strInputFormat, "in_format", "visit", "(std|visit)");
 		CommandLineString(strOutputFile, "out", "");
 		CommandLineInt(iTimeIxCol, "itimecol", 2);
@@ -303,6 +665,55 @@ try {
 	if (strOutputFile == "") {
 		_EXCEPTIONT("No output file (--out) specified");
 	}
+
+	// Without sampling operators append the mean and maximum of PRECT
+	if (strSampleCmd == "") {
+		char szSampleCmd[128];
+		sprintf(szSampleCmd, "PRECT,mean,%1.17g;PRECT,max,%1.17g",
+			dMaxDist, dMaxDist);
+		strSampleCmd = szSampleCmd;
+	}
+
+	// Parse sampling operators
+	VariableRegistry varreg;
+
+	std::vector<SampleOp> vecSampleOps;
+
+	AnnounceStartBlock("Parsing sample operations");
+
+	{
+		int iLast = 0;
+		for (int i = 0; i <= strSampleCmd.length(); i++) {
+
+			if ((i == strSampleCmd.length()) ||
+				(strSampleCmd[i] == ';') ||
+				(strSampleCmd[i] == ':')
+			) {
+				std::string strSubStr =
+					strSampleCmd.substr(iLast, i - iLast);
+
+				int iNextOp = (int)(vecSampleOps.size());
+				vecSampleOps.resize(iNextOp + 1);
+				vecSampleOps[iNextOp].Parse(varreg, strSubStr);
+
+				iLast = i + 1;
+			}
+		}
+	}
+
+	AnnounceEndBlock("Done");
+
+	// Number of values appended to each node, and the stencil radius
+	// shared by all operators
+	int nSampleOutputs = 0;
+	double dStencilDist = 0.0;
+
+	for (int k = 0; k < vecSampleOps.size(); k++) {
+		nSampleOutputs += vecSampleOps[k].GetOutputCount();
+		if (vecSampleOps[k].m_dDistance > dStencilDist) {
+			dStencilDist = vecSampleOps[k].m_dDistance;
+		}
+	}
 	
 	// Data file list
 	std::vector<std::string> vecDataFiles;
@@ -311,7 +722,7 @@ try {
 		vecDataFiles.push_back(strDataFile);
 	}
 	if (strDataFileList != "") {
-		GetFileList(strDataFileList, vecDataFiles);
+		GetInputFileList(strDataFileList, vecDataFiles);
 	}
 
 	// Open all data files
@@ -386,6 +797,21 @@ try {
 		}
 	}
 
+	// The stencil of each latitude row is shared by all longitudes
+	for (int i = 1; i < nLon; i++) {
+		double dDeltaLon =
+			(dataLon[i] - dataLon[0]) - static_cast<double>(i)
+			* (dataLon[1] - dataLon[0]);
+
+		if (fabs(dDeltaLon) > 1.0e-6 * fabs(dataLon[1] - dataLon[0])) {
+			_EXCEPTIONT("Longitudes must be equally spaced");
+		}
+	}
+
+	// Generate the SimpleGrid
+	SimpleGrid grid;
+	grid.GenerateLatitudeLongitude(dataLat, dataLon, false);
+
 	// Get time indices
 	std::vector<int> vecTimes;
 
@@ -411,8 +837,10 @@ try {
 			strOutputFile.c_str());
 	}
 
-	// PRECT data matrix
-	DataMatrix<float> dPRECT(nLat, nLon);
+	// All nodes in the input file
+	std::vector<NodeDataPoint> vecNodes;
+
+	AnnounceStartBlock("Reading input file");
 
 	// Loop through all lines of input file
 	for (;;) {
@@ -490,46 +918,162 @@ try {
 			_EXCEPTION1("Time index (%i) out of range", iTime);
 		}
 
-		// Find the correct file
-		int iFile = (-1);
-		for (int f = 0; f < vecTimes.size()-1; f++) {
-			if ((iTime >= vecTimes[f]) && (iTime <= vecTimes[f+1])) {
-				iFile = f;
+		vecNodes.resize(vecNodes.size() + 1);
+		NodeDataPoint & node = vecNodes.back();
+		node.strLine = szSecondBuffer;
+		node.iTime = iTime;
+		node.iLat = iLat;
+		node.iLon = iLon;
+	}
+
+	fclose(fp);
+
+	Announce("%lu nodes", vecNodes.size());
+
+	AnnounceEndBlock("Done");
+
+	// Nodes ordered by time, so that each time slice is read once
+	std::vector<int> vecNodeOrder(vecNodes.size());
+	for (int n = 0; n < vecNodes.size(); n++) {
+		vecNodeOrder[n] = n;
+	}
+	std::stable_sort(
+		vecNodeOrder.begin(),
+		vecNodeOrder.end(),
+		NodeDataPointTimeLess(vecNodes));
+
+	AnnounceStartBlock("Building sampling stencils");
+
+	// Stencils for all latitude rows that contain nodes
+	std::vector<SamplingStencil> vecStencils(nLat);
+
+	std::vector<int> vecStencilRows;
+	{
+		std::vector<bool> fRowHasNodes(nLat, false);
+		for (int n = 0; n < vecNodes.size(); n++) {
+			fRowHasNodes[vecNodes[n].iLat] = true;
+		}
+		for (int j = 0; j < nLat; j++) {
+			if (fRowHasNodes[j]) {
+				vecStencilRows.push_back(j);
 			}
 		}
-		if (iFile == (-1)) {
+	}
+
+#pragma omp parallel for schedule(dynamic)
+	for (int r = 0; r < vecStencilRows.size(); r++) {
+		BuildSamplingStencil(
+			dataLat,
+			dataLon,
+			vecStencilRows[r],
+			dStencilDist,
+			vecStencils[vecStencilRows[r]]);
+	}
+
+	Announce("%lu latitude rows", vecStencilRows.size());
+
+	AnnounceEndBlock("Done");
+
+	AnnounceStartBlock("Computing node data");
+
+	// Variables to load at each time
+	std::vector<VariableIndex> vecLoadVarix;
+	for (int k = 0; k < vecSampleOps.size(); k++) {
+		if (std::find(
+				vecLoadVarix.begin(),
+				vecLoadVarix.end(),
+				vecSampleOps[k].m_varix) == vecLoadVarix.end()
+		) {
+			vecLoadVarix.push_back(vecSampleOps[k].m_varix);
+		}
+	}
+
+	// Data sampled by each operator
+	std::vector<const float *> vecSampleData(vecSampleOps.size(), NULL);
+
+	int nSlicesRead = 0;
+
+	for (int n0 = 0; n0 < vecNodeOrder.size();) {
+
+		// All nodes at this time
+		int iTime = vecNodes[vecNodeOrder[n0]].iTime;
+
+		int n1 = n0 + 1;
+		while ((n1 < vecNodeOrder.size()) &&
+		       (vecNodes[vecNodeOrder[n1]].iTime == iTime)
+		) {
+			n1++;
+		}
+
+		// Find the correct file (last file whose first time is not
+		// after iTime)
+		int iFile = static_cast<int>(
+			std::upper_bound(vecTimes.begin(), vecTimes.end()-1, iTime)
+			- vecTimes.begin()) - 1;
+
+		if ((iFile < 0) || (iTime >= vecTimes[iFile+1])) {
 			_EXCEPTION1("Time index (%i) out of range", iTime);
 		}
 
-		// Load in PRECT from file
-		NcVar * varPRECT = vecDataNcFiles[iFile]->get_var("PRECT");
-		if (varPRECT == NULL) {
-			_EXCEPTION1("File \"%s\" does not contain variable \"PRECT\"",
-				vecDataFiles[iFile].c_str());
+		// Load all variables at this time from file (once per time)
+		NcFileVector vecSliceFiles(1, vecDataNcFiles[iFile]);
+
+		varreg.UnloadAllGridData();
+
+		for (int v = 0; v < vecLoadVarix.size(); v++) {
+			Variable & var = varreg.Get(vecLoadVarix[v]);
+			var.LoadGridData(
+				varreg, vecSliceFiles, grid, iTime - vecTimes[iFile]);
 		}
-		
-		varPRECT->set_cur(iTime - vecTimes[iFile], 0, 0);
-		varPRECT->get(&(dPRECT[0][0]), 1, nLat, nLon);
 
-		// Compute average of PRECT from file
-		float dAverage;
-		float dMaxValue;
+		for (int k = 0; k < vecSampleOps.size(); k++) {
+			Variable & var = varreg.Get(vecSampleOps[k].m_varix);
+			vecSampleData[k] = &(var.GetData()[0]);
+		}
 
-		FindLocalAverage(
-			dPRECT,
-			dataLat,
-			dataLon,
-			iLat,
-			iLon,
-			dMaxDist,
-			dAverage,
-			dMaxValue);
+		nSlicesRead++;
+
+		// Evaluate all sampling operators for all nodes at this time
+#pragma omp parallel
+		{
+			SampleWorkspace ws;
 
-		// Write to file
-		fprintf(fpout, "%s,\t%1.5e,\t%1.5e\n", szSecondBuffer, dAverage, dMaxValue);
+#pragma omp for schedule(dynamic)
+			for (int n = n0; n < n1; n++) {
+				NodeDataPoint & node = vecNodes[vecNodeOrder[n]];
+
+				node.vecValues.resize(nSampleOutputs);
+
+				SampleNode(
+					vecStencils[node.iLat],
+					node.iLat,
+					node.iLon,
+					nLon,
+					vecSampleOps,
+					vecSampleData,
+					ws,
+					&(node.vecValues[0]));
+			}
+		}
+
+		n0 = n1;
+	}
+
+	Announce("%i time slices read", nSlicesRead);
+
+	AnnounceEndBlock("Done");
+
+	AnnounceStartBlock("Writing output file");
+
+	// Write to file in input order
+	for (int n = 0; n < vecNodes.size(); n++) {
+		fprintf(fpout, "%s", vecNodes[n].strLine.c_str());
+		for (int k = 0; k < nSampleOutputs; k++) {
+			fprintf(fpout, ",\t%1.5e", vecNodes[n].vecValues[k]);
+		}
+		fprintf(fpout, "\n");
 	}
 
-	fclose(fp);
 	fclose(fpout);
 
 	AnnounceEndBlock("Done");
@@ -24,54 +24,194 @@
 #include "netcdfcpp.h"
 #include "NetCDFUtilities.h"
 
+#include "NodeFileUtilities.h"
+
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
 #include <cmath>
 #include <vector>
-#include <set>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 
 ///	<summary>
-///		Load in the contents of a text file containing one filename per
-///		line and store in a vector of strings.
+///		Earth radius (in meters).
 ///	</summary>
-void GetInputFileList(
-	const std::string & strInputFileList,
-	std::vector<std::string> & vecInputFiles
+static const double ParamEarthRadius = 6.37122e6;
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Generate the latitudes (in degrees) of a grid with nLat rows.
+///	</summary>
+void GenerateGridLatitudes(
+	int nLat,
+	bool fWithPoles,
+	DataVector<double> & dLat
 ) {
-	FILE * fp = fopen(strInputFileList.c_str(), "r");
+	dLat.Initialize(nLat);
 
-	char szBuffer[1024];
-	for (;;) {
-		fgets(szBuffer, 1024, fp);
+	if (fWithPoles) {
+		for (int j = 0; j < nLat; j++) {
+			dLat[j] = -90.0
+				+ 180.0 * static_cast<double>(j)
+					/ static_cast<double>(nLat - 1);
+		}
 
-		if (feof(fp)) {
-			break;
+	} else {
+		for (int j = 0; j < nLat; j++) {
+			dLat[j] = -90.0
+				+ 180.0 * (static_cast<double>(j) + 0.5)
+					/ static_cast<double>(nLat);
 		}
+	}
+}
 
-		// Remove end-of-line characters
-		for (;;) {
-			int nLen = strlen(szBuffer);
-			if ((szBuffer[nLen-1] == '\n') ||
-				(szBuffer[nLen-1] == '\r') ||
-				(szBuffer[nLen-1] == ' ')
-			) {
-				szBuffer[nLen-1] = '\0';
-				continue;
+///	<summary>
+///		Generate the longitudes (in degrees) of a grid with nLon columns.
+///	</summary>
+void GenerateGridLongitudes(
+	int nLon,
+	DataVector<double> & dLon
+) {
+	dLon.Initialize(nLon);
+
+	for (int i = 0; i < nLon; i++) {
+		dLon[i] = 360.0 * static_cast<double>(i)
+			/ static_cast<double>(nLon);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		An output cell within the density radius of a point.
+///	</summary>
+struct DensityStencilPoint {
+
+	///	<summary>
+	///		Latitude index of the output cell.
+	///	</summary>
+	int iLat;
+
+	///	<summary>
+	///		Longitude offset of the output cell from the output column
+	///		containing the point, in [0,nLonOut).
+	///	</summary>
+	int iLonOffset;
+};
+
+///	<summary>
+///		All output cells within the density radius of a point.
+///	</summary>
+typedef std::vector<DensityStencilPoint> DensityStencil;
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Build the stencil of all output cells whose centers are within
+///		dRadius of a point on input row iLat and input column iLonPhase
+///		(in [0,nBin)).  Since the input and output longitudes are equally
+///		spaced, the same stencil applies to every input column with the
+///		same phase.  The output cell containing the point is always
+///		included.
+///	</summary>
+///	<param name="dRadius">
+///		Great circle radius in meters.
+///	</param>
+void BuildDensityStencil(
+	const DataVector<double> & dLatIn,
+	const DataVector<double> & dLonIn,
+	const DataVector<double> & dLatOut,
+	const DataVector<double> & dLonOut,
+	int nBin,
+	int iLat,
+	int iLonPhase,
+	double dRadius,
+	DensityStencil & stencil
+) {
+	const int nLatOut = dLatOut.GetRows();
+	const int nLonOut = dLonOut.GetRows();
+
+	// Maximum angular distance
+	double dMaxAngle = dRadius / ParamEarthRadius;
+
+	double dLat0 = dLatIn[iLat] * M_PI / 180.0;
+	double dLon0 = dLonIn[iLonPhase] * M_PI / 180.0;
+
+	double dSinLat0 = sin(dLat0);
+	double dCosLat0 = cos(dLat0);
+
+	stencil.clear();
+
+	bool fHasOwnCell = false;
+
+	for (int j = 0; j < nLatOut; j++) {
+		double dLat1 = dLatOut[j] * M_PI / 180.0;
+
+		// The great circle distance is at least the latitude difference
+		if (fabs(dLat1 - dLat0) > dMaxAngle) {
+			continue;
+		}
+
+		double dSinLat1 = sin(dLat1);
+		double dCosLat1 = cos(dLat1);
+
+		DensityStencilPoint pt;
+		pt.iLat = j;
+
+		// Distance increases away from the point in each direction, so
+		// extend eastward and then westward until out of range (the first
+		// output column may lie west of the point)
+		int iEast = (-1);
+		for (int i = 0; i < nLonOut; i++) {
+			double dLon1 = dLonOut[i] * M_PI / 180.0;
+			double dR = dSinLat0 * dSinLat1
+				+ dCosLat0 * dCosLat1 * cos(dLon1 - dLon0);
+			if (dR > 1.0) {
+				dR = 1.0;
+			}
+			if (acos(dR) > dMaxAngle) {
+				if (dLon1 < dLon0) {
+					continue;
+				}
+				break;
+			}
+			pt.iLonOffset = i;
+			stencil.push_back(pt);
+			iEast = i;
+
+			if ((i == 0) && (j == iLat / nBin)) {
+				fHasOwnCell = true;
 			}
-			break;
 		}
 
-		vecInputFiles.push_back(szBuffer);
+		for (int i = nLonOut-1; i > iEast; i--) {
+			double dLon1 = dLonOut[i] * M_PI / 180.0;
+			double dR = dSinLat0 * dSinLat1
+				+ dCosLat0 * dCosLat1 * cos(dLon1 - dLon0);
+			if (dR > 1.0) {
+				dR = 1.0;
+			}
+			if (acos(dR) > dMaxAngle) {
+				break;
+			}
+			pt.iLonOffset = i;
+			stencil.push_back(pt);
+		}
 	}
 
-	if (vecInputFiles.size() == 0) {
-		_EXCEPTION1("No files found in file \"%s\"", strInputFileList.c_str());
+	// Always include the output cell containing the point
+	if (!fHasOwnCell) {
+		DensityStencilPoint pt;
+		pt.iLat = iLat / nBin;
+		pt.iLonOffset = 0;
+		stencil.push_back(pt);
 	}
-
-	fclose(fp);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -121,6 +261,12 @@ try {
 	// Include poles when computing latitude array
 	bool fWithPoles;
 
+	// Deflate level of the output (NetCDF-4 if nonzero)
+	int iDeflateLevel;
+
+	// Radius of influence of each point (in km)
+	double dRadiusKm;
+
 	// Parse the command line
 	BeginCommandLine()
 		CommandLineString(strInputFile, "in", "");
@@ -135,6 +281,8 @@ try {
 		CommandLineInt(nLon, "nlon", 0);
 		CommandLineInt(nBin, "nbin", 1);
 		CommandLineBool(fWithPoles, "withpoles");
+		CommandLineInt(iDeflateLevel, "deflate", 0);
+		CommandLineDoubleD(dRadiusKm, "radius", 0.0, "(km)");
 
 		ParseCommandLine(argc, argv);
 	EndCommandLine(argv)
@@ -148,8 +296,8 @@ try {
 	if ((strInputFile != "") && (strInputFileList != "")) {
 		_EXCEPTIONT("Only one input file (--in) or (--inlist) allowed");
 	}
-	if (strInputFormat != "visit") {
-		_EXCEPTIONT("UNIMPLEMENTED:  Only \"--in_format visit\" supported");
+	if ((strInputFormat != "std") && (strInputFormat != "visit")) {
+		_EXCEPTIONT("Invalid --in_format, expected \"std\" or \"visit\"");
 	}
 
 	// Check output
@@ -170,6 +318,16 @@ try {
 		_EXCEPTIONT("UNIMPLEMENTED: --nlon must be specified currently");
 	}
 	
+	// Check compression
+	if ((iDeflateLevel < 0) || (iDeflateLevel > 9)) {
+		_EXCEPTIONT("Deflate level (--deflate) must be between 0 and 9");
+	}
+
+	// Check radius
+	if (dRadiusKm < 0.0) {
+		_EXCEPTIONT("Radius (--radius) must be nonnegative");
+	}
+
 	// Verify that nbin divides latitudes and longitudes
 	if (nLat % nBin != 0) {
 		_EXCEPTIONT("--nbin must divide --nlat equally");
@@ -190,126 +348,239 @@ try {
 
 	int nFiles = vecInputFiles.size();
 
+	bool fStdFormat = (strInputFormat == "std");
+
+	// Output grid
+	int nLatOut = nLat / nBin;
+	int nLonOut = nLon / nBin;
+
+	DataVector<double> dLatOut;
+	DataVector<double> dLonOut;
+
+	GenerateGridLatitudes(nLatOut, fWithPoles, dLatOut);
+	GenerateGridLongitudes(nLonOut, dLonOut);
+
 	// Density
 	DataMatrix<int> nCounts;
-	nCounts.Initialize(nLat / nBin, nLon / nBin);
+	nCounts.Initialize(nLatOut, nLonOut);
+
+	// With a radius each point is spread to all output cells within the
+	// radius, using a stencil for each input row and longitude phase
+	bool fRadiusMode = (dRadiusKm > 0.0);
+
+	std::vector<DensityStencil> vecStencils;
+
+	if (fRadiusMode) {
+		AnnounceStartBlock("Building density stencils");
+
+		DataVector<double> dLatIn;
+		DataVector<double> dLonIn;
+
+		GenerateGridLatitudes(nLat, fWithPoles, dLatIn);
+		GenerateGridLongitudes(nLon, dLonIn);
+
+		vecStencils.resize(nLat * nBin);
+
+#pragma omp parallel for schedule(dynamic)
+		for (int s = 0; s < nLat * nBin; s++) {
+			BuildDensityStencil(
+				dLatIn,
+				dLonIn,
+				dLatOut,
+				dLonOut,
+				nBin,
+				s / nBin,
+				s % nBin,
+				dRadiusKm * 1000.0,
+				vecStencils[s]);
+		}
+
+		AnnounceEndBlock("Done");
+	}
+
+	// Per-thread counts, and the storm that last visited each location
+	// (used in place of a set of visited locations for each storm)
+	int nThreads = 1;
+#if defined(_OPENMP)
+	nThreads = omp_get_max_threads();
+#endif
+
+	std::vector< DataMatrix<int> > vecThreadCounts(nThreads);
+	std::vector< DataMatrix<int> > vecThreadStamp(nThreads);
+	std::vector< DataMatrix<int> > vecThreadStampOut(nThreads);
+	std::vector<int> vecThreadLastStamp(nThreads, 0);
+
+	for (int i = 0; i < nThreads; i++) {
+		vecThreadCounts[i].Initialize(nLatOut, nLonOut);
+		vecThreadStamp[i].Initialize(nLat, nLon);
+		if (fRadiusMode) {
+			vecThreadStampOut[i].Initialize(nLatOut, nLonOut);
+		}
+	}
 
 	// Loop through all files in list
 	AnnounceStartBlock("Processing files");
 
-	std::string strBuffer;
-	strBuffer.reserve(1024);
+	std::vector<char> vecText;
+	std::vector<size_t> vecLineBegin;
+
+	std::vector<NodeLineType> vecLineType;
+	std::vector<int> vecStormIx;
+	std::vector<int> vecLat;
+	std::vector<int> vecLon;
+
+	std::vector<int> vecNodeLines;
+	std::vector<int> vecStormBegin;
+
+	// Columns of the storm index, longitude index and latitude index
+	const int nColumns = 3;
+	const int iColIx[nColumns] = {iStormIxCol, iLonIxCol, iLatIxCol};
 
 	for (int f = 0; f < nFiles; f++) {
 		Announce("File \"%s\"", vecInputFiles[f].c_str());
 
-		FILE * fp = fopen(vecInputFiles[f].c_str(), "r");
-		if (fp == NULL) {
-			_EXCEPTION1("Unable to open input file \"%s\"",
-				vecInputFiles[f].c_str());
-		}
+		ReadTextFileLines(vecInputFiles[f], vecText, vecLineBegin);
 
-		int iStormIxLast = (-1);
-		std::set< std::pair<int, int> > setLocations;
+		int nLines = vecLineBegin.size();
 
-		for (;;) {
+		vecLineType.resize(nLines);
+		vecStormIx.resize(nLines);
+		vecLat.resize(nLines);
+		vecLon.resize(nLines);
 
-			// Read in the next line
-			fgets(&(strBuffer[0]), 1024, fp);
+		// Parse all lines
+		int iFirstBadLine = nLines;
 
-			int nLength = strlen(&(strBuffer[0]));
+#pragma omp parallel for schedule(static)
+		for (int l = 0; l < nLines; l++) {
+			const char * szColumns[nColumns];
 
-			// Check for end of file
-			if (feof(fp)) {
-				break;
-			}
+			vecLineType[l] =
+				ParseNodeLine(
+					&(vecText[vecLineBegin[l]]),
+					fStdFormat,
+					nColumns,
+					iColIx,
+					szColumns);
 
-			// Check for comment line
-			if (strBuffer[0] == '#') {
+			if (vecLineType[l] != NodeLineType_Node) {
 				continue;
 			}
 
-			// Parse line
-			int iStormIx = 0;
-			int iLon = 0;
-			int iLat = 0;
-
-			int iCol = 0;
-			int iLast = 0;
-
-			bool fWhitespace = true;
-
-			for (int i = 0; i <= nLength; i++) {
-				if ((strBuffer[i] == ' ') ||
-					(strBuffer[i] == ',') ||
-					(strBuffer[i] == '\t') ||
-					(strBuffer[i] == '\0')
-				) {
-					if (!fWhitespace) {
-						if (iCol == iStormIxCol) {
-							strBuffer[i] = '\0';
-							iStormIx = atoi(&(strBuffer[iLast]));
-						}
-						if (iCol == iLonIxCol) {
-							strBuffer[i] = '\0';
-							iLon = atoi(&(strBuffer[iLast]));
-						}
-						if (iCol == iLatIxCol) {
-							strBuffer[i] = '\0';
-							iLat = atoi(&(strBuffer[iLast]));
-						}
-					}
+			vecStormIx[l] = atoi(szColumns[0]);
+			vecLon[l] = atoi(szColumns[1]);
+			vecLat[l] = atoi(szColumns[2]);
 
-					fWhitespace = true;
-
-				} else {
-					if (fWhitespace) {
-						iLast = i;
-						iCol++;
+			if ((vecLat[l] < 0) || (vecLat[l] >= nLat) ||
+			    (vecLon[l] < 0) || (vecLon[l] >= nLon)
+			) {
+#pragma omp critical
+				{
+					if (l < iFirstBadLine) {
+						iFirstBadLine = l;
 					}
-					fWhitespace = false;
 				}
 			}
+		}
+
+		if (iFirstBadLine != nLines) {
+			if ((vecLat[iFirstBadLine] < 0) || (vecLat[iFirstBadLine] >= nLat)) {
+				_EXCEPTION1("Latitude index (%i) out of range",
+					vecLat[iFirstBadLine]);
+			}
+			_EXCEPTION1("Longitude index (%i) out of range",
+				vecLon[iFirstBadLine]);
+		}
 
-			if ((iLat < 0) || (iLat >= nLat)) {
-				_EXCEPTION1("Latitude index (%i) out of range", iLat);
+		// Group nodes into storms, delimited by a change of storm index
+		// (visit) or by a "start" line (std)
+		vecNodeLines.clear();
+		vecStormBegin.clear();
+
+		int iStormIxLast = (-1);
+		bool fNewStorm = true;
+
+		for (int l = 0; l < nLines; l++) {
+			if (vecLineType[l] == NodeLineType_Start) {
+				fNewStorm = true;
+				continue;
+			}
+			if (vecLineType[l] != NodeLineType_Node) {
+				continue;
+			}
+			if (!fStdFormat) {
+				if (vecStormIx[l] != iStormIxLast) {
+					fNewStorm = true;
+					iStormIxLast = vecStormIx[l];
+				}
 			}
-			if ((iLon < 0) || (iLon >= nLon)) {
-				_EXCEPTION1("Longitude index (%i) out of range", iLon);
+			if (fNewStorm) {
+				vecStormBegin.push_back(vecNodeLines.size());
+				fNewStorm = false;
 			}
+			vecNodeLines.push_back(l);
+		}
+		vecStormBegin.push_back(vecNodeLines.size());
+
+		int nStorms = vecStormBegin.size() - 1;
+
+		// Count each location visited by a storm once
+#pragma omp parallel for schedule(dynamic,16)
+		for (int s = 0; s < nStorms; s++) {
+			int iThread = 0;
+#if defined(_OPENMP)
+			iThread = omp_get_thread_num();
+#endif
+			DataMatrix<int> & nThreadCounts = vecThreadCounts[iThread];
+			DataMatrix<int> & nStamp = vecThreadStamp[iThread];
 
-			// Insert all locations from the previous storm
-			if (iStormIx != iStormIxLast) {
-				std::set< std::pair<int, int> >::iterator iterLocations =
-					setLocations.begin();
+			int iStamp = ++vecThreadLastStamp[iThread];
 
-				for (; iterLocations != setLocations.end(); iterLocations++) {
-					int iLatBin = iterLocations->first / nBin;
-					int iLonBin = iterLocations->second / nBin;
-					nCounts[iLatBin][iLonBin]++;
+			for (int n = vecStormBegin[s]; n < vecStormBegin[s+1]; n++) {
+				int l = vecNodeLines[n];
+				int iLat = vecLat[l];
+				int iLon = vecLon[l];
+
+				if (nStamp[iLat][iLon] == iStamp) {
+					continue;
 				}
+				nStamp[iLat][iLon] = iStamp;
 
-				setLocations.clear();
-				iStormIxLast = iStormIx;
-			}
+				if (!fRadiusMode) {
+					nThreadCounts[iLat / nBin][iLon / nBin]++;
+					continue;
+				}
 
-			// Insert new location
-			setLocations.insert(std::pair<int,int>(iLat, iLon));
-		}
+				// Count each output cell within the radius once per storm
+				DataMatrix<int> & nStampOut = vecThreadStampOut[iThread];
+
+				const DensityStencil & stencil =
+					vecStencils[iLat * nBin + iLon % nBin];
+
+				int iLonOut = iLon / nBin;
 
-		// Add remaining locations from setLocations
-		if (setLocations.size() != 0) {
-			std::set< std::pair<int, int> >::iterator iterLocations =
-				setLocations.begin();
+				for (int p = 0; p < stencil.size(); p++) {
+					int j = stencil[p].iLat;
+					int i = (iLonOut + stencil[p].iLonOffset) % nLonOut;
 
-			for (; iterLocations != setLocations.end(); iterLocations++) {
-				int iLatBin = iterLocations->first / nBin;
-				int iLonBin = iterLocations->second / nBin;
-				nCounts[iLatBin][iLonBin]++;
+					if (nStampOut[j][i] == iStamp) {
+						continue;
+					}
+					nStampOut[j][i] = iStamp;
+
+					nThreadCounts[j][i]++;
+				}
 			}
 		}
+	}
 
-		fclose(fp);
+	// Reduce per-thread counts
+	for (int i = 0; i < nThreads; i++) {
+		for (int j = 0; j < nLatOut; j++) {
+		for (int k = 0; k < nLonOut; k++) {
+			nCounts[j][k] += vecThreadCounts[i][j][k];
+		}
+		}
 	}
 
 	AnnounceEndBlock("Done");
@@ -317,16 +588,22 @@ try {
 	// Output results
 	AnnounceStartBlock("Output results");
 
-	// Load the netcdf output file
-	NcFile ncOutput(strOutputFile.c_str(), NcFile::Replace);
+	// Load the netcdf output file (NetCDF-4 if compression is requested)
+	NcFile::FileFormat eOutputFormat = NcFile::Classic;
+	if (iDeflateLevel != 0) {
+		eOutputFormat = NcFile::Netcdf4Classic;
+	}
+
+	NcFile ncOutput(
+		strOutputFile.c_str(), NcFile::Replace, NULL, 0, eOutputFormat);
 	if (!ncOutput.is_valid()) {
 		_EXCEPTION1("Unable to open output file \"%s\"",
 			strOutputFile.c_str());
 	}
 
 	// Create output
-	NcDim * dimLat = ncOutput.add_dim("lat", nLat / nBin);
-	NcDim * dimLon = ncOutput.add_dim("lon", nLon / nBin);
+	NcDim * dimLat = ncOutput.add_dim("lat", nLatOut);
+	NcDim * dimLon = ncOutput.add_dim("lon", nLonOut);
 
 	NcVar * varLat = ncOutput.add_var("lat", ncDouble, dimLat);
 	NcVar * varLon = ncOutput.add_var("lon", ncDouble, dimLon);
@@ -334,31 +611,8 @@ try {
 	varLat->add_att("units", "degrees_north");
 	varLon->add_att("units", "degrees_east");
 
-	DataVector<double> dLat(nLat / nBin);
-	DataVector<double> dLon(nLon / nBin);
-
-	if (fWithPoles) {
-		for (int j = 0; j < nLat / nBin; j++) {
-			dLat[j] = -90.0
-				+ 180.0 * static_cast<double>(j)
-					/ static_cast<double>(nLat / nBin - 1);
-		}
-
-	} else {
-		for (int j = 0; j < nLat / nBin; j++) {
-			dLat[j] = -90.0
-				+ 180.0 * (static_cast<double>(j) + 0.5)
-					/ static_cast<double>(nLat / nBin);
-		}
-	}
-
-	for (int i = 0; i < nLon / nBin; i++) {
-		dLon[i] = 360.0 * static_cast<double>(i)
-			/ static_cast<double>(nLon / nBin);
-	}
-
-	varLat->put(&(dLat[0]), nLat / nBin);
-	varLon->put(&(dLon[0]), nLon / nBin);
+	varLat->put(&(dLatOut[0]), nLatOut);
+	varLon->put(&(dLonOut[0]), nLonOut);
 
 	// Output counts
 	NcVar * varCount =
@@ -368,7 +622,16 @@ try {
 			dimLat,
 			dimLon);
 
-	varCount->put(&(nCounts[0][0]), nLat / nBin, nLon / nBin);
+	if (iDeflateLevel != 0) {
+		std::vector<size_t> vecChunkSizes;
+		vecChunkSizes.push_back(nLatOut);
+		vecChunkSizes.push_back(nLonOut);
+
+		SetNcVarCompression(
+			ncOutput, varCount, iDeflateLevel, true, vecChunkSizes);
+	}
+
+	varCount->put(&(nCounts[0][0]), nLatOut, nLonOut);
 
 	ncOutput.close();
 
@@ -20,6 +20,7 @@
 #include "DataVector.h"
 #include "DataMatrix.h"
 #include "TimeObj.h"
+#include "TimeDecoder.h"
 
 #include "kdtree.h"
 
@@ -641,127 +642,30 @@ void ParseDate(
 ///////////////////////////////////////////////////////////////////////////////
 
 ///	<summary>
-///		Parse a time value.
+///		Parse a time value with the given decoder (constructed once from
+///		the units and calendar of the time variable).
 ///	</summary>
 void ParseTimeDouble(
-	const std::string & strTimeUnits,
-	const std::string & strTimeCalendar,
+	const TimeDecoder & timeDecoder,
 	double dTime,
 	int & nDateYear,
 	int & nDateMonth,
 	int & nDateDay,
 	int & nDateHour
 ) {
-	// Get calendar type
-	Time::CalendarType cal;
-	if ((strTimeCalendar.length() >= 6) &&
-		(strncmp(strTimeCalendar.c_str(), "noleap", 6) == 0)
-	) {
-		cal = Time::CalendarNoLeap;
-
-	} else if (
-		(strTimeCalendar.length() >= 8) &&
-		(strncmp(strTimeCalendar.c_str(), "standard", 8) == 0)
-	) {
-		cal = Time::CalendarStandard;
-
-	} else {
-		_EXCEPTION1("Unknown calendar type \"%s\"", strTimeCalendar.c_str());
-	}
-/*
-	Time time(Time::CalendarStandard);
-	time.FromFormattedString("1800-01-01 00:00:00");
-	printf("%1.15e %i\n", 3600.0 * 1577832.0, (int)(3600.0 * 1577832.0));
-	time.AddHours(1577832);
+	TimeDecoder::Date date;
+	timeDecoder.Decode(dTime, date);
 
 	Announce("Time (YMDS): %i %i %i %i",
-			time.GetYear(),
-			time.GetMonth(),
-			time.GetDay(),
-			time.GetSecond());
-
-	_EXCEPTION();
-*/
-	// Time format is "days since ..."
-	if ((strTimeUnits.length() >= 11) &&
-	    (strncmp(strTimeUnits.c_str(), "days since ", 11) == 0)
-	) {
-		std::string strSubStr = strTimeUnits.substr(11);
-		Time time(cal);
-		time.FromFormattedString(strSubStr);
-
-		int nDays = static_cast<int>(dTime);
-		time.AddDays(nDays);
-
-		int nSeconds = static_cast<int>(fmod(dTime, 1.0) * 86400.0);
-		time.AddSeconds(nSeconds);
-
-		Announce("Time (YMDS): %i %i %i %i",
-				time.GetYear(),
-				time.GetMonth(),
-				time.GetDay(),
-				time.GetSecond());
-
-
-		nDateYear = time.GetYear();
-		nDateMonth = time.GetMonth();
-		nDateDay = time.GetDay();
-		nDateHour = time.GetSecond() / 3600;
-
-		//printf("%s\n", strSubStr.c_str());
-
-	// Time format is "hours since ..."
-	} else if (
-	    (strTimeUnits.length() >= 12) &&
-	    (strncmp(strTimeUnits.c_str(), "hours since ", 12) == 0)
-	) {
-		std::string strSubStr = strTimeUnits.substr(12);
-		Time time(cal);
-		time.FromFormattedString(strSubStr);
-
-		time.AddHours(static_cast<int>(dTime));
-
-		Announce("Time (YMDS): %i %i %i %i",
-				time.GetYear(),
-				time.GetMonth(),
-				time.GetDay(),
-				time.GetSecond());
-
-		nDateYear = time.GetYear();
-		nDateMonth = time.GetMonth();
-		nDateDay = time.GetDay();
-		nDateHour = time.GetSecond() / 3600;
-
-		//printf("%s\n", strSubStr.c_str());
-
-	// Time format is "minutes since ..."
-	} else if (
-	    (strTimeUnits.length() >= 14) &&
-	    (strncmp(strTimeUnits.c_str(), "minutes since ", 14) == 0)
-	) {
-		std::string strSubStr = strTimeUnits.substr(14);
-		Time time(cal);
-		time.FromFormattedString(strSubStr);
-
-		time.AddMinutes(static_cast<int>(dTime));
-
-		Announce("Time (YMDS): %i %i %i %i",
-				time.GetYear(),
-				time.GetMonth(),
-				time.GetDay(),
-				time.GetSecond());
-
-		nDateYear = time.GetYear();
-		nDateMonth = time.GetMonth();
-		nDateDay = time.GetDay();
-		nDateHour = time.GetSecond() / 3600;
-
-		//printf("%s\n", strSubStr.c_str());
-
-	} else {
-		_EXCEPTIONT("Unknown \"time::units\" format");
-	}
-	//_EXCEPTION();
+			date.nYear,
+			date.nMonth,
+			date.nDay,
+			date.nSecond);
+
+	nDateYear = date.nYear;
+	nDateMonth = date.nMonth;
+	nDateDay = date.nDay;
+	nDateHour = date.GetHour();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1528,6 +1432,22 @@ try {
 
 	varTime->get(dTime, nTime);
 
+	// Parse the units and calendar of the time variable
+	NcAtt * attTimeUnits = varTime->get_att("units");
+	if (attTimeUnits == NULL) {
+		_EXCEPTIONT("Variable \"time\" has no \"units\" attribute");
+	}
+
+	std::string strTimeUnits = attTimeUnits->as_string(0);
+
+	std::string strTimeCalendar = "noleap";
+	NcAtt * attTimeCalendar = varTime->get_att("calendar");
+	if (attTimeCalendar != NULL) {
+		strTimeCalendar = attTimeCalendar->as_string(0);
+	}
+
+	TimeDecoder timeDecoder(strTimeUnits, strTimeCalendar);
+
 	// Get auxiliary variables
 	bool fSearchByMinima = false;
 	NcVar * varSearch;
@@ -2304,24 +2224,8 @@ try {
 
 			} else {
 */
-				NcAtt * attTimeUnits = varTime->get_att("units");
-				if (attTimeUnits == NULL) {
-					_EXCEPTIONT("Variable \"time\" has no \"units\" attribute");
-				}
-
-				std::string strTimeUnits = attTimeUnits->as_string(0);
-
-
-				std::string strTimeCalendar = "noleap";
-				NcAtt * attTimeCalendar = varTime->get_att("calendar");
-				if (attTimeUnits != NULL) {
-					strTimeCalendar = attTimeCalendar->as_string(0);
-				}
-
-
 				ParseTimeDouble(
-					strTimeUnits,
-					strTimeCalendar,
+					timeDecoder,
 					dTime[t],
 					nDateYear,
 					nDateMonth,
@@ -21,8 +21,7 @@
 #include "DataVector.h"
 #include "DataMatrix.h"
 #include "TimeObj.h"
-
-#include "kdtree.h"
+#include "TimeDecoder.h"
 
 #include "netcdfcpp.h"
 
@@ -33,6 +32,8 @@
 #include <string>
 #include <set>
 #include <queue>
+#include <algorithm>
+#include <functional>
 
 #if defined(TEMPEST_MPIOMP)
 #include <mpi.h>
@@ -496,6 +497,264 @@ void ParseInputFiles(
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		A uniform latitude-longitude hash grid on the sphere for finding
+///		all points within a fixed great circle distance.  Rows have equal
+///		latitude spacing of at least the search distance and each row is
+///		divided into longitude cells of roughly the same width.  Points are
+///		sorted into cells with a single counting sort, and all buffers are
+///		reused when the grid is rebuilt.
+///	</summary>
+class SphericalHashGrid {
+
+public:
+	///	<summary>
+	///		Constructor.
+	///	</summary>
+	SphericalHashGrid() :
+		m_dDist(0.0),
+		m_dRowHeight(0.0),
+		m_nRows(0)
+	{ }
+
+	///	<summary>
+	///		Sort points (with latitude and longitude in radians) into cells
+	///		for searches within distance dDist (in radians).
+	///	</summary>
+	void Build(
+		int nPoints,
+		const double * dLat,
+		const double * dLon,
+		double dDist
+	) {
+		m_dDist = dDist;
+
+		// Cell size is at least the search distance (enlarged slightly so
+		// that rounding never places a point in range two rows away), but
+		// avoid many more cells than points
+		double dCellSize = dDist * (1.0 + 1.0e-6) + 1.0e-12;
+
+		double dMinCellSize =
+			sqrt(4.0 * M_PI / static_cast<double>(std::max(4 * nPoints, 1024)));
+
+		if (dCellSize < dMinCellSize) {
+			dCellSize = dMinCellSize;
+		}
+
+		m_nRows = static_cast<int>(M_PI / dCellSize);
+		if (m_nRows < 1) {
+			m_nRows = 1;
+		}
+		m_dRowHeight = M_PI / static_cast<double>(m_nRows);
+
+		// Number of longitude cells in each row
+		m_vecRowCells.resize(m_nRows);
+		m_vecRowBegin.resize(m_nRows + 1);
+
+		m_vecRowBegin[0] = 0;
+		for (int j = 0; j < m_nRows; j++) {
+			double dLatC =
+				- 0.5 * M_PI + (static_cast<double>(j) + 0.5) * m_dRowHeight;
+
+			int nCells =
+				static_cast<int>(2.0 * M_PI * cos(dLatC) / dCellSize);
+			if (nCells < 1) {
+				nCells = 1;
+			}
+
+			m_vecRowCells[j] = nCells;
+			m_vecRowBegin[j+1] = m_vecRowBegin[j] + nCells;
+		}
+
+		int nCells = m_vecRowBegin[m_nRows];
+
+		// Counting sort of points into cells
+		m_vecPointCell.resize(nPoints);
+		m_vecCellBegin.assign(nCells + 1, 0);
+
+		for (int i = 0; i < nPoints; i++) {
+			int j = GetRow(dLat[i]);
+			int c = m_vecRowBegin[j] + GetColumn(j, dLon[i]);
+
+			m_vecPointCell[i] = c;
+			m_vecCellBegin[c+1]++;
+		}
+
+		for (int c = 0; c < nCells; c++) {
+			m_vecCellBegin[c+1] += m_vecCellBegin[c];
+		}
+
+		m_vecCellFill.resize(nCells);
+		for (int c = 0; c < nCells; c++) {
+			m_vecCellFill[c] = m_vecCellBegin[c];
+		}
+
+		m_vecPoints.resize(nPoints);
+		for (int i = 0; i < nPoints; i++) {
+			m_vecPoints[m_vecCellFill[m_vecPointCell[i]]++] = i;
+		}
+	}
+
+	///	<summary>
+	///		Find all points within chord distance sqrt(dChordDistSq) of the
+	///		point (dLat0, dLon0), with Cartesian coordinates (dX0, dY0, dZ0).
+	///		Distances are computed exactly as in kd_nearest_range3, so the
+	///		same points are found.  The indices of all points found replace
+	///		the contents of vecResults, in increasing order of cell.
+	///	</summary>
+	void FindNeighbors(
+		double dLat0,
+		double dLon0,
+		double dX0,
+		double dY0,
+		double dZ0,
+		double dChordDistSq,
+		const double * dX,
+		const double * dY,
+		const double * dZ,
+		std::vector<int> & vecResults
+	) const {
+		vecResults.clear();
+
+		if (m_nRows == 0) {
+			return;
+		}
+
+		double dDist = m_dDist * (1.0 + 1.0e-9) + 1.0e-12;
+
+		int jBegin = GetRow(dLat0 - dDist);
+		int jEnd = GetRow(dLat0 + dDist);
+
+		// Half-width in longitude of the spherical cap around the point
+		double dHalfWidth = M_PI;
+
+		if ((dLat0 - dDist > -0.5 * M_PI) &&
+		    (dLat0 + dDist < 0.5 * M_PI) &&
+		    (sin(dDist) < cos(dLat0))
+		) {
+			dHalfWidth =
+				asin(sin(dDist) / cos(dLat0)) * (1.0 + 1.0e-9) + 1.0e-12;
+		}
+
+		double dLonN = NormalizeLongitude(dLon0);
+
+		for (int j = jBegin; j <= jEnd; j++) {
+			int nCells = m_vecRowCells[j];
+
+			double dCellWidth = 2.0 * M_PI / static_cast<double>(nCells);
+
+			int iBegin = static_cast<int>(floor((dLonN - dHalfWidth) / dCellWidth));
+			int iEnd = static_cast<int>(floor((dLonN + dHalfWidth) / dCellWidth));
+
+			if ((dHalfWidth >= M_PI) || (iEnd - iBegin + 1 >= nCells)) {
+				iBegin = 0;
+				iEnd = nCells - 1;
+			}
+
+			for (int i = iBegin; i <= iEnd; i++) {
+				int c = m_vecRowBegin[j] + ((i % nCells) + nCells) % nCells;
+
+				for (int k = m_vecCellBegin[c]; k < m_vecCellBegin[c+1]; k++) {
+					int p = m_vecPoints[k];
+
+					double dDistSq = 0.0;
+					dDistSq += (dX[p] - dX0) * (dX[p] - dX0);
+					dDistSq += (dY[p] - dY0) * (dY[p] - dY0);
+					dDistSq += (dZ[p] - dZ0) * (dZ[p] - dZ0);
+
+					if (dDistSq <= dChordDistSq) {
+						vecResults.push_back(p);
+					}
+				}
+			}
+		}
+	}
+
+protected:
+	///	<summary>
+	///		Longitude in the range [0, 2 pi).
+	///	</summary>
+	static double NormalizeLongitude(
+		double dLon
+	) {
+		dLon -= 2.0 * M_PI * floor(dLon / (2.0 * M_PI));
+		if (dLon >= 2.0 * M_PI) {
+			dLon = 0.0;
+		}
+		return dLon;
+	}
+
+	///	<summary>
+	///		Row containing the given latitude.
+	///	</summary>
+	int GetRow(
+		double dLat
+	) const {
+		int j = static_cast<int>(floor((dLat + 0.5 * M_PI) / m_dRowHeight));
+		if (j < 0) {
+			j = 0;
+		}
+		if (j >= m_nRows) {
+			j = m_nRows - 1;
+		}
+		return j;
+	}
+
+	///	<summary>
+	///		Column of row j containing the given longitude.
+	///	</summary>
+	int GetColumn(
+		int j,
+		double dLon
+	) const {
+		int nCells = m_vecRowCells[j];
+
+		double dCellWidth = 2.0 * M_PI / static_cast<double>(nCells);
+
+		int i = static_cast<int>(floor(NormalizeLongitude(dLon) / dCellWidth));
+		if (i >= nCells) {
+			i = nCells - 1;
+		}
+		return i;
+	}
+
+protected:
+	///	<summary>
+	///		Search distance (in radians).
+	///	</summary>
+	double m_dDist;
+
+	///	<summary>
+	///		Height of each row (in radians) and number of rows.
+	///	</summary>
+	double m_dRowHeight;
+	int m_nRows;
+
+	///	<summary>
+	///		Number of cells in each row and index of the first cell.
+	///	</summary>
+	std::vector<int> m_vecRowCells;
+	std::vector<int> m_vecRowBegin;
+
+	///	<summary>
+	///		Index of the first point of each cell in m_vecPoints.
+	///	</summary>
+	std::vector<int> m_vecCellBegin;
+
+	///	<summary>
+	///		Scratch space for the counting sort.
+	///	</summary>
+	std::vector<int> m_vecPointCell;
+	std::vector<int> m_vecCellFill;
+
+	///	<summary>
+	///		Points sorted by cell.
+	///	</summary>
+	std::vector<int> m_vecPoints;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 ///	<summary>
 ///		Find the locations of all minima in the given DataMatrix.
 ///	</summary>
@@ -558,6 +817,97 @@ void FindAllLocalMaxima(
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///	<summary>
+///		Find the locations of all local extrema of data on a structured
+///		latitude-longitude grid, as generated by
+///		SimpleGrid::GenerateLatitudeLongitude.  A node is an extremum if
+///		fCompare(neighbor, value) is false for all of its (north, south,
+///		east and west) neighbors, so the result is identical to that of
+///		FindAllLocalMinima / FindAllLocalMaxima on the same grid.
+///
+///		Rows are compared against the shifted rows above and below and
+///		against themselves shifted by one column in branch-free loops that
+///		the compiler can vectorize; the periodic (or regional) first and
+///		last columns are handled separately.  Indices of all extrema
+///		replace the contents of vecExtrema in increasing order.  vecFlags
+///		is scratch space; both vectors keep their capacity between calls.
+///	</summary>
+template <typename real, typename Compare>
+void FindAllLocalExtremaLatLon(
+	int nLat,
+	int nLon,
+	bool fRegional,
+	const DataVector<real> & data,
+	Compare fCompare,
+	std::vector<unsigned char> & vecFlags,
+	std::vector<int> & vecExtrema
+) {
+	vecExtrema.clear();
+
+	if ((nLat <= 0) || (nLon <= 0)) {
+		return;
+	}
+
+	vecFlags.resize(nLon);
+	vecExtrema.reserve(nLat * nLon);
+
+	unsigned char * flag = &(vecFlags[0]);
+
+	for (int j = 0; j < nLat; j++) {
+		const real * row = &(data[j * nLon]);
+
+		// East and west neighbors of interior columns
+		for (int i = 1; i < nLon - 1; i++) {
+			flag[i] =
+				  static_cast<unsigned char>(fCompare(row[i+1], row[i]))
+				| static_cast<unsigned char>(fCompare(row[i-1], row[i]));
+		}
+
+		// East and west neighbors of the first and last column are
+		// periodic, or absent on regional grids
+		if (fRegional) {
+			flag[0] = 0;
+			flag[nLon-1] = 0;
+
+		} else {
+			flag[0] =
+				  static_cast<unsigned char>(fCompare(row[1 % nLon], row[0]))
+				| static_cast<unsigned char>(fCompare(row[nLon-1], row[0]));
+
+			if (nLon > 1) {
+				flag[nLon-1] =
+					  static_cast<unsigned char>(
+						fCompare(row[0], row[nLon-1]))
+					| static_cast<unsigned char>(
+						fCompare(row[nLon-2], row[nLon-1]));
+			}
+		}
+
+		// North and south neighbors
+		if (j != 0) {
+			const real * rowPrev = row - nLon;
+			for (int i = 0; i < nLon; i++) {
+				flag[i] |= static_cast<unsigned char>(fCompare(rowPrev[i], row[i]));
+			}
+		}
+		if (j != nLat-1) {
+			const real * rowNext = row + nLon;
+			for (int i = 0; i < nLon; i++) {
+				flag[i] |= static_cast<unsigned char>(fCompare(rowNext[i], row[i]));
+			}
+		}
+
+		// Nodes with no flagged neighbor are extrema
+		for (int i = 0; i < nLon; i++) {
+			if (flag[i] == 0) {
+				vecExtrema.push_back(j * nLon + i);
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 ///	<summary>
 ///		Find the minimum/maximum value of a field near the given point.
 ///	</summary>
@@ -675,127 +1025,30 @@ void ParseDate(
 ///////////////////////////////////////////////////////////////////////////////
 
 ///	<summary>
-///		Parse a time value.
+///		Parse a time value with the given decoder (constructed once from
+///		the units and calendar of the time variable).
 ///	</summary>
 void ParseTimeDouble(
-	const std::string & strTimeUnits,
-	const std::string & strTimeCalendar,
+	const TimeDecoder & timeDecoder,
 	double dTime,
 	int & nDateYear,
 	int & nDateMonth,
 	int & nDateDay,
 	int & nDateHour
 ) {
-	// Get calendar type
-	Time::CalendarType cal;
-	if ((strTimeCalendar.length() >= 6) &&
-		(strncmp(strTimeCalendar.c_str(), "noleap", 6) == 0)
-	) {
-		cal = Time::CalendarNoLeap;
-
-	} else if (
-		(strTimeCalendar.length() >= 8) &&
-		(strncmp(strTimeCalendar.c_str(), "standard", 8) == 0)
-	) {
-		cal = Time::CalendarStandard;
-
-	} else {
-		_EXCEPTION1("Unknown calendar type \"%s\"", strTimeCalendar.c_str());
-	}
-/*
-	Time time(Time::CalendarStandard);
-	time.FromFormattedString("1800-01-01 00:00:00");
-	printf("%1.15e %i\n", 3600.0 * 1577832.0, (int)(3600.0 * 1577832.0));
-	time.AddHours(1577832);
+	TimeDecoder::Date date;
+	timeDecoder.Decode(dTime, date);
 
 	Announce("Time (YMDS): %i %i %i %i",
-			time.GetYear(),
-			time.GetMonth(),
-			time.GetDay(),
-			time.GetSecond());
-
-	_EXCEPTION();
-*/
-	// Time format is "days since ..."
-	if ((strTimeUnits.length() >= 11) &&
-	    (strncmp(strTimeUnits.c_str(), "days since ", 11) == 0)
-	) {
-		std::string strSubStr = strTimeUnits.substr(11);
-		Time time(cal);
-		time.FromFormattedString(strSubStr);
-
-		int nDays = static_cast<int>(dTime);
-		time.AddDays(nDays);
-
-		int nSeconds = static_cast<int>(fmod(dTime, 1.0) * 86400.0);
-		time.AddSeconds(nSeconds);
-
-		Announce("Time (YMDS): %i %i %i %i",
-				time.GetYear(),
-				time.GetMonth(),
-				time.GetDay(),
-				time.GetSecond());
-
-
-		nDateYear = time.GetYear();
-		nDateMonth = time.GetMonth();
-		nDateDay = time.GetDay();
-		nDateHour = time.GetSecond() / 3600;
-
-		//printf("%s\n", strSubStr.c_str());
-
-	// Time format is "hours since ..."
-	} else if (
-	    (strTimeUnits.length() >= 12) &&
-	    (strncmp(strTimeUnits.c_str(), "hours since ", 12) == 0)
-	) {
-		std::string strSubStr = strTimeUnits.substr(12);
-		Time time(cal);
-		time.FromFormattedString(strSubStr);
-
-		time.AddHours(static_cast<int>(dTime));
-
-		Announce("Time (YMDS): %i %i %i %i",
-				time.GetYear(),
-				time.GetMonth(),
-				time.GetDay(),
-				time.GetSecond());
-
-		nDateYear = time.GetYear();
-		nDateMonth = time.GetMonth();
-		nDateDay = time.GetDay();
-		nDateHour = time.GetSecond() / 3600;
-
-		//printf("%s\n", strSubStr.c_str());
-
-	// Time format is "minutes since ..."
-	} else if (
-	    (strTimeUnits.length() >= 14) &&
-	    (strncmp(strTimeUnits.c_str(), "minutes since ", 14) == 0)
-	) {
-		std::string strSubStr = strTimeUnits.substr(14);
-		Time time(cal);
-		time.FromFormattedString(strSubStr);
-
-		time.AddMinutes(static_cast<int>(dTime));
-
-		Announce("Time (YMDS): %i %i %i %i",
-				time.GetYear(),
-				time.GetMonth(),
-				time.GetDay(),
-				time.GetSecond());
-
-		nDateYear = time.GetYear();
-		nDateMonth = time.GetMonth();
-		nDateDay = time.GetDay();
-		nDateHour = time.GetSecond() / 3600;
-
-		//printf("%s\n", strSubStr.c_str());
-
-	} else {
-		_EXCEPTIONT("Unknown \"time::units\" format");
-	}
-	//_EXCEPTION();
+			date.nYear,
+			date.nMonth,
+			date.nDay,
+			date.nSecond);
+
+	nDateYear = date.nYear;
+	nDateMonth = date.nMonth;
+	nDateDay = date.nDay;
+	nDateHour = date.GetHour();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1365,6 +1618,22 @@ void DetectCyclonesUnstructured(
 			"Expected \"float\", \"double\" or \"int\"");
 	}
 
+	// Parse the units and calendar of the time variable
+	NcAtt * attTimeUnits = varTime->get_att("units");
+	if (attTimeUnits == NULL) {
+		_EXCEPTIONT("Variable \"time\" has no \"units\" attribute");
+	}
+
+	std::string strTimeUnits = attTimeUnits->as_string(0);
+
+	std::string strTimeCalendar = "standard";
+	NcAtt * attTimeCalendar = varTime->get_att("calendar");
+	if (attTimeCalendar != NULL) {
+		strTimeCalendar = attTimeCalendar->as_string(0);
+	}
+
+	TimeDecoder timeDecoder(strTimeUnits, strTimeCalendar);
+
 	// Open output file
 	FILE * fpOutput = fopen(strOutputFile.c_str(), "w");
 	if (fpOutput == NULL) {
@@ -1388,6 +1657,22 @@ void DetectCyclonesUnstructured(
 		fprintf(fpOutput, "\n");
 	}
 
+	// Hash grid and buffers used for merging candidates (reused at
+	// each time)
+	SphericalHashGrid hashMerge;
+
+	std::vector<int> vecMergeIx;
+	std::vector<double> vecMergeLat;
+	std::vector<double> vecMergeLon;
+	std::vector<double> vecMergeX;
+	std::vector<double> vecMergeY;
+	std::vector<double> vecMergeZ;
+	std::vector<int> vecMergeNeighbors;
+
+	// Buffers used for finding extrema on latitude-longitude grids
+	std::vector<unsigned char> vecExtremaFlags;
+	std::vector<int> vecExtrema;
+
 	// Loop through all times
 	for (int t = 0; t < nTime; t += param.nTimeStride) {
 	//for (int t = 0; t < 1; t++) {
@@ -1405,7 +1690,33 @@ void DetectCyclonesUnstructured(
 		// Tag all minima
 		std::set<int> setCandidates;
 
-		if (param.fSearchByMinima) {
+		if (grid.m_nGridDim.size() == 2) {
+			if (param.fSearchByMinima) {
+				FindAllLocalExtremaLatLon<float>(
+					grid.m_nGridDim[0],
+					grid.m_nGridDim[1],
+					param.fRegional,
+					dataSearch,
+					std::less<float>(),
+					vecExtremaFlags,
+					vecExtrema);
+			} else {
+				FindAllLocalExtremaLatLon<float>(
+					grid.m_nGridDim[0],
+					grid.m_nGridDim[1],
+					param.fRegional,
+					dataSearch,
+					std::greater<float>(),
+					vecExtremaFlags,
+					vecExtrema);
+			}
+
+			// Extrema are sorted so each insertion is at the end
+			for (int i = 0; i < vecExtrema.size(); i++) {
+				setCandidates.insert(setCandidates.end(), vecExtrema[i]);
+			}
+
+		} else if (param.fSearchByMinima) {
 			FindAllLocalMinima<float>(grid, dataSearch, setCandidates);
 		} else {
 			FindAllLocalMaxima<float>(grid, dataSearch, setCandidates);
@@ -1493,81 +1804,90 @@ void DetectCyclonesUnstructured(
 			double dSphDist =
 				2.0 * sin(0.5 * param.dMergeDist / 180.0 * M_PI);
 
-			// Create a new KD Tree containing all nodes
-			kdtree * kdMerge = kd_create(3);
+			double dSphDistSq = dSphDist * dSphDist;
+
+			// Coordinates of all candidates
+			int nCandidates = setCandidates.size();
+
+			vecMergeIx.resize(nCandidates);
+			vecMergeLat.resize(nCandidates);
+			vecMergeLon.resize(nCandidates);
+			vecMergeX.resize(nCandidates);
+			vecMergeY.resize(nCandidates);
+			vecMergeZ.resize(nCandidates);
 
 			std::set<int>::const_iterator iterCandidate
 				= setCandidates.begin();
-			for (; iterCandidate != setCandidates.end(); iterCandidate++) {
+			for (int i = 0; iterCandidate != setCandidates.end(); iterCandidate++, i++) {
 				double dLat = grid.m_dLat[*iterCandidate];
 				double dLon = grid.m_dLon[*iterCandidate];
 
-				double dX = cos(dLon) * cos(dLat);
-				double dY = sin(dLon) * cos(dLat);
-				double dZ = sin(dLat);
+				vecMergeIx[i] = *iterCandidate;
+				vecMergeLat[i] = dLat;
+				vecMergeLon[i] = dLon;
 
-				kd_insert3(kdMerge, dX, dY, dZ, (void*)(&(*iterCandidate)));
+				vecMergeX[i] = cos(dLon) * cos(dLat);
+				vecMergeY[i] = sin(dLon) * cos(dLat);
+				vecMergeZ[i] = sin(dLat);
 			}
 
-			// Loop through all candidates find set of nearest neighbors
-			iterCandidate = setCandidates.begin();
-			for (; iterCandidate != setCandidates.end(); iterCandidate++) {
-				double dLat = grid.m_dLat[*iterCandidate];
-				double dLon = grid.m_dLon[*iterCandidate];
+			// Sort all candidates into a hash grid with cells no smaller
+			// than the merge distance
+			if (nCandidates != 0) {
+				hashMerge.Build(
+					nCandidates,
+					&(vecMergeLat[0]),
+					&(vecMergeLon[0]),
+					fabs(param.dMergeDist) / 180.0 * M_PI);
+			}
 
-				double dX = cos(dLon) * cos(dLat);
-				double dY = sin(dLon) * cos(dLat);
-				double dZ = sin(dLat);
+			// Loop through all candidates find set of nearest neighbors
+			for (int i = 0; i < nCandidates; i++) {
 
 				// Find all neighbors within dSphDist
-				kdres * kdresMerge =
-					kd_nearest_range3(kdMerge, dX, dY, dZ, dSphDist);
-
-				// Number of neighbors
-				int nNeighbors = kd_res_size(kdresMerge);
-				if (nNeighbors == 0) {
-					setNewCandidates.insert(*iterCandidate);
-
-				} else {
-					double dValue =
-						static_cast<double>(dataSearch[*iterCandidate]);
-
-					bool fExtrema = true;
-					for (;;) {
-						int * ppr = (int *)(kd_res_item_data(kdresMerge));
-
-						if (param.fSearchByMinima) {
-							if (static_cast<double>(dataSearch[*ppr]) < dValue) {
-								fExtrema = false;
-								break;
-							}
-
-						} else {
-							if (static_cast<double>(dataSearch[*ppr]) > dValue) {
-								fExtrema = false;
-								break;
-							}
-						}
-
-						int iHasMore = kd_res_next(kdresMerge);
-						if (!iHasMore) {
+				hashMerge.FindNeighbors(
+					vecMergeLat[i],
+					vecMergeLon[i],
+					vecMergeX[i],
+					vecMergeY[i],
+					vecMergeZ[i],
+					dSphDistSq,
+					&(vecMergeX[0]),
+					&(vecMergeY[0]),
+					&(vecMergeZ[0]),
+					vecMergeNeighbors);
+
+				// Candidate is kept unless a neighbor is strictly more
+				// extreme (neighbors with equal values are all kept)
+				double dValue =
+					static_cast<double>(dataSearch[vecMergeIx[i]]);
+
+				bool fExtrema = true;
+				for (int n = 0; n < vecMergeNeighbors.size(); n++) {
+					int ix = vecMergeIx[vecMergeNeighbors[n]];
+
+					if (param.fSearchByMinima) {
+						if (static_cast<double>(dataSearch[ix]) < dValue) {
+							fExtrema = false;
 							break;
 						}
-					}
 
-					if (fExtrema) {
-						setNewCandidates.insert(*iterCandidate);
 					} else {
-						nRejectedMerge++;
+						if (static_cast<double>(dataSearch[ix]) > dValue) {
+							fExtrema = false;
+							break;
+						}
 					}
 				}
 
-				kd_res_free(kdresMerge);
+				if (fExtrema) {
+					setNewCandidates.insert(
+						setNewCandidates.end(), vecMergeIx[i]);
+				} else {
+					nRejectedMerge++;
+				}
 			}
 
-			// Destroy the KD Tree
-			kd_free(kdMerge);
-
 			// Update set of pressure minima
 			setCandidates = setNewCandidates;
 		}
@@ -1724,22 +2044,8 @@ void DetectCyclonesUnstructured(
 			int nDateDay;
 			int nDateHour;
 
-			NcAtt * attTimeUnits = varTime->get_att("units");
-			if (attTimeUnits == NULL) {
-				_EXCEPTIONT("Variable \"time\" has no \"units\" attribute");
-			}
-
-			std::string strTimeUnits = attTimeUnits->as_string(0);
-
-			std::string strTimeCalendar = "standard";
-			NcAtt * attTimeCalendar = varTime->get_att("calendar");
-			if (attTimeCalendar != NULL) {
-				strTimeCalendar = attTimeCalendar->as_string(0);
-			}
-
 			ParseTimeDouble(
-				strTimeUnits,
-				strTimeCalendar,
+				timeDecoder,
 				dTime[t],
 				nDateYear,
 				nDateMonth,
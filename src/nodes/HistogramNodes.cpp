@@ -24,55 +24,17 @@
 #include "netcdfcpp.h"
 #include "NetCDFUtilities.h"
 
+#include "NodeFileUtilities.h"
+
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
 #include <cmath>
 #include <vector>
-#include <set>
-
-///////////////////////////////////////////////////////////////////////////////
 
-///	<summary>
-///		Load in the contents of a text file containing one filename per
-///		line and store in a vector of strings.
-///	</summary>
-void GetInputFileList(
-	const std::string & strInputFileList,
-	std::vector<std::string> & vecInputFiles
-) {
-	FILE * fp = fopen(strInputFileList.c_str(), "r");
-
-	char szBuffer[1024];
-	for (;;) {
-		fgets(szBuffer, 1024, fp);
-
-		if (feof(fp)) {
-			break;
-		}
-
-		// Remove end-of-line characters
-		for (;;) {
-			int nLen = strlen(szBuffer);
-			if ((szBuffer[nLen-1] == '\n') ||
-				(szBuffer[nLen-1] == '\r') ||
-				(szBuffer[nLen-1] == ' ')
-			) {
-				szBuffer[nLen-1] = '\0';
-				continue;
-			}
-			break;
-		}
-
-		vecInputFiles.push_back(szBuffer);
-	}
-
-	if (vecInputFiles.size() == 0) {
-		_EXCEPTION1("No files found in file \"%s\"", strInputFileList.c_str());
-	}
-
-	fclose(fp);
-}
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -124,6 +86,9 @@ try {
 	// Number of longitudes in output
 	int nLon;
 
+	// Deflate level of the output (NetCDF-4 if nonzero)
+	int iDeflateLevel;
+
 	// Parse the command line
 	BeginCommandLine()
 		CommandLineString(strInputFile, "in", "");
@@ -139,6 +104,7 @@ try {
 		CommandLineDouble(dLonEnd, "lon_end", 360.0);
 		CommandLineInt(nLat, "nlat", 180);
 		CommandLineInt(nLon, "nlon", 360);
+		CommandLineInt(iDeflateLevel, "deflate", 0);
 
 		ParseCommandLine(argc, argv);
 	EndCommandLine(argv)
@@ -152,8 +118,8 @@ try {
 	if ((strInputFile != "") && (strInputFileList != "")) {
 		_EXCEPTIONT("Only one input file (--in) or (--inlist) allowed");
 	}
-	if (strInputFormat != "std") {
-		_EXCEPTIONT("UNIMPLEMENTED:  Only \"--in_format std\" supported");
+	if ((strInputFormat != "std") && (strInputFormat != "visit")) {
+		_EXCEPTIONT("Invalid --in_format, expected \"std\" or \"visit\"");
 	}
 
 	// Check output
@@ -174,6 +140,11 @@ try {
 		_EXCEPTIONT("UNIMPLEMENTED: --nlon must be specified currently");
 	}
 
+	// Check compression
+	if ((iDeflateLevel < 0) || (iDeflateLevel > 9)) {
+		_EXCEPTIONT("Deflate level (--deflate) must be between 0 and 9");
+	}
+
 	// Input file list
 	std::vector<std::string> vecInputFiles;
 
@@ -186,83 +157,68 @@ try {
 
 	int nFiles = vecInputFiles.size();
 
+	bool fStdFormat = (strInputFormat == "std");
+
 	// Density
 	DataMatrix<int> nCounts;
 	nCounts.Initialize(nLat, nLon);
 
+	// Per-thread counts
+	int nThreads = 1;
+#if defined(_OPENMP)
+	nThreads = omp_get_max_threads();
+#endif
+
+	std::vector< DataMatrix<int> > vecThreadCounts(nThreads);
+	for (int i = 0; i < nThreads; i++) {
+		vecThreadCounts[i].Initialize(nLat, nLon);
+	}
+
 	// Loop through all files in list
 	AnnounceStartBlock("Processing files");
 
-	std::string strBuffer;
-	strBuffer.reserve(1024);
+	std::vector<char> vecText;
+	std::vector<size_t> vecLineBegin;
+
+	// Columns of the longitude and latitude
+	const int nColumns = 2;
+	const int iColIx[nColumns] = {iLonIxCol, iLatIxCol};
 
 	for (int f = 0; f < nFiles; f++) {
 		Announce("File \"%s\"", vecInputFiles[f].c_str());
 
-		FILE * fp = fopen(vecInputFiles[f].c_str(), "r");
-		if (fp == NULL) {
-			_EXCEPTION1("Unable to open input file \"%s\"",
-				vecInputFiles[f].c_str());
-		}
+		ReadTextFileLines(vecInputFiles[f], vecText, vecLineBegin);
 
-		for (;;) {
+		int nLines = vecLineBegin.size();
 
-			// Read in the next line
-			fgets(&(strBuffer[0]), 1024, fp);
+		// First line with an index out of range
+		int iFirstBadLine = nLines;
+		int iBadLat = 0;
+		int iBadLon = 0;
 
-			int nLength = strlen(&(strBuffer[0]));
+#pragma omp parallel for schedule(static)
+		for (int l = 0; l < nLines; l++) {
+			int iThread = 0;
+#if defined(_OPENMP)
+			iThread = omp_get_thread_num();
+#endif
 
-			// Check for end of file
-			if (feof(fp)) {
-				break;
-			}
+			const char * szColumns[nColumns];
 
-			// Check for comment line
-			if (strBuffer[0] == '#') {
-				continue;
-			}
+			NodeLineType eLineType =
+				ParseNodeLine(
+					&(vecText[vecLineBegin[l]]),
+					fStdFormat,
+					nColumns,
+					iColIx,
+					szColumns);
 
-			// Check for new storm
-			if (strncmp(&(strBuffer[0]), "start", 5) == 0) {
+			if (eLineType != NodeLineType_Node) {
 				continue;
 			}
 
-			// Parse line
-			double dLon;
-			double dLat;
-
-			int iCol = 0;
-			int iLast = 0;
-
-			bool fWhitespace = true;
-
-			for (int i = 0; i <= nLength; i++) {
-				if ((strBuffer[i] == ' ') ||
-					(strBuffer[i] == ',') ||
-					(strBuffer[i] == '\t') ||
-					(strBuffer[i] == '\0')
-				) {
-					if (!fWhitespace) {
-						if (iCol == iLonIxCol) {
-							strBuffer[i] = '\0';
-							dLon = atof(&(strBuffer[iLast]));
-						}
-						if (iCol == iLatIxCol) {
-							strBuffer[i] = '\0';
-							dLat = atof(&(strBuffer[iLast]));
-						}
-					}
-
-					fWhitespace = true;
-
-				} else {
-					if (fWhitespace) {
-						iLast = i;
-						iCol++;
-					}
-					fWhitespace = false;
-				}
-			}
+			double dLon = atof(szColumns[0]);
+			double dLat = atof(szColumns[1]);
 
 			// Latitude and longitude index
 			int iLon =
@@ -285,17 +241,38 @@ try {
 				iLat = nLat - 1;
 			}
 
-			if ((iLat < 0) || (iLat >= nLat)) {
-				_EXCEPTION1("Latitude index (%i) out of range", iLat);
-			}
-			if ((iLon < 0) || (iLon >= nLon)) {
-				_EXCEPTION1("Longitude index (%i) out of range", iLon);
+			if ((iLat < 0) || (iLat >= nLat) ||
+			    (iLon < 0) || (iLon >= nLon)
+			) {
+#pragma omp critical
+				{
+					if (l < iFirstBadLine) {
+						iFirstBadLine = l;
+						iBadLat = iLat;
+						iBadLon = iLon;
+					}
+				}
+				continue;
 			}
 
-			nCounts[iLat][iLon]++;
+			vecThreadCounts[iThread][iLat][iLon]++;
+		}
+
+		if (iFirstBadLine != nLines) {
+			if ((iBadLat < 0) || (iBadLat >= nLat)) {
+				_EXCEPTION1("Latitude index (%i) out of range", iBadLat);
+			}
+			_EXCEPTION1("Longitude index (%i) out of range", iBadLon);
 		}
+	}
 
-		fclose(fp);
+	// Reduce per-thread counts
+	for (int i = 0; i < nThreads; i++) {
+		for (int j = 0; j < nLat; j++) {
+		for (int k = 0; k < nLon; k++) {
+			nCounts[j][k] += vecThreadCounts[i][j][k];
+		}
+		}
 	}
 
 	AnnounceEndBlock("Done");
@@ -303,8 +280,14 @@ try {
 	// Output results
 	AnnounceStartBlock("Output results");
 
-	// Load the netcdf output file
-	NcFile ncOutput(strOutputFile.c_str(), NcFile::Replace);
+	// Load the netcdf output file (NetCDF-4 if compression is requested)
+	NcFile::FileFormat eOutputFormat = NcFile::Classic;
+	if (iDeflateLevel != 0) {
+		eOutputFormat = NcFile::Netcdf4Classic;
+	}
+
+	NcFile ncOutput(
+		strOutputFile.c_str(), NcFile::Replace, NULL, 0, eOutputFormat);
 	if (!ncOutput.is_valid()) {
 		_EXCEPTION1("Unable to open output file \"%s\"",
 			strOutputFile.c_str());
@@ -347,6 +330,15 @@ try {
 			dimLat,
 			dimLon);
 
+	if (iDeflateLevel != 0) {
+		std::vector<size_t> vecChunkSizes;
+		vecChunkSizes.push_back(nLat);
+		vecChunkSizes.push_back(nLon);
+
+		SetNcVarCompression(
+			ncOutput, varCount, iDeflateLevel, true, vecChunkSizes);
+	}
+
 	varCount->put(&(nCounts[0][0]), nLat, nLon);
 
 	ncOutput.close();
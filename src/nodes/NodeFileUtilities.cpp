@@ -0,0 +1,179 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    NodeFileUtilities.cpp
+///
+///	<remarks>
+///		Copyright 2000-2014 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#include "NodeFileUtilities.h"
+
+#include "Exception.h"
+
+#include <cstring>
+#include <cstdio>
+
+///////////////////////////////////////////////////////////////////////////////
+
+void GetInputFileList(
+	const std::string & strInputFileList,
+	std::vector<std::string> & vecInputFiles
+) {
+	FILE * fp = fopen(strInputFileList.c_str(), "r");
+	if (fp == NULL) {
+		_EXCEPTION1("Unable to open file \"%s\"", strInputFileList.c_str());
+	}
+
+	char szBuffer[1024];
+	for (;;) {
+		fgets(szBuffer, 1024, fp);
+
+		if (feof(fp)) {
+			break;
+		}
+
+		// Remove end-of-line characters
+		for (;;) {
+			int nLen = strlen(szBuffer);
+			if ((szBuffer[nLen-1] == '\n') ||
+				(szBuffer[nLen-1] == '\r') ||
+				(szBuffer[nLen-1] == ' ')
+			) {
+				szBuffer[nLen-1] = '\0';
+				continue;
+			}
+			break;
+		}
+
+		vecInputFiles.push_back(szBuffer);
+	}
+
+	if (vecInputFiles.size() == 0) {
+		_EXCEPTION1("No files found in file \"%s\"", strInputFileList.c_str());
+	}
+
+	fclose(fp);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReadTextFileLines(
+	const std::string & strFile,
+	std::vector<char> & vecText,
+	std::vector<size_t> & vecLineBegin
+) {
+	FILE * fp = fopen(strFile.c_str(), "rb");
+	if (fp == NULL) {
+		_EXCEPTION1("Unable to open input file \"%s\"", strFile.c_str());
+	}
+
+	fseek(fp, 0, SEEK_END);
+	long lSize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	if (lSize < 0) {
+		_EXCEPTION1("Unable to determine size of file \"%s\"",
+			strFile.c_str());
+	}
+
+	size_t sSize = static_cast<size_t>(lSize);
+
+	// Leave room for a terminator after an unterminated last line
+	vecText.resize(sSize + 1);
+	if (sSize != 0) {
+		if (fread(&(vecText[0]), 1, sSize, fp) != sSize) {
+			_EXCEPTION1("Error reading input file \"%s\"", strFile.c_str());
+		}
+	}
+	vecText[sSize] = '\0';
+
+	fclose(fp);
+
+	// Split into lines
+	vecLineBegin.clear();
+
+	size_t sBegin = 0;
+	for (size_t s = 0; s < sSize; s++) {
+		if ((vecText[s] == '\n') || (vecText[s] == '\r')) {
+			vecText[s] = '\0';
+			if (s != sBegin) {
+				vecLineBegin.push_back(sBegin);
+			}
+			sBegin = s + 1;
+		}
+	}
+	if (sBegin < sSize) {
+		vecLineBegin.push_back(sBegin);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+NodeLineType ParseNodeLine(
+	char * szLine,
+	bool fStdFormat,
+	int nColumns,
+	const int * piColIx,
+	const char ** pszColumns
+) {
+	// Check for comment line
+	if (szLine[0] == '#') {
+		return NodeLineType_Skip;
+	}
+
+	// Check for new storm
+	if (fStdFormat) {
+		if (strncmp(szLine, "start", 5) == 0) {
+			return NodeLineType_Start;
+		}
+	}
+
+	// Parse line
+	for (int k = 0; k < nColumns; k++) {
+		pszColumns[k] = "";
+	}
+
+	int nLength = strlen(szLine);
+
+	int iCol = 0;
+	int iLast = 0;
+
+	bool fWhitespace = true;
+
+	for (int i = 0; i <= nLength; i++) {
+		if ((szLine[i] == ' ') ||
+			(szLine[i] == ',') ||
+			(szLine[i] == '\t') ||
+			(szLine[i] == '\0')
+		) {
+			if (!fWhitespace) {
+				for (int k = 0; k < nColumns; k++) {
+					if (iCol == piColIx[k]) {
+						szLine[i] = '\0';
+						pszColumns[k] = &(szLine[iLast]);
+					}
+				}
+			}
+
+			fWhitespace = true;
+
+		} else {
+			if (fWhitespace) {
+				iLast = i;
+				iCol++;
+			}
+			fWhitespace = false;
+		}
+	}
+
+	return NodeLineType_Node;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
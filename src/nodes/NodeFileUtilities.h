@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+///
+///	\file    NodeFileUtilities.h
+///
+///	<remarks>
+///		Copyright 2000-2014 Paul Ullrich
+///
+///		This file is distributed as part of the Tempest source code package.
+///		Permission is granted to use, copy, modify and distribute this
+///		source code and its documentation under the terms of the GNU General
+///		Public License.  This software is provided "as is" without express
+///		or implied warranty.
+///	</remarks>
+
+#ifndef _NODEFILEUTILITIES_H_
+#define _NODEFILEUTILITIES_H_
+
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Load in the contents of a text file containing one filename per
+///		line and store in a vector of strings.
+///	</summary>
+void GetInputFileList(
+	const std::string & strInputFileList,
+	std::vector<std::string> & vecInputFiles
+);
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Read the contents of a text file into memory.  End-of-line
+///		characters are replaced by null characters and the offset of the
+///		beginning of each line is stored in vecLineBegin.
+///	</summary>
+void ReadTextFileLines(
+	const std::string & strFile,
+	std::vector<char> & vecText,
+	std::vector<size_t> & vecLineBegin
+);
+
+///////////////////////////////////////////////////////////////////////////////
+
+///	<summary>
+///		Type of a line in a node file.
+///	</summary>
+enum NodeLineType {
+	NodeLineType_Skip,
+	NodeLineType_Start,
+	NodeLineType_Node
+};
+
+///	<summary>
+///		Parse a line of a node file.  The line is modified in place so
+///		that pszColumns[k] points to the null-terminated value of the
+///		(1-based) column piColIx[k], or to an empty string if the line
+///		has fewer columns.
+///	</summary>
+NodeLineType ParseNodeLine(
+	char * szLine,
+	bool fStdFormat,
+	int nColumns,
+	const int * piColIx,
+	const char ** pszColumns
+);
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
+
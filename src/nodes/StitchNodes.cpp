@@ -18,7 +18,7 @@
 #include "Exception.h"
 #include "Announce.h"
 
-#include "kdtree.h"
+#include "SpatialIndex.h"
 
 #include <cstdlib>
 #include <cstdio>
@@ -704,29 +704,32 @@ try {
 	// Create kdtree at each time
 	AnnounceStartBlock("Creating KD trees at each time level");
 
-	// Null pointer
-	int * noptr = NULL;
-
 	// Vector of lat/lon values
 	std::vector< std::vector<Node> > vecNodes;
 	vecNodes.resize(vecTimes.size());
 
 	// Vector of KD trees
-	std::vector<kdtree *> vecKDTrees;
+	std::vector<SpatialIndex> vecKDTrees;
 	vecKDTrees.resize(vecTimes.size());
 
+	// Cartesian coordinates of points at one time level
+	std::vector<double> vecX;
+	std::vector<double> vecY;
+	std::vector<double> vecZ;
+
 	for (int t = 0; t < vecTimes.size(); t++) {
 
 		// Create a new kdtree
 		if (vecCandidates[t].size() == 0) {
-			vecKDTrees[t] = NULL;
 			continue;
 		}
 
-		vecKDTrees[t] = kd_create(3);
-
 		vecNodes[t].resize(vecCandidates[t].size());
 
+		vecX.resize(vecCandidates[t].size());
+		vecY.resize(vecCandidates[t].size());
+		vecZ.resize(vecCandidates[t].size());
+
 		// Insert all points at this time level
 		for (int i = 0; i < vecCandidates[t].size(); i++) {
 			double dLat = atof(vecCandidates[t][i][iLatIndex].c_str());
@@ -746,8 +749,14 @@ try {
 			vecNodes[t][i].y = dY;
 			vecNodes[t][i].z = dZ;
 
-			kd_insert3(vecKDTrees[t], dX, dY, dZ, reinterpret_cast<void*>(noptr+i));
+			vecX[i] = dX;
+			vecY[i] = dY;
+			vecZ[i] = dZ;
 		}
+
+		// Build the tree from all points at this time level
+		vecKDTrees[t].Build(
+			&(vecX[0]), &(vecY[0]), &(vecZ[0]), vecCandidates[t].size());
 	}
 
 	AnnounceEndBlock("Done");
@@ -776,22 +785,11 @@ try {
 					break;
 				}
 
-				if (vecKDTrees[t+g] == NULL) {
+				if (vecKDTrees[t+g].GetSize() == 0) {
 					continue;
 				}
 
-				kdres * set = kd_nearest3(vecKDTrees[t+g], dX, dY, dZ);
-
-				if (kd_res_size(set) == 0) {
-					kd_res_free(set);
-					break;
-				}
-
-				int iRes =
-					  reinterpret_cast<int*>(kd_res_item_data(set))
-					- reinterpret_cast<int*>(noptr);
-
-				kd_res_free(set);
+				int iRes = vecKDTrees[t+g].Nearest(dX, dY, dZ);
 
 				// Great circle distance between points
 				double dLonC = vecNodes[t+g][iRes].lon;
@@ -1076,7 +1074,7 @@ try {
 	AnnounceStartBlock("Cleanup");
 
 	for (int t = 0; t < vecKDTrees.size(); t++) {
-		kd_free(vecKDTrees[t]);
+		vecKDTrees[t].Clear();
 	}
 
 	AnnounceEndBlock("Done");